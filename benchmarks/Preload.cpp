@@ -0,0 +1,146 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file benchmarks/Preload.cpp
+ @brief Measure how preload() scales with the number of workers
+
+ Usage : `preload [files] [passes]`
+
+ Creates `files` files of 64 KiB in a temporary directory and preloads
+ them with 1, 2, 4, ... workers up to twice the number of hardware threads.
+ Decoding a file hashes its content `passes` times, to stand for the
+ decoding of an image. The time taken and the speedup over one worker are
+ printed for each count.
+
+ Build it with, e.g.,
+ `c++ -std=c++11 -O2 -I../include Preload.cpp -o preload -lsfml-system -pthread`.
+ */
+
+#include <sftools/ResourceManager.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    unsigned int passes = 16; //!< Set from the command line
+
+    /*!
+     @brief Resource whose decoding costs some CPU time
+     */
+    struct Blob
+    {
+        bool loadFromFile(std::string const& path)
+        {
+            std::ifstream in(path.c_str(), std::ios::binary);
+            std::string const content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+            // FNV-1a
+            hash = 14695981039346656037ULL;
+            for (unsigned int p = 0; p < passes; ++p)
+            {
+                for (std::size_t i = 0; i < content.size(); ++i)
+                {
+                    hash = (hash ^ static_cast<unsigned char>(content[i])) * 1099511628211ULL;
+                }
+            }
+
+            return static_cast<bool>(in);
+        }
+
+        unsigned long long hash; //!< Result of the decoding
+    };
+
+    typedef sftools::GenericManager<Blob, std::string, sftools::loader::LoadFromFile<Blob> > BlobManager;
+
+    double benchmark(std::vector<std::string> const& ids, unsigned int workers)
+    {
+        BlobManager manager;
+        manager.setWorkerCount(workers);
+
+        std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+
+        sftools::LoadProgress const progress = manager.preload(ids.begin(), ids.end());
+        manager.wait();
+
+        std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+
+        if (progress.getLoaded() != ids.size())
+        {
+            std::cerr << "Only " << progress.getLoaded() << " files loaded" << std::endl;
+        }
+
+        return elapsed.count();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t const files = argc > 1 ? std::strtoul(argv[1], 0, 10) : 256;
+    passes = argc > 2 ? static_cast<unsigned int>(std::strtoul(argv[2], 0, 10)) : passes;
+
+    char const* base = std::getenv("TMPDIR");
+    std::string const directory = std::string(base ? base : "/tmp") + "/sftools-preload/";
+    std::system(("mkdir -p '" + directory + "'").c_str());
+    sftools::singleton::ResourceLocations::getInstance().add(directory);
+
+    std::vector<std::string> ids;
+    std::string const content(64 * 1024, 'x');
+    for (std::size_t i = 0; i < files; ++i)
+    {
+        std::ostringstream id;
+        id << "blob" << i;
+        ids.push_back(id.str());
+
+        std::ofstream out((directory + id.str()).c_str(), std::ios::binary);
+        out << content;
+    }
+
+    unsigned int const hardware = std::max(1u, std::thread::hardware_concurrency());
+
+    // Warm the page cache so that every count reads from memory
+    benchmark(ids, hardware);
+
+    std::cout << "workers\ttime (s)\tspeedup" << std::endl;
+
+    double reference = 0;
+    for (unsigned int workers = 1; workers <= 2 * hardware; workers *= 2)
+    {
+        double const time = benchmark(ids, workers);
+        reference = workers == 1 ? time : reference;
+
+        std::cout << workers << "\t" << time << "\t" << reference / time << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,188 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file benchmarks/Readahead.cpp
+ @brief Measure the effect of the I/O scheduling of preload() on cold and
+        warm page caches
+
+ Usage : `readahead [files] [kilobytes] [workers]`
+
+ Creates `files` files of the given size in a temporary directory and
+ preloads them, in shuffled id order, with two loaders :
+ - a plain functor, loaded in the order of the ids;
+ - loader::LoadFromFile, whose locate() lets preload() sort the batch by
+   inode and read the files ahead of the decoders.
+
+ Each loader is timed with a cold page cache, emptied with
+ `POSIX_FADV_DONTNEED` (Linux only; elsewhere both runs are warm), and with
+ a warm one. Put the directory on a rotational disk with `TMPDIR` for the
+ largest differences.
+
+ Build it with, e.g.,
+ `c++ -std=c++11 -O2 -I../include Readahead.cpp -o readahead -lsfml-system -pthread`.
+ */
+
+#include <sftools/ResourceManager.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+namespace
+{
+    /*!
+     @brief Resource holding the bytes of its file
+     */
+    struct Blob
+    {
+        bool loadFromFile(std::string const& path)
+        {
+            std::ifstream in(path.c_str(), std::ios::binary);
+            if (!in)
+            {
+                return false;
+            }
+
+            data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+            return true;
+        }
+
+        std::vector<char> data; //!< Content of the file
+    };
+
+    /*!
+     @brief Loader that can't locate files : loads keep the order of the ids
+     */
+    struct PlainLoader
+    {
+        Blob* operator()(std::string const& id)
+        {
+            std::string const path = sftools::singleton::ResourceLocations::getInstance().resolve(id);
+            Blob* blob = new Blob;
+            if (path.empty() || !blob->loadFromFile(path))
+            {
+                delete blob;
+                return 0;
+            }
+            return blob;
+        }
+    };
+
+    /*!
+     @brief Drop the files from the page cache
+     */
+    void evict(std::string const& directory, std::vector<std::string> const& ids)
+    {
+#ifdef __linux__
+        for (std::size_t i = 0; i < ids.size(); ++i)
+        {
+            int const fd = open((directory + ids[i]).c_str(), O_RDONLY);
+            if (fd >= 0)
+            {
+                fdatasync(fd);
+                posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+                close(fd);
+            }
+        }
+#else
+        (void)directory;
+        (void)ids;
+#endif
+    }
+
+    template <typename Loader>
+    double benchmark(std::vector<std::string> const& ids, unsigned int workers)
+    {
+        sftools::GenericManager<Blob, std::string, Loader> manager;
+        manager.setWorkerCount(workers);
+
+        std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+
+        sftools::LoadProgress const progress = manager.preload(ids.begin(), ids.end());
+        manager.wait();
+
+        std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+
+        if (progress.getLoaded() != ids.size())
+        {
+            std::cerr << "Only " << progress.getLoaded() << " files loaded" << std::endl;
+        }
+
+        return elapsed.count();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t const files = argc > 1 ? std::strtoul(argv[1], 0, 10) : 512;
+    std::size_t const kilobytes = argc > 2 ? std::strtoul(argv[2], 0, 10) : 256;
+    unsigned int const workers = argc > 3 ? static_cast<unsigned int>(std::strtoul(argv[3], 0, 10)) : 4;
+
+    char const* base = std::getenv("TMPDIR");
+    std::string const directory = std::string(base ? base : "/tmp") + "/sftools-readahead/";
+    std::system(("mkdir -p '" + directory + "'").c_str());
+    sftools::singleton::ResourceLocations::getInstance().add(directory);
+
+    std::vector<std::string> ids;
+    std::string const content(kilobytes * 1024, 'x');
+    for (std::size_t i = 0; i < files; ++i)
+    {
+        std::ostringstream id;
+        id << "blob" << i;
+        ids.push_back(id.str());
+
+        std::ofstream out((directory + id.str()).c_str(), std::ios::binary);
+        out << content;
+    }
+
+    // Creation order is a good guess of the disk order : don't follow it
+    std::shuffle(ids.begin(), ids.end(), std::mt19937(42));
+
+    std::cout << "cache\tin order (s)\tscheduled (s)" << std::endl;
+
+    evict(directory, ids);
+    double const coldPlain = benchmark<PlainLoader>(ids, workers);
+    evict(directory, ids);
+    double const coldScheduled = benchmark<sftools::loader::LoadFromFile<Blob> >(ids, workers);
+    std::cout << "cold\t" << coldPlain << "\t" << coldScheduled << std::endl;
+
+    double const warmPlain = benchmark<PlainLoader>(ids, workers);
+    double const warmScheduled = benchmark<sftools::loader::LoadFromFile<Blob> >(ids, workers);
+    std::cout << "warm\t" << warmPlain << "\t" << warmScheduled << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,190 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file benchmarks/Readers.cpp
+ @brief Measure the cost of concurrent reads
+
+ Usage : `readers [milliseconds]`
+
+ First times batches of 1k, 4k and 16k synchronous loads followed by a
+ poll(), with concurrent reads enabled; the snapshot seen by the Readers is
+ published once per poll(), so the time per load should stay flat. Then
+ runs 1 to 32 threads looking resources up through Readers for the given
+ time, while the owning thread polls the manager, and prints the lookups
+ per second.
+
+ Build it with, e.g.,
+ `c++ -std=c++11 -O2 -I../include Readers.cpp -o readers -lsfml-system -pthread`.
+ */
+
+#include <sftools/ResourceManager.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    /*!
+     @brief Resource that doesn't touch the disk once located
+     */
+    struct Blob
+    {
+        bool loadFromFile(std::string const& path)
+        {
+            size = path.size();
+            return true;
+        }
+
+        std::size_t size; //!< Length of the path
+    };
+
+    typedef sftools::GenericManager<Blob, std::string, sftools::loader::LoadFromFile<Blob>, sftools::storage::Hash> BlobManager;
+
+    /*!
+     @brief Make ids of files that exist
+     */
+    std::vector<std::string> makeIds(std::string const& directory, std::size_t count)
+    {
+        std::vector<std::string> ids;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            std::ostringstream id;
+            id << "blob" << i;
+            ids.push_back(id.str());
+
+            std::ofstream((directory + id.str()).c_str());
+        }
+
+        return ids;
+    }
+
+    double timeLoads(std::vector<std::string> const& ids, std::size_t count)
+    {
+        BlobManager manager;
+        manager.enableConcurrentReads();
+
+        std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            manager.load(ids[i]);
+        }
+        manager.poll();
+
+        std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count();
+    }
+
+    double timeReaders(std::vector<std::string> const& ids, unsigned int readers, int milliseconds)
+    {
+        BlobManager manager;
+        manager.enableConcurrentReads();
+        for (std::size_t i = 0; i < ids.size(); ++i)
+        {
+            manager.load(ids[i]);
+        }
+        manager.poll();
+
+        std::atomic<bool> stop(false);
+        std::atomic<unsigned long long> lookups(0);
+
+        std::vector<std::thread> threads;
+        for (unsigned int r = 0; r < readers; ++r)
+        {
+            threads.push_back(std::thread([&, r]()
+            {
+                unsigned long long count = 0;
+                std::size_t i = r;
+                while (!stop)
+                {
+                    // Short-lived Readers, as in an audio callback
+                    BlobManager::Reader reader(manager);
+                    for (int k = 0; k < 64; ++k, ++count)
+                    {
+                        i = (i + 7919) % ids.size();
+                        if (!reader.find(ids[i]))
+                        {
+                            std::cerr << "Missing " << ids[i] << std::endl;
+                        }
+                    }
+                }
+                lookups += count;
+            }));
+        }
+
+        std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+        std::chrono::steady_clock::time_point const end = start + std::chrono::milliseconds(milliseconds);
+        while (std::chrono::steady_clock::now() < end)
+        {
+            manager.poll();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        stop = true;
+        for (std::size_t r = 0; r < threads.size(); ++r)
+        {
+            threads[r].join();
+        }
+
+        std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+        return lookups / elapsed.count();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int const milliseconds = argc > 1 ? std::atoi(argv[1]) : 500;
+
+    char const* base = std::getenv("TMPDIR");
+    std::string const directory = std::string(base ? base : "/tmp") + "/sftools-readers/";
+    std::system(("mkdir -p '" + directory + "'").c_str());
+    sftools::singleton::ResourceLocations::getInstance().add(directory);
+
+    std::vector<std::string> const ids = makeIds(directory, 16000);
+
+    std::cout << "loads\ttime (s)\tus per load" << std::endl;
+    std::size_t const counts[] = { 1000, 4000, 16000 };
+    for (std::size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c)
+    {
+        double const time = timeLoads(ids, counts[c]);
+        std::cout << counts[c] << "\t" << time << "\t" << time * 1e6 / counts[c] << std::endl;
+    }
+
+    std::cout << "readers\tM lookups/s" << std::endl;
+    std::vector<std::string> const resident(ids.begin(), ids.begin() + 1000);
+    for (unsigned int readers = 1; readers <= 32; readers *= 2)
+    {
+        std::cout << readers << "\t" << timeReaders(resident, readers, milliseconds) / 1e6 << std::endl;
+    }
+
+    return 0;
+}
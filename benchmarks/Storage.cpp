@@ -0,0 +1,113 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file benchmarks/Storage.cpp
+ @brief Compare the lookup speed of storage::Map and storage::Hash
+
+ Usage : `storage [lookups]`
+
+ For 1k, 10k and 100k ids shaped like `textures/levelN.png`, looks up
+ random resident ids and prints the time taken by each storage policy.
+
+ Build it with, e.g., `c++ -std=c++11 -O2 -I../include Storage.cpp -o storage`;
+ SFML's headers are required but the benchmark doesn't need to be linked
+ against SFML.
+ */
+
+#include <sftools/ResourceManager/Storage.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    template <typename S>
+    double benchmark(std::vector<std::string> const& ids, std::vector<std::size_t> const& order)
+    {
+        S storage;
+        for (std::size_t i = 0; i < ids.size(); ++i)
+        {
+            storage.insert(ids[i], static_cast<int>(i));
+        }
+
+        std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+
+        long long sum = 0;
+        for (std::size_t i = 0; i < order.size(); ++i)
+        {
+            sum += *storage.find(ids[order[i]]);
+        }
+
+        std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+
+        // Keep the lookups from being optimised away
+        if (sum == -1)
+        {
+            std::cout << sum;
+        }
+
+        return elapsed.count();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t const lookups = argc > 1 ? std::strtoul(argv[1], 0, 10) : 2000000;
+    std::size_t const sizes[] = { 1000, 10000, 100000 };
+
+    std::mt19937 random(42);
+
+    std::cout << "ids\tMap (s)\tHash (s)" << std::endl;
+
+    for (std::size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+    {
+        std::vector<std::string> ids;
+        for (std::size_t i = 0; i < sizes[s]; ++i)
+        {
+            std::ostringstream id;
+            id << "textures/level" << i << ".png";
+            ids.push_back(id.str());
+        }
+
+        std::vector<std::size_t> order(lookups);
+        std::uniform_int_distribution<std::size_t> pick(0, ids.size() - 1);
+        for (std::size_t i = 0; i < order.size(); ++i)
+        {
+            order[i] = pick(random);
+        }
+
+        double const map = benchmark<sftools::storage::Map<std::string, int> >(ids, order);
+        double const hash = benchmark<sftools::storage::Hash<std::string, int> >(ids, order);
+
+        std::cout << sizes[s] << "\t" << map << "\t" << hash << std::endl;
+    }
+
+    return 0;
+}
@@ -32,5 +32,6 @@
 
 #include <sftools/Animation/Animation.hpp>
 #include <sftools/Animation/LoopFrameStream.hpp>
+#include <sftools/Animation/Atlas.hpp>
 
 #endif // __SFTOOLS_BASE_ANIMATION_HPP__
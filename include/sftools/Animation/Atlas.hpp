@@ -0,0 +1,503 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file sftools/Animation/Atlas.hpp
+ @brief Define Atlas class
+ */
+
+#ifndef __SFTOOLS_ATLAS_HPP__
+#define __SFTOOLS_ATLAS_HPP__
+
+#include <SFML/Graphics/Texture.hpp>
+#include <SFML/Graphics/Image.hpp>
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/System/NonCopyable.hpp>
+
+#include <sftools/Animation/Frame.hpp>
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <algorithm>
+#include <stdexcept>
+
+/*!
+ @namespace sftools
+ @brief Simple and Fast Tools
+ */
+namespace sftools
+{
+    namespace priv
+    {
+        /*!
+         @class SkylinePacker
+         @brief Pack rectangles into a fixed-size area
+
+         The packer keeps track of the skyline formed by the top edges of
+         the rectangles packed so far, and places each new rectangle at the
+         lowest position where it fits (bottom-left heuristic). Feeding
+         rectangles by decreasing height gives the best results.
+         */
+        class SkylinePacker
+        {
+        public:
+            /*!
+             @brief Constructor
+
+             @param width width of the area
+             @param height height of the area
+             */
+            SkylinePacker(unsigned int width, unsigned int height)
+            : m_width(width)
+            , m_height(height)
+            {
+                m_skyline.push_back(Segment(0, 0, width));
+            }
+
+            /*!
+             @brief Find a place for a rectangle
+
+             @param width width of the rectangle
+             @param height height of the rectangle
+             @param position set to the top-left corner of the rectangle
+             @return false if the rectangle doesn't fit in the remaining space
+             */
+            bool insert(unsigned int width, unsigned int height, sf::Vector2u& position)
+            {
+                std::size_t best = m_skyline.size();
+                unsigned int bestTop = 0;
+                unsigned int bestWidth = 0;
+
+                for (std::size_t i = 0; i < m_skyline.size(); ++i)
+                {
+                    unsigned int top = 0;
+                    if (fit(i, width, height, top))
+                    {
+                        // Lowest bottom first, then the narrowest segment
+                        if (best == m_skyline.size() || top < bestTop
+                            || (top == bestTop && m_skyline[i].width < bestWidth))
+                        {
+                            best = i;
+                            bestTop = top;
+                            bestWidth = m_skyline[i].width;
+                        }
+                    }
+                }
+
+                if (best == m_skyline.size())
+                {
+                    return false;
+                }
+
+                position = sf::Vector2u(m_skyline[best].x, bestTop);
+                raise(best, width, bestTop + height);
+
+                return true;
+            }
+
+            /*!
+             @brief Get the size of the area actually used
+
+             @return the bounding size of the packed rectangles
+             */
+            sf::Vector2u getUsedSize() const
+            {
+                sf::Vector2u size(0, 0);
+                for (std::size_t i = 0; i < m_skyline.size(); ++i)
+                {
+                    if (m_skyline[i].y > 0)
+                    {
+                        size.x = std::max(size.x, m_skyline[i].x + m_skyline[i].width);
+                        size.y = std::max(size.y, m_skyline[i].y);
+                    }
+                }
+                return size;
+            }
+
+        private:
+            /*!
+             @brief Horizontal segment of the skyline
+             */
+            struct Segment
+            {
+                Segment(unsigned int x, unsigned int y, unsigned int width)
+                : x(x), y(y), width(width)
+                {
+                }
+
+                unsigned int x; //!< left end
+                unsigned int y; //!< height of the segment
+                unsigned int width; //!< length of the segment
+            };
+
+            /*!
+             @brief Check if a rectangle fits with its left edge on a segment
+
+             @param index index of the segment
+             @param width width of the rectangle
+             @param height height of the rectangle
+             @param top set to the lowest top position of the rectangle
+             @return true if the rectangle fits
+             */
+            bool fit(std::size_t index, unsigned int width, unsigned int height, unsigned int& top) const
+            {
+                if (m_skyline[index].x + width > m_width)
+                {
+                    return false;
+                }
+
+                top = 0;
+                unsigned int covered = 0;
+
+                // Rest the rectangle on the highest segment below it
+                for (std::size_t i = index; covered < width; ++i)
+                {
+                    top = std::max(top, m_skyline[i].y);
+                    if (top + height > m_height)
+                    {
+                        return false;
+                    }
+                    covered += m_skyline[i].width;
+                }
+
+                return true;
+            }
+
+            /*!
+             @brief Update the skyline after placing a rectangle
+
+             @param index segment of the left edge of the rectangle
+             @param width width of the rectangle
+             @param y new height of the skyline under the rectangle
+             */
+            void raise(std::size_t index, unsigned int width, unsigned int y)
+            {
+                unsigned int const x = m_skyline[index].x;
+                m_skyline.insert(m_skyline.begin() + index, Segment(x, y, width));
+
+                // Shrink or remove the segments now hidden by the rectangle
+                std::size_t i = index + 1;
+                while (i < m_skyline.size())
+                {
+                    Segment& segment = m_skyline[i];
+                    unsigned int const end = x + width;
+
+                    if (segment.x >= end)
+                    {
+                        break;
+                    }
+
+                    if (segment.x + segment.width <= end)
+                    {
+                        m_skyline.erase(m_skyline.begin() + i);
+                    }
+                    else
+                    {
+                        segment.width -= end - segment.x;
+                        segment.x = end;
+                        break;
+                    }
+                }
+
+                // Merge neighbours of the same height
+                for (i = 0; i + 1 < m_skyline.size(); )
+                {
+                    if (m_skyline[i].y == m_skyline[i + 1].y)
+                    {
+                        m_skyline[i].width += m_skyline[i + 1].width;
+                        m_skyline.erase(m_skyline.begin() + i + 1);
+                    }
+                    else
+                    {
+                        ++i;
+                    }
+                }
+            }
+
+            unsigned int m_width; //!< width of the area
+            unsigned int m_height; //!< height of the area
+            std::vector<Segment> m_skyline; //!< top edge, from left to right
+        };
+    }
+
+    /*!
+     @class Atlas
+     @brief Pack many small images into a few large textures
+
+     Drawing objects that share a texture can be batched into a single
+     draw call. An atlas copies the images added to it into pages as large
+     as the graphics card allows and hands back Frames pointing into these
+     pages.
+
+     @code
+
+     sftools::Atlas atlas;
+
+     for (std::size_t i = 0; i < names.size(); ++i)
+     {
+         atlas.add(names[i], sftools::singleton::ImageManager::getInstance()[names[i]]);
+     }
+
+     atlas.build();
+
+     sftools::Frame hero = atlas.getFrame("hero.png");
+
+     @endcode
+
+     Pages are never moved or modified once built, so frames stay valid
+     until the atlas is destroyed. build() can be called again later to
+     add more images on new pages.
+     */
+    class Atlas : sf::NonCopyable
+    {
+    public:
+        /*!
+         @brief Constructor
+
+         @param pageSize width and height of the pages; 0 means the largest
+                         size supported by the graphics card
+         @param padding transparent gap between images, to avoid bleeding
+                        when the frames are scaled or smoothed
+         */
+        explicit Atlas(unsigned int pageSize = 0, unsigned int padding = 1)
+        : m_pageSize(pageSize == 0 ? sf::Texture::getMaximumSize() : std::min(pageSize, sf::Texture::getMaximumSize()))
+        , m_padding(padding)
+        {
+            // That's it
+        }
+
+        /*!
+         @brief Add an image to the next build
+
+         The image is copied; it doesn't have to be kept alive.
+
+         @param name name of the frame
+         @param image content of the frame
+         */
+        void add(std::string const& name, sf::Image const& image)
+        {
+            m_pending.push_back(Pending(name, image));
+        }
+
+        /*!
+         @brief Add a texture to the next build
+
+         The texture is copied back from the graphics card, which is slow;
+         prefer add(std::string const&, sf::Image const&) when possible.
+
+         @param name name of the frame
+         @param texture content of the frame
+         */
+        void add(std::string const& name, sf::Texture const& texture)
+        {
+            add(name, texture.copyToImage());
+        }
+
+        /*!
+         @brief Pack the images added since the last build into new pages
+
+         Larger images are packed first. Each page is trimmed to the area
+         actually used before being uploaded.
+
+         @return false if an image is larger than a page or if a page could
+                 not be created; nothing is built in that case
+         */
+        bool build()
+        {
+            std::vector<Pending const*> order;
+            for (std::size_t i = 0; i < m_pending.size(); ++i)
+            {
+                sf::Vector2u const size = m_pending[i].image.getSize();
+                if (size.x + m_padding > m_pageSize || size.y + m_padding > m_pageSize)
+                {
+                    return false;
+                }
+                order.push_back(&m_pending[i]);
+            }
+            std::sort(order.begin(), order.end(), &Atlas::isTaller);
+
+            // Place every image
+            std::vector<priv::SkylinePacker> packers;
+            std::vector<Placement> placements;
+
+            for (std::size_t i = 0; i < order.size(); ++i)
+            {
+                sf::Vector2u const size = order[i]->image.getSize();
+
+                Placement placement;
+                placement.image = order[i];
+                placement.page = 0;
+
+                while (placement.page < packers.size()
+                       && !packers[placement.page].insert(size.x + m_padding, size.y + m_padding, placement.position))
+                {
+                    ++placement.page;
+                }
+
+                if (placement.page == packers.size())
+                {
+                    packers.push_back(priv::SkylinePacker(m_pageSize, m_pageSize));
+                    packers.back().insert(size.x + m_padding, size.y + m_padding, placement.position);
+                }
+
+                placements.push_back(placement);
+            }
+
+            // Compose the pages
+            std::vector<sf::Image> images(packers.size());
+            for (std::size_t i = 0; i < packers.size(); ++i)
+            {
+                sf::Vector2u const size = packers[i].getUsedSize();
+                images[i].create(size.x, size.y, sf::Color::Transparent);
+            }
+
+            for (std::size_t i = 0; i < placements.size(); ++i)
+            {
+                Placement const& placement = placements[i];
+                images[placement.page].copy(placement.image->image, placement.position.x, placement.position.y);
+            }
+
+            // Upload them
+            std::size_t const firstPage = m_pages.size();
+            for (std::size_t i = 0; i < images.size(); ++i)
+            {
+                m_pages.push_back(sf::Texture());
+                if (!m_pages.back().loadFromImage(images[i]))
+                {
+                    m_pages.resize(firstPage);
+                    return false;
+                }
+            }
+
+            for (std::size_t i = 0; i < placements.size(); ++i)
+            {
+                Placement const& placement = placements[i];
+                sf::Vector2u const size = placement.image->image.getSize();
+                sf::IntRect const area(placement.position.x, placement.position.y, size.x, size.y);
+
+                m_frames[placement.image->name] = Frame(m_pages[firstPage + placement.page], area);
+            }
+
+            m_pending.clear();
+            return true;
+        }
+
+        /*!
+         @brief Get the frame of an image
+
+         A `std::invalid_argument` exception is thrown if `name` wasn't built.
+
+         @param name name given to add()
+         @return a frame pointing into one of the pages
+
+         @throw std::invalid_argument
+         */
+        Frame const& getFrame(std::string const& name) const
+        {
+            std::map<std::string, Frame>::const_iterator it = m_frames.find(name);
+            if (it == m_frames.end())
+            {
+                throw std::invalid_argument("Frame not in atlas");
+            }
+            return it->second;
+        }
+
+        /*!
+         @brief Tell if an image was built into the atlas
+
+         @param name name given to add()
+         @return true if getFrame() can be called with `name`
+         */
+        bool hasFrame(std::string const& name) const
+        {
+            return m_frames.find(name) != m_frames.end();
+        }
+
+        /*!
+         @brief Get the number of pages
+
+         @return number of textures used by the atlas
+         */
+        std::size_t getPageCount() const
+        {
+            return m_pages.size();
+        }
+
+        /*!
+         @brief Get a page
+
+         @param index index of the page, less than getPageCount()
+         @return the texture of the page
+         */
+        sf::Texture const& getPage(std::size_t index) const
+        {
+            return m_pages[index];
+        }
+
+    private:
+        /*!
+         @brief Image waiting for build()
+         */
+        struct Pending
+        {
+            Pending(std::string const& name, sf::Image const& image)
+            : name(name), image(image)
+            {
+            }
+
+            std::string name; //!< name of the frame
+            sf::Image image; //!< copy of the content
+        };
+
+        /*!
+         @brief Location of an image in the pages being built
+         */
+        struct Placement
+        {
+            Pending const* image; //!< placed image
+            std::size_t page; //!< index of the page among the new ones
+            sf::Vector2u position; //!< top-left corner in the page
+        };
+
+        /*!
+         @brief Sort images by decreasing height, then width
+         */
+        static bool isTaller(Pending const* a, Pending const* b)
+        {
+            sf::Vector2u const sa = a->image.getSize();
+            sf::Vector2u const sb = b->image.getSize();
+            return sa.y != sb.y ? sa.y > sb.y : sa.x > sb.x;
+        }
+
+        unsigned int m_pageSize; //!< width and height of the pages
+        unsigned int m_padding; //!< gap between images
+        std::vector<Pending> m_pending; //!< images for the next build
+        std::deque<sf::Texture> m_pages; //!< built pages; a deque keeps their addresses
+        std::map<std::string, Frame> m_frames; //!< frames by name
+    };
+}
+
+#endif // __SFTOOLS_ATLAS_HPP__
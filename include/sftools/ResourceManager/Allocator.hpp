@@ -0,0 +1,304 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file sftools/ResourceManager/Allocator.hpp
+ @brief Defines ResourceAllocator and PoolAllocator policies
+ @note Requires C++11
+ */
+
+#ifndef __SFTOOLS_ALLOCATOR_HPP__
+#define __SFTOOLS_ALLOCATOR_HPP__
+
+#include <sftools/Common/NonCopyable.hpp>
+
+#include <new>
+#include <memory> // std::align
+#include <mutex>
+#include <vector>
+#include <utility> // std::forward
+#include <type_traits> // std::false_type, std::true_type
+#include <cstddef>
+
+/*!
+ @namespace sftools
+ @brief Simple and Fast Tools
+ */
+namespace sftools
+{
+    namespace priv
+    {
+        /*!
+         @class SlabPool
+         @brief Thread-safe pool of memory blocks for objects of type T
+
+         Blocks are carved out of slabs of growing size, so objects allocated
+         in a row are contiguous. Freed blocks are reused, most recently
+         freed first; slabs are never returned to the system.
+
+         @tparam T Type of the objects
+         */
+        template <typename T>
+        class SlabPool : sftools::NonCopyable
+        {
+        public:
+            /*!
+             @brief Constructor
+             */
+            SlabPool()
+            : m_free(0)
+            , m_nextSlabSize(MinSlabSize)
+            {
+                // Nothing allocated yet
+            }
+
+            /*!
+             @brief Get a block for one T
+
+             @return uninitialised memory
+             */
+            void* allocate()
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+
+                if (!m_free)
+                {
+                    grow();
+                }
+
+                Block* block = m_free;
+                m_free = block->next;
+                return block;
+            }
+
+            /*!
+             @brief Give a block back
+
+             @param ptr memory returned by allocate()
+             */
+            void deallocate(void* ptr)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+
+                Block* block = static_cast<Block*>(ptr);
+                block->next = m_free;
+                m_free = block;
+            }
+
+            /*!
+             @brief Get the number of slabs allocated so far
+
+             @return number of calls made to the system allocator
+             */
+            std::size_t getSlabCount() const
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                return m_slabs.size();
+            }
+
+        private:
+            static std::size_t const MinSlabSize = 16; //!< Blocks of the first slab
+            static std::size_t const MaxSlabSize = 1024; //!< Blocks of the largest slabs
+
+            /*!
+             @brief Storage of one object, or link of the free list
+             */
+            union Block
+            {
+                Block* next; //!< next free block
+                alignas(T) unsigned char storage[sizeof(T)]; //!< object
+            };
+
+            /*!
+             @brief Allocate a new slab and add its blocks to the free list
+             */
+            void grow()
+            {
+                std::size_t const size = m_nextSlabSize;
+                m_nextSlabSize = size < MaxSlabSize ? size * 2 : size;
+
+                // Before C++17, `new` ignores alignments larger than the one
+                // of std::max_align_t : align the slab by hand
+                std::size_t space = size * sizeof(Block) + alignof(Block);
+                void* memory = ::operator new(space);
+                m_slabs.push_back(memory);
+
+                std::align(alignof(Block), size * sizeof(Block), memory, space);
+                Block* slab = static_cast<Block*>(memory);
+
+                // In address order, so that consecutive allocations are
+                // contiguous
+                for (std::size_t i = size; i > 0; --i)
+                {
+                    slab[i - 1].next = m_free;
+                    m_free = &slab[i - 1];
+                }
+            }
+
+            std::vector<void*> m_slabs; //!< All slabs, as allocated
+            Block* m_free; //!< First free block
+            std::size_t m_nextSlabSize; //!< Number of blocks of the next slab
+            mutable std::mutex m_mutex; //!< Protects everything above
+        };
+    }
+
+    /*!
+     @brief Create and destroy resources
+
+     Loaders create resources, and their staged objects, with create(), and
+     GenericManager destroys them with destroy(). The default policy uses
+     `new` and `delete`.
+
+     To keep the resources of a type in contiguous slabs, specialise this
+     template with PoolAllocator :
+
+     @code
+
+     namespace sftools
+     {
+         template <>
+         struct ResourceAllocator<sf::Texture> : PoolAllocator<sf::Texture> { };
+     }
+
+     @endcode
+
+     @note The specialisation must be visible wherever the type is loaded
+           or managed, and custom loaders of that type must use create().
+
+     @tparam R Resource type
+     */
+    template <typename R>
+    struct ResourceAllocator
+    {
+        typedef void NewDelete; //!< Tells this policy apart; see priv::UsesNewDelete
+
+        /*!
+         @brief Create a resource
+
+         @param args arguments forwarded to the constructor of R
+         @return a new resource
+         */
+        template <typename... Args>
+        static R* create(Args&&... args)
+        {
+            return new R(std::forward<Args>(args)...);
+        }
+
+        /*!
+         @brief Destroy a resource created by create()
+
+         @param ptr resource to destroy; may be 0
+         */
+        static void destroy(R* ptr)
+        {
+            delete ptr;
+        }
+    };
+
+    /*!
+     @brief Allocation policy storing resources in priv::SlabPool
+
+     @tparam R Resource type
+
+     @see ResourceAllocator
+     */
+    template <typename R>
+    struct PoolAllocator
+    {
+        /*!
+         @brief Create a resource in the pool of R
+
+         @param args arguments forwarded to the constructor of R
+         @return a new resource
+         */
+        template <typename... Args>
+        static R* create(Args&&... args)
+        {
+            void* memory = getPool().allocate();
+
+            try
+            {
+                return new (memory) R(std::forward<Args>(args)...);
+            }
+            catch (...)
+            {
+                getPool().deallocate(memory);
+                throw;
+            }
+        }
+
+        /*!
+         @brief Destroy a resource created by create()
+
+         @param ptr resource to destroy; may be 0
+         */
+        static void destroy(R* ptr)
+        {
+            if (ptr)
+            {
+                ptr->~R();
+                getPool().deallocate(ptr);
+            }
+        }
+
+        /*!
+         @brief Get the pool of R
+
+         The pool is never destroyed, so that resources held by static
+         objects can be destroyed at any time.
+
+         @return the pool shared by all resources of type R
+         */
+        static priv::SlabPool<R>& getPool()
+        {
+            static priv::SlabPool<R>* pool = new priv::SlabPool<R>;
+            return *pool;
+        }
+    };
+
+    namespace priv
+    {
+        /*!
+         @brief Tell whether ResourceAllocator<R> creates resources with
+                `new` and destroys them with `delete`
+
+         It is false for the specialisations of ResourceAllocator. Loaders
+         creating objects derived from R, which only `delete` can destroy,
+         check it.
+
+         @tparam R Resource type
+         */
+        template <typename R, typename = void>
+        struct UsesNewDelete : std::false_type
+        {
+        };
+
+        template <typename R>
+        struct UsesNewDelete<R, typename ResourceAllocator<R>::NewDelete> : std::true_type
+        {
+        };
+    }
+}
+
+#endif // __SFTOOLS_ALLOCATOR_HPP__
@@ -0,0 +1,684 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file sftools/ResourceManager/BatchRead.hpp
+ @brief Defines the helpers used to read batches of files into memory
+ @note Requires C++11
+
+ On Linux, define `SFTOOLS_IO_URING` to submit the reads of a batch
+ through io_uring; otherwise, or when the kernel doesn't allow it, files
+ are read one after the other with pread().
+ */
+
+#ifndef __SFTOOLS_BATCHREAD_HPP__
+#define __SFTOOLS_BATCHREAD_HPP__
+
+#include <sftools/Common/NonCopyable.hpp>
+#include <sftools/ResourceManager/IoScheduler.hpp>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm> // std::min
+#include <cstddef>
+#include <cstdint>
+#include <cstring> // std::memset
+#include <cerrno>
+
+#ifdef _WIN32
+    #include <fstream>
+#else
+    #include <sys/types.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+#if defined(__linux__) && defined(SFTOOLS_IO_URING)
+    #include <linux/io_uring.h>
+    #include <sys/syscall.h>
+    #include <sys/mman.h>
+    #include <sys/uio.h>
+    #define SFTOOLS_BATCHREAD_IO_URING
+#endif
+
+/*!
+ @namespace sftools
+ @brief Simple and Fast Tools
+ */
+namespace sftools
+{
+    namespace priv
+    {
+        /*!
+         @brief A file to be read into memory
+         */
+        struct FileRead
+        {
+            /*!
+             @brief Default constructor
+             */
+            FileRead()
+            : success(false)
+            {
+            }
+
+            std::string path; //!< File to read
+            std::vector<char> data; //!< Content of the file
+            bool success; //!< The whole file was read
+        };
+
+#ifndef _WIN32
+        /*!
+         @brief Read a range of a file, retrying after interruptions and
+                short reads
+
+         @param fd file descriptor
+         @param data receives the range
+         @param size size of the range
+         @param offset beginning of the range in the file
+         @return true if the whole range was read
+         */
+        inline bool readRange(int fd, char* data, std::size_t size, off_t offset)
+        {
+            while (size > 0)
+            {
+                ssize_t const count = pread(fd, data, size, offset);
+
+                if (count < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                else if (count <= 0)
+                {
+                    return false;
+                }
+
+                data += count;
+                size -= static_cast<std::size_t>(count);
+                offset += count;
+            }
+
+            return true;
+        }
+
+        /*!
+         @brief Open a file and allocate the buffer receiving its content
+
+         @param file file to open
+         @return a file descriptor, or -1 on failure
+         */
+        inline int openFile(FileRead& file)
+        {
+            int const fd = open(file.path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+            {
+                return -1;
+            }
+
+            struct stat info;
+            if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode))
+            {
+                close(fd);
+                return -1;
+            }
+
+            file.data.resize(static_cast<std::size_t>(info.st_size));
+            return fd;
+        }
+#endif
+
+        /*!
+         @brief Read a whole file
+
+         @param file file to read; `data` and `success` are updated
+         */
+        inline void readFile(FileRead& file)
+        {
+#ifdef _WIN32
+            std::ifstream in(file.path.c_str(), std::ios::binary | std::ios::ate);
+            file.success = false;
+
+            if (in)
+            {
+                file.data.resize(static_cast<std::size_t>(in.tellg()));
+                in.seekg(0);
+                file.success = file.data.empty()
+                               || static_cast<bool>(in.read(&file.data[0], static_cast<std::streamsize>(file.data.size())));
+            }
+#else
+            int const fd = openFile(file);
+            file.success = fd >= 0 && (file.data.empty() || readRange(fd, &file.data[0], file.data.size(), 0));
+
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+#endif
+            if (!file.success)
+            {
+                std::vector<char>().swap(file.data);
+            }
+        }
+
+        /*!
+         @class BatchReader
+         @brief Read several files at once
+
+         With io_uring, the reads of a batch are submitted with a single
+         system call, which keeps the queue of the disk full; otherwise
+         readFile() is used for each file.
+         */
+        class BatchReader : sftools::NonCopyable
+        {
+        public:
+            /*!
+             @brief Constructor
+             */
+            BatchReader()
+#ifdef SFTOOLS_BATCHREAD_IO_URING
+            : m_ring(-1), m_entries(0), m_sq(MAP_FAILED), m_cq(MAP_FAILED), m_sqes(MAP_FAILED)
+            , m_sqSize(0), m_cqSize(0), m_sqesSize(0)
+#endif
+            {
+#ifdef SFTOOLS_BATCHREAD_IO_URING
+                setup();
+#endif
+            }
+
+            /*!
+             @brief Destructor
+             */
+            ~BatchReader()
+            {
+#ifdef SFTOOLS_BATCHREAD_IO_URING
+                teardown();
+#endif
+            }
+
+            /*!
+             @brief Tell whether io_uring is used
+             */
+            bool usesIoUring() const
+            {
+#ifdef SFTOOLS_BATCHREAD_IO_URING
+                return m_ring >= 0;
+#else
+                return false;
+#endif
+            }
+
+            /*!
+             @brief Get the number of files read() handles at once
+
+             @return the maximum count of read()
+             */
+            std::size_t getCapacity() const
+            {
+#ifdef SFTOOLS_BATCHREAD_IO_URING
+                if (m_ring >= 0)
+                {
+                    return m_entries;
+                }
+#endif
+                return Capacity;
+            }
+
+            /*!
+             @brief Read files
+
+             @param files files to read; `data` and `success` are updated
+             @param count number of files, at most getCapacity()
+             */
+            void read(FileRead* files, std::size_t count)
+            {
+#ifdef SFTOOLS_BATCHREAD_IO_URING
+                if (m_ring >= 0)
+                {
+                    readWithRing(files, count);
+                    return;
+                }
+#endif
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    readFile(files[i]);
+                }
+            }
+
+        private:
+            static std::size_t const Capacity = 64; //!< Files per read()
+
+#ifdef SFTOOLS_BATCHREAD_IO_URING
+            /*!
+             @brief Create the ring; m_ring stays -1 on failure
+             */
+            void setup()
+            {
+                io_uring_params params;
+                std::memset(&params, 0, sizeof(params));
+
+                // Fails with old kernels or when forbidden (e.g. containers)
+                int const ring = static_cast<int>(syscall(__NR_io_uring_setup, static_cast<unsigned>(Capacity), &params));
+                if (ring < 0)
+                {
+                    return;
+                }
+
+                m_ring = ring;
+                m_entries = params.sq_entries;
+                m_sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+                m_cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+                m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+
+    #ifdef IORING_FEAT_SINGLE_MMAP
+                bool const single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    #else
+                bool const single = false;
+    #endif
+                if (single)
+                {
+                    m_sqSize = m_cqSize = std::max(m_sqSize, m_cqSize);
+                }
+
+                m_sq = mmap(0, m_sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring, IORING_OFF_SQ_RING);
+                if (m_sq != MAP_FAILED)
+                {
+                    m_cq = single ? m_sq : mmap(0, m_cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring, IORING_OFF_CQ_RING);
+                }
+                if (m_cq != MAP_FAILED)
+                {
+                    m_sqes = mmap(0, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring, IORING_OFF_SQES);
+                }
+                if (m_sqes == MAP_FAILED)
+                {
+                    teardown();
+                    return;
+                }
+
+                char* const sq = static_cast<char*>(m_sq);
+                char* const cq = static_cast<char*>(m_cq);
+
+                m_sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+                m_sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+                m_sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+                m_cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+                m_cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+                m_cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+                m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+            }
+
+            /*!
+             @brief Release the ring
+             */
+            void teardown()
+            {
+                if (m_sqes != MAP_FAILED)
+                {
+                    munmap(m_sqes, m_sqesSize);
+                }
+                if (m_cq != MAP_FAILED && m_cq != m_sq)
+                {
+                    munmap(m_cq, m_cqSize);
+                }
+                if (m_sq != MAP_FAILED)
+                {
+                    munmap(m_sq, m_sqSize);
+                }
+                if (m_ring >= 0)
+                {
+                    close(m_ring);
+                }
+
+                m_sq = m_cq = m_sqes = MAP_FAILED;
+                m_ring = -1;
+            }
+
+            /*!
+             @brief Submit pending requests and/or wait for completions
+
+             @param submit number of new requests
+             @param wait number of completions to wait for
+             @return false on failure
+             */
+            bool enter(unsigned submit, unsigned wait)
+            {
+                for (;;)
+                {
+                    long const result = syscall(__NR_io_uring_enter, m_ring, submit, wait,
+                                                wait > 0 ? IORING_ENTER_GETEVENTS : 0u, 0, 0);
+                    if (result >= 0)
+                    {
+                        return true;
+                    }
+                    else if (errno != EINTR && errno != EAGAIN)
+                    {
+                        return false;
+                    }
+                }
+            }
+
+            /*!
+             @brief Implementation of read() with io_uring
+             */
+            void readWithRing(FileRead* files, std::size_t count)
+            {
+                std::vector<int> fds(count, -1);
+                std::vector<iovec> buffers(count);
+                std::vector<bool> done(count, false);
+
+                unsigned tail = *m_sqTail; // only written by this thread
+                unsigned submitted = 0;
+
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    fds[i] = openFile(files[i]);
+                    files[i].success = false;
+
+                    if (fds[i] < 0)
+                    {
+                        done[i] = true;
+                        continue;
+                    }
+                    else if (files[i].data.empty())
+                    {
+                        files[i].success = done[i] = true;
+                        continue;
+                    }
+
+                    buffers[i].iov_base = &files[i].data[0];
+                    buffers[i].iov_len = files[i].data.size();
+
+                    unsigned const index = tail & m_sqMask;
+                    io_uring_sqe& sqe = static_cast<io_uring_sqe*>(m_sqes)[index];
+                    std::memset(&sqe, 0, sizeof(sqe));
+                    sqe.opcode = IORING_OP_READV;
+                    sqe.fd = fds[i];
+                    sqe.addr = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(&buffers[i]));
+                    sqe.len = 1;
+                    sqe.off = 0;
+                    sqe.user_data = i;
+
+                    m_sqArray[index] = index;
+                    ++tail;
+                    ++submitted;
+                }
+
+                __atomic_store_n(m_sqTail, tail, __ATOMIC_RELEASE);
+
+                // One system call submits the whole batch
+                unsigned completed = 0;
+                bool healthy = enter(submitted, submitted > 0 ? 1 : 0);
+
+                while (healthy && completed < submitted)
+                {
+                    unsigned head = *m_cqHead;
+                    unsigned const last = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+
+                    for (; head != last; ++head, ++completed)
+                    {
+                        io_uring_cqe const& cqe = m_cqes[head & m_cqMask];
+                        std::size_t const i = static_cast<std::size_t>(cqe.user_data);
+                        std::size_t const size = files[i].data.size();
+                        std::size_t const count = cqe.res >= 0 ? static_cast<std::size_t>(cqe.res) : 0;
+
+                        // Finish short reads synchronously
+                        files[i].success = cqe.res >= 0
+                                           && (count == size
+                                               || readRange(fds[i], &files[i].data[count], size - count, static_cast<off_t>(count)));
+                        done[i] = true;
+                    }
+
+                    __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+
+                    if (completed < submitted)
+                    {
+                        healthy = enter(0, 1);
+                    }
+                }
+
+                if (!healthy)
+                {
+                    // Don't use a ring that fails; requests that didn't
+                    // complete are read again synchronously
+                    teardown();
+                }
+
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    if (!done[i])
+                    {
+                        files[i].success = readRange(fds[i], &files[i].data[0], files[i].data.size(), 0);
+                    }
+                    if (fds[i] >= 0)
+                    {
+                        close(fds[i]);
+                    }
+                    if (!files[i].success)
+                    {
+                        std::vector<char>().swap(files[i].data);
+                    }
+                }
+            }
+
+            int m_ring; //!< io_uring file descriptor, or -1
+            unsigned m_entries; //!< Size of the submission queue
+            void* m_sq; //!< Submission queue ring
+            void* m_cq; //!< Completion queue ring, possibly m_sq
+            void* m_sqes; //!< Submission queue entries
+            std::size_t m_sqSize; //!< Mapped size of m_sq
+            std::size_t m_cqSize; //!< Mapped size of m_cq
+            std::size_t m_sqesSize; //!< Mapped size of m_sqes
+            unsigned* m_sqTail; //!< Written by us, read by the kernel
+            unsigned m_sqMask; //!< Index mask of the submission queue
+            unsigned* m_sqArray; //!< Indices of the submitted entries
+            unsigned* m_cqHead; //!< Written by us, read by the kernel
+            unsigned* m_cqTail; //!< Written by the kernel
+            unsigned m_cqMask; //!< Index mask of the completion queue
+            io_uring_cqe* m_cqes; //!< Completion queue entries
+#endif
+        };
+
+        /*!
+         @class BufferCache
+         @brief Files read ahead for the decoders of a batch
+
+         The paths of a batch are registered on the thread owning the
+         manager, before its decoders are queued, and read by one worker
+         with BatchReader. A decoder takes the content of its file, waiting
+         if it is being read; if its file isn't read yet, the decoder claims
+         it and reads it itself, so no decoder ever waits for a read that
+         hasn't started.
+         */
+        class BufferCache : sftools::NonCopyable
+        {
+        public:
+            /*!
+             @brief Register the files of a batch
+
+             @param requests located resources of the batch
+             */
+            void expect(std::vector<IoRequest> const& requests)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+
+                for (std::size_t i = 0; i < requests.size(); ++i)
+                {
+                    if (!requests[i].path.empty())
+                    {
+                        m_files.insert(std::make_pair(requests[i].path, File()));
+                    }
+                }
+            }
+
+            /*!
+             @brief Read the files of a batch that were not claimed yet
+
+             @param requests same as given to expect()
+             */
+            void read(std::vector<IoRequest> const& requests)
+            {
+                BatchReader reader;
+                std::vector<FileRead> reads;
+
+                for (std::size_t first = 0; first < requests.size(); first += reader.getCapacity())
+                {
+                    std::size_t const last = std::min(requests.size(), first + reader.getCapacity());
+                    reads.clear();
+
+                    {
+                        std::lock_guard<std::mutex> lock(m_mutex);
+
+                        for (std::size_t i = first; i < last; ++i)
+                        {
+                            Files::iterator it = m_files.find(requests[i].path);
+                            if (it != m_files.end() && it->second.state == Queued)
+                            {
+                                it->second.state = Reading;
+                                reads.push_back(FileRead());
+                                reads.back().path = requests[i].path;
+                            }
+                        }
+                    }
+
+                    if (reads.empty())
+                    {
+                        continue;
+                    }
+
+                    reader.read(&reads[0], reads.size());
+
+                    {
+                        std::lock_guard<std::mutex> lock(m_mutex);
+
+                        for (std::size_t i = 0; i < reads.size(); ++i)
+                        {
+                            // Reading files are not removed by take()
+                            File& file = m_files[reads[i].path];
+                            file.data.swap(reads[i].data);
+                            file.state = reads[i].success ? Ready : Failed;
+                        }
+                    }
+
+                    m_condition.notify_all();
+                }
+            }
+
+            /*!
+             @brief Take the content of a file
+
+             @param file file to get; its `data` and `success` are updated
+             @return false if the file was not read ahead, in which case
+                     the caller must read it
+             */
+            bool take(FileRead& file)
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+
+                for (;;)
+                {
+                    Files::iterator it = m_files.find(file.path);
+
+                    if (it == m_files.end())
+                    {
+                        return false;
+                    }
+                    else if (it->second.state == Reading)
+                    {
+                        m_condition.wait(lock);
+                        continue;
+                    }
+
+                    State const state = it->second.state;
+                    file.data.swap(it->second.data);
+                    file.success = state == Ready;
+                    m_files.erase(it);
+
+                    // Queued files are claimed by the caller
+                    return state != Queued;
+                }
+            }
+
+            /*!
+             @brief Forget a file that was not taken
+
+             A file being read is forgotten once read.
+
+             @param path file of a batch whose decoder is done
+             */
+            void drop(std::string const& path)
+            {
+                FileRead file;
+                file.path = path;
+                take(file);
+            }
+
+            /*!
+             @brief Get the number of files registered and not taken yet
+
+             @return number of files of the batches in progress
+             */
+            std::size_t size() const
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                return m_files.size();
+            }
+
+        private:
+            /*!
+             @brief Progress of a file
+             */
+            enum State
+            {
+                Queued,  //!< Not read yet
+                Reading, //!< Being read by read()
+                Ready,   //!< Read
+                Failed   //!< Couldn't be read
+            };
+
+            /*!
+             @brief A file of a batch
+             */
+            struct File
+            {
+                File()
+                : state(Queued)
+                {
+                }
+
+                State state; //!< Progress
+                std::vector<char> data; //!< Content once Ready
+            };
+
+            typedef std::map<std::string, File> Files; //!< Path -> file
+
+            mutable std::mutex m_mutex; //!< Protects m_files
+            std::condition_variable m_condition; //!< Signals files read
+            Files m_files; //!< Files of the batches in progress
+        };
+    }
+}
+
+#endif // __SFTOOLS_BATCHREAD_HPP__
@@ -0,0 +1,306 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file sftools/ResourceManager/Compression.hpp
+ @brief Defines the LZ4 block codec used by the resource caches
+
+ Define SFTOOLS_USE_LZ4 to use the system's liblz4 instead of the built-in
+ implementation; both produce and accept standard LZ4 blocks.
+ */
+
+#ifndef __SFTOOLS_COMPRESSION_HPP__
+#define __SFTOOLS_COMPRESSION_HPP__
+
+#include <vector>
+#include <cstddef>
+#include <cstring>
+
+#ifdef SFTOOLS_USE_LZ4
+    #include <lz4.h>
+    #include <climits>
+#endif
+
+/*!
+ @namespace sftools
+ @brief Simple and Fast Tools
+ */
+namespace sftools
+{
+    namespace priv
+    {
+#ifndef SFTOOLS_USE_LZ4
+
+        /*!
+         @brief Append an LZ4 length continuation to a block
+
+         @param out block being written
+         @param length remaining length, after the 15 stored in the token
+         */
+        inline void lz4WriteLength(std::vector<char>& out, std::size_t length)
+        {
+            while (length >= 255)
+            {
+                out.push_back(static_cast<char>(255));
+                length -= 255;
+            }
+            out.push_back(static_cast<char>(length));
+        }
+
+        /*!
+         @brief Append an LZ4 sequence to a block
+
+         @param out block being written
+         @param literals first literal byte
+         @param literalCount number of literals
+         @param offset distance to the match; ignored for the last sequence
+         @param matchLength length of the match, or 0 for the last sequence
+         */
+        inline void lz4WriteSequence(std::vector<char>& out, char const* literals, std::size_t literalCount,
+                                     std::size_t offset, std::size_t matchLength)
+        {
+            std::size_t const extraMatch = matchLength == 0 ? 0 : matchLength - 4;
+
+            unsigned char token = static_cast<unsigned char>((literalCount < 15 ? literalCount : 15) << 4);
+            token |= static_cast<unsigned char>(extraMatch < 15 ? extraMatch : 15);
+            out.push_back(static_cast<char>(token));
+
+            if (literalCount >= 15)
+            {
+                lz4WriteLength(out, literalCount - 15);
+            }
+            out.insert(out.end(), literals, literals + literalCount);
+
+            if (matchLength != 0)
+            {
+                out.push_back(static_cast<char>(offset & 0xFF));
+                out.push_back(static_cast<char>(offset >> 8));
+
+                if (extraMatch >= 15)
+                {
+                    lz4WriteLength(out, extraMatch - 15);
+                }
+            }
+        }
+
+        /*!
+         @brief Read 4 bytes, whatever their alignment
+         */
+        inline unsigned int lz4Read32(char const* data)
+        {
+            unsigned int value;
+            std::memcpy(&value, data, sizeof(value));
+            return value;
+        }
+
+#endif
+
+        /*!
+         @brief Compress a memory block into an LZ4 block
+
+         @param data block to compress
+         @param size size of the block
+         @param out receives the compressed block
+         */
+        inline void lz4Compress(char const* data, std::size_t size, std::vector<char>& out)
+        {
+#ifdef SFTOOLS_USE_LZ4
+            out.resize(LZ4_compressBound(static_cast<int>(size)));
+            int const written = LZ4_compress_default(data, &out[0], static_cast<int>(size), static_cast<int>(out.size()));
+            out.resize(written > 0 ? written : 0);
+#else
+            std::size_t const MinMatch = 4; // shortest match
+            std::size_t const LastLiterals = 5; // the block ends with literals
+            std::size_t const MatchFindLimit = 12; // no match starts after size - 12
+            std::size_t const MaxOffset = 65535;
+            unsigned int const HashLog = 12;
+
+            out.clear();
+            out.reserve(size + size / 255 + 16);
+
+            std::size_t anchor = 0;
+
+            if (size > MatchFindLimit)
+            {
+                // Last position where each 4-byte sequence was seen, plus one
+                std::vector<std::size_t> table(std::size_t(1) << HashLog, 0);
+
+                std::size_t const limit = size - MatchFindLimit;
+                std::size_t position = 0;
+
+                while (position <= limit)
+                {
+                    unsigned int const sequence = lz4Read32(data + position);
+                    unsigned int const hash = (sequence * 2654435761u) >> (32 - HashLog);
+
+                    std::size_t const candidate = table[hash];
+                    table[hash] = position + 1;
+
+                    if (candidate != 0 && position - (candidate - 1) <= MaxOffset
+                        && lz4Read32(data + candidate - 1) == sequence)
+                    {
+                        std::size_t const match = candidate - 1;
+                        std::size_t end = position + MinMatch;
+                        while (end < size - LastLiterals && data[end] == data[match + end - position])
+                        {
+                            ++end;
+                        }
+
+                        lz4WriteSequence(out, data + anchor, position - anchor, position - match, end - position);
+
+                        position = end;
+                        anchor = end;
+                    }
+                    else
+                    {
+                        // Move faster through incompressible data
+                        position += 1 + ((position - anchor) >> 6);
+                    }
+                }
+            }
+
+            lz4WriteSequence(out, data + anchor, size - anchor, 0, 0);
+#endif
+        }
+
+        /*!
+         @brief Decompress an LZ4 block
+
+         Malformed blocks are detected and never read or write out of
+         bounds.
+
+         @param data compressed block
+         @param size size of the compressed block
+         @param out receives the decompressed data
+         @param outSize exact size of the decompressed data
+         @return false if the block is malformed or doesn't decompress to
+                 exactly `outSize` bytes
+         */
+        inline bool lz4Decompress(char const* data, std::size_t size, char* out, std::size_t outSize)
+        {
+#ifdef SFTOOLS_USE_LZ4
+            if (size > INT_MAX || outSize > INT_MAX)
+            {
+                return false;
+            }
+            return LZ4_decompress_safe(data, out, static_cast<int>(size), static_cast<int>(outSize))
+                   == static_cast<int>(outSize);
+#else
+            unsigned char const* in = reinterpret_cast<unsigned char const*>(data);
+            std::size_t read = 0;
+            std::size_t written = 0;
+
+            while (read < size)
+            {
+                unsigned int const token = in[read++];
+
+                // Literals
+                std::size_t literalCount = token >> 4;
+                if (literalCount == 15)
+                {
+                    unsigned int byte;
+                    do
+                    {
+                        if (read == size)
+                        {
+                            return false;
+                        }
+                        byte = in[read++];
+                        literalCount += byte;
+                    }
+                    while (byte == 255);
+                }
+
+                if (literalCount > size - read || literalCount > outSize - written)
+                {
+                    return false;
+                }
+                std::memcpy(out + written, data + read, literalCount);
+                read += literalCount;
+                written += literalCount;
+
+                if (read == size)
+                {
+                    break; // Last sequence has no match
+                }
+
+                // Match
+                if (size - read < 2)
+                {
+                    return false;
+                }
+                std::size_t const offset = in[read] | (in[read + 1] << 8);
+                read += 2;
+
+                if (offset == 0 || offset > written)
+                {
+                    return false;
+                }
+
+                std::size_t matchLength = token & 15;
+                if (matchLength == 15)
+                {
+                    unsigned int byte;
+                    do
+                    {
+                        if (read == size)
+                        {
+                            return false;
+                        }
+                        byte = in[read++];
+                        matchLength += byte;
+                    }
+                    while (byte == 255);
+                }
+                matchLength += 4;
+
+                if (matchLength > outSize - written)
+                {
+                    return false;
+                }
+
+                char* const target = out + written;
+                char const* const source = target - offset;
+                if (offset >= matchLength)
+                {
+                    std::memcpy(target, source, matchLength);
+                }
+                else
+                {
+                    // Overlapping copy repeats the last `offset` bytes
+                    for (std::size_t i = 0; i < matchLength; ++i)
+                    {
+                        target[i] = source[i];
+                    }
+                }
+                written += matchLength;
+            }
+
+            return written == outSize;
+#endif
+        }
+    }
+}
+
+#endif // __SFTOOLS_COMPRESSION_HPP__
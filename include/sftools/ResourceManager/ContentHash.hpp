@@ -0,0 +1,224 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file sftools/ResourceManager/ContentHash.hpp
+ @brief Defines the content hash used to deduplicate resources
+ */
+
+#ifndef __SFTOOLS_CONTENTHASH_HPP__
+#define __SFTOOLS_CONTENTHASH_HPP__
+
+#include <sftools/ResourceManager/FileSystem.hpp>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/*!
+ @namespace sftools
+ @brief Simple and Fast Tools
+ */
+namespace sftools
+{
+    namespace priv
+    {
+        /*!
+         @brief XXH64 constants
+         */
+        struct XXH64
+        {
+            static std::uint64_t const prime1 = 11400714785074694791ULL;
+            static std::uint64_t const prime2 = 14029467366897019727ULL;
+            static std::uint64_t const prime3 = 1609587929392839161ULL;
+            static std::uint64_t const prime4 = 9650029242287828579ULL;
+            static std::uint64_t const prime5 = 2870177450012600261ULL;
+
+            /*!
+             @brief Rotate a 64-bit word left
+             */
+            static std::uint64_t rotate(std::uint64_t x, int bits)
+            {
+                return (x << bits) | (x >> (64 - bits));
+            }
+
+            /*!
+             @brief Read a little-endian 64-bit word
+             */
+            static std::uint64_t read64(unsigned char const* p)
+            {
+                return  static_cast<std::uint64_t>(p[0])        | (static_cast<std::uint64_t>(p[1]) << 8)
+                     | (static_cast<std::uint64_t>(p[2]) << 16) | (static_cast<std::uint64_t>(p[3]) << 24)
+                     | (static_cast<std::uint64_t>(p[4]) << 32) | (static_cast<std::uint64_t>(p[5]) << 40)
+                     | (static_cast<std::uint64_t>(p[6]) << 48) | (static_cast<std::uint64_t>(p[7]) << 56);
+            }
+
+            /*!
+             @brief Read a little-endian 32-bit word
+             */
+            static std::uint64_t read32(unsigned char const* p)
+            {
+                return  static_cast<std::uint64_t>(p[0])        | (static_cast<std::uint64_t>(p[1]) << 8)
+                     | (static_cast<std::uint64_t>(p[2]) << 16) | (static_cast<std::uint64_t>(p[3]) << 24);
+            }
+
+            /*!
+             @brief Mix an input word into an accumulator
+             */
+            static std::uint64_t round(std::uint64_t acc, std::uint64_t input)
+            {
+                acc += input * prime2;
+                acc = rotate(acc, 31);
+                return acc * prime1;
+            }
+
+            /*!
+             @brief Fold an accumulator into the hash
+             */
+            static std::uint64_t merge(std::uint64_t hash, std::uint64_t acc)
+            {
+                hash ^= round(0, acc);
+                return hash * prime1 + prime4;
+            }
+        };
+
+        /*!
+         @brief Compute the XXH64 hash of a memory block
+
+         The result is the same as the reference implementation of xxHash.
+
+         @param data first byte of the block
+         @param size size of the block in bytes
+         @param seed seed of the hash
+         @return hash of the block
+         */
+        inline std::uint64_t xxHash64(void const* data, std::size_t size, std::uint64_t seed = 0)
+        {
+            unsigned char const* p = static_cast<unsigned char const*>(data);
+            unsigned char const* const end = p + size;
+            std::uint64_t hash;
+
+            if (size >= 32)
+            {
+                std::uint64_t v1 = seed + XXH64::prime1 + XXH64::prime2;
+                std::uint64_t v2 = seed + XXH64::prime2;
+                std::uint64_t v3 = seed;
+                std::uint64_t v4 = seed - XXH64::prime1;
+
+                // Four independent lanes of 8 bytes
+                for (unsigned char const* const limit = end - 32; p <= limit; p += 32)
+                {
+                    v1 = XXH64::round(v1, XXH64::read64(p));
+                    v2 = XXH64::round(v2, XXH64::read64(p + 8));
+                    v3 = XXH64::round(v3, XXH64::read64(p + 16));
+                    v4 = XXH64::round(v4, XXH64::read64(p + 24));
+                }
+
+                hash = XXH64::rotate(v1, 1) + XXH64::rotate(v2, 7) + XXH64::rotate(v3, 12) + XXH64::rotate(v4, 18);
+                hash = XXH64::merge(hash, v1);
+                hash = XXH64::merge(hash, v2);
+                hash = XXH64::merge(hash, v3);
+                hash = XXH64::merge(hash, v4);
+            }
+            else
+            {
+                hash = seed + XXH64::prime5;
+            }
+
+            hash += static_cast<std::uint64_t>(size);
+
+            for (; p + 8 <= end; p += 8)
+            {
+                hash ^= XXH64::round(0, XXH64::read64(p));
+                hash = XXH64::rotate(hash, 27) * XXH64::prime1 + XXH64::prime4;
+            }
+
+            if (p + 4 <= end)
+            {
+                hash ^= XXH64::read32(p) * XXH64::prime1;
+                hash = XXH64::rotate(hash, 23) * XXH64::prime2 + XXH64::prime3;
+                p += 4;
+            }
+
+            for (; p < end; ++p)
+            {
+                hash ^= *p * XXH64::prime5;
+                hash = XXH64::rotate(hash, 11) * XXH64::prime1;
+            }
+
+            // Avalanche
+            hash ^= hash >> 33;
+            hash *= XXH64::prime2;
+            hash ^= hash >> 29;
+            hash *= XXH64::prime3;
+            hash ^= hash >> 32;
+
+            return hash;
+        }
+
+        /*!
+         @brief Compute the XXH64 hash of the content of a file
+
+         The file is memory-mapped rather than read.
+
+         @param path file to hash
+         @param hash receives the hash of the content
+         @return false if the file can't be read or is empty
+         */
+        inline bool hashFile(std::string const& path, std::uint64_t& hash)
+        {
+            MappedFile file;
+            if (!file.open(path))
+            {
+                return false;
+            }
+
+            hash = xxHash64(file.getData(), file.getSize());
+            return true;
+        }
+
+        /*!
+         @brief Tell whether two files have the same content
+
+         Used to confirm that files with the same hash are identical. Both
+         files are memory-mapped; sizes are compared first.
+
+         @param first path of a file
+         @param second path of another file
+         @return false if the contents differ or a file can't be read
+         */
+        inline bool sameContent(std::string const& first, std::string const& second)
+        {
+            MappedFile a, b;
+            if (!a.open(first) || !b.open(second))
+            {
+                return false;
+            }
+
+            return a.getSize() == b.getSize() && std::memcmp(a.getData(), b.getData(), a.getSize()) == 0;
+        }
+    }
+}
+
+#endif // __SFTOOLS_CONTENTHASH_HPP__
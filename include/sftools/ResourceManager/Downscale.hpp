@@ -0,0 +1,136 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file sftools/ResourceManager/Downscale.hpp
+ @brief Defines the box filter used to build low quality tiers of images
+ */
+
+#ifndef __SFTOOLS_DOWNSCALE_HPP__
+#define __SFTOOLS_DOWNSCALE_HPP__
+
+#include <algorithm> // std::max, std::min
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define SFTOOLS_DOWNSCALE_SSE2
+#endif
+
+/*!
+ @namespace sftools
+ @brief Simple and Fast Tools
+ */
+namespace sftools
+{
+    namespace priv
+    {
+        /*!
+         @brief Get the size of an image dimension once halved
+
+         @param size width or height
+         @return half of size, rounded down, but at least 1
+         */
+        inline unsigned halvedSize(unsigned size)
+        {
+            return std::max(size / 2, 1u);
+        }
+
+        /*!
+         @brief Halve the resolution of RGBA pixels with a 2x2 box filter
+
+         Each output pixel is the rounded average of a 2x2 block. With an odd
+         size, the last column or row is dropped; a size of 1 is kept.
+
+         @param src source pixels, `width * height * 4` bytes
+         @param width width of the source
+         @param height height of the source
+         @param dst receives `halvedSize(width) * halvedSize(height) * 4` bytes;
+                    it must not overlap `src`
+         */
+        inline void halveRgba(std::uint8_t const* src, unsigned width, unsigned height, std::uint8_t* dst)
+        {
+            unsigned const outWidth = halvedSize(width);
+            unsigned const outHeight = halvedSize(height);
+            std::size_t const stride = static_cast<std::size_t>(width) * 4;
+
+            for (unsigned y = 0; y < outHeight; ++y)
+            {
+                std::uint8_t const* row0 = src + std::min(2 * y, height - 1) * stride;
+                std::uint8_t const* row1 = src + std::min(2 * y + 1, height - 1) * stride;
+                std::uint8_t* out = dst + static_cast<std::size_t>(y) * outWidth * 4;
+
+                unsigned x = 0;
+
+#ifdef SFTOOLS_DOWNSCALE_SSE2
+                if (width >= 2)
+                {
+                    __m128i const zero = _mm_setzero_si128();
+                    __m128i const two = _mm_set1_epi16(2);
+
+                    // 8 source pixels of two rows -> 4 output pixels
+                    for (; x + 4 <= outWidth; x += 4)
+                    {
+                        __m128i sums[2];
+
+                        for (int half = 0; half < 2; ++half)
+                        {
+                            std::size_t const offset = (static_cast<std::size_t>(x) * 2 + half * 4) * 4;
+                            __m128i const top = _mm_loadu_si128(reinterpret_cast<__m128i const*>(row0 + offset));
+                            __m128i const bottom = _mm_loadu_si128(reinterpret_cast<__m128i const*>(row1 + offset));
+
+                            // Vertical sums, two pixels per register
+                            __m128i const low = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+                            __m128i const high = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+
+                            // Horizontal sums : pixel 0 + 1 and pixel 2 + 3
+                            __m128i const pair0 = _mm_add_epi16(low, _mm_srli_si128(low, 8));
+                            __m128i const pair1 = _mm_add_epi16(high, _mm_srli_si128(high, 8));
+
+                            sums[half] = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(pair0, pair1), two), 2);
+                        }
+
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 4), _mm_packus_epi16(sums[0], sums[1]));
+                    }
+                }
+#endif
+
+                for (; x < outWidth; ++x)
+                {
+                    std::size_t const left = static_cast<std::size_t>(std::min(2 * x, width - 1)) * 4;
+                    std::size_t const right = static_cast<std::size_t>(std::min(2 * x + 1, width - 1)) * 4;
+
+                    for (std::size_t c = 0; c < 4; ++c)
+                    {
+                        unsigned const sum = row0[left + c] + row0[right + c] + row1[left + c] + row1[right + c];
+                        out[x * 4 + c] = static_cast<std::uint8_t>((sum + 2) / 4);
+                    }
+                }
+            }
+        }
+    }
+}
+
+#endif // __SFTOOLS_DOWNSCALE_HPP__
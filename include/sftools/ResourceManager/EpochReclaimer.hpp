@@ -0,0 +1,229 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file sftools/ResourceManager/EpochReclaimer.hpp
+ @brief Defines EpochReclaimer class
+ @note Requires C++11
+ */
+
+#ifndef __SFTOOLS_EPOCHRECLAIMER_HPP__
+#define __SFTOOLS_EPOCHRECLAIMER_HPP__
+
+#include <sftools/Common/NonCopyable.hpp>
+#include <sftools/ResourceManager/Allocator.hpp>
+
+#include <atomic>
+#include <vector>
+#include <utility> // std::pair
+#include <cstddef>
+
+/*!
+ @namespace sftools
+ @brief Simple and Fast Tools
+ */
+namespace sftools
+{
+    namespace priv
+    {
+        /*!
+         @class EpochReclaimer
+         @brief Defer the deletion of objects that readers may still access
+
+         Readers announce themselves with enter() and leave(); both are a
+         couple of atomic operations and never wait. The writer unlinks the
+         objects from the shared structure, hands them over to retire() and
+         regularly calls reclaim() from a safe point. An object is deleted
+         once every reader that could have seen it has left, which takes at
+         least two successful calls to reclaim().
+
+         Reader counters are spread over several cache lines so that readers
+         running on different cores don't contend.
+
+         retire() and reclaim() must be called from a single thread.
+         */
+        class EpochReclaimer : sftools::NonCopyable
+        {
+        public:
+            /*!
+             @brief Identifies a reader between enter() and leave()
+             */
+            struct Token
+            {
+                unsigned int shard; //!< Counter used by the reader
+                unsigned int parity; //!< Epoch of the reader, modulo 2
+            };
+
+            /*!
+             @brief Constructor
+             */
+            EpochReclaimer()
+            : m_epoch(0)
+            {
+                for (unsigned int i = 0; i < ShardCount; ++i)
+                {
+                    m_shards[i].readers[0] = 0;
+                    m_shards[i].readers[1] = 0;
+                }
+            }
+
+            /*!
+             @brief Destructor
+
+             Delete all retired objects; there must be no readers left.
+             */
+            ~EpochReclaimer()
+            {
+                destroy(m_previous);
+                destroy(m_current);
+            }
+
+            /*!
+             @brief Start a read-side critical section
+
+             @return token to be given to leave()
+             */
+            Token enter()
+            {
+                Token token;
+                token.shard = currentShard();
+                token.parity = m_epoch.load() & 1;
+
+                ++m_shards[token.shard].readers[token.parity];
+
+                return token;
+            }
+
+            /*!
+             @brief End a read-side critical section
+
+             @param token value returned by the matching enter()
+             */
+            void leave(Token token)
+            {
+                --m_shards[token.shard].readers[token.parity];
+            }
+
+            /*!
+             @brief Schedule the deletion of an object
+
+             The object must be unreachable for new readers by the time
+             reclaim() is called.
+
+             @param ptr object to be deleted with ResourceAllocator
+             */
+            template <typename T>
+            void retire(T* ptr)
+            {
+                if (ptr)
+                {
+                    m_current.push_back(Retired(ptr, &deleteObject<T>));
+                }
+            }
+
+            /*!
+             @brief Delete the objects no reader can access anymore
+
+             @return number of deleted objects
+             */
+            std::size_t reclaim()
+            {
+                unsigned int const previous = (m_epoch.load() + 1) & 1;
+
+                // Readers from the previous epoch may still use objects
+                // retired before the last call
+                for (unsigned int i = 0; i < ShardCount; ++i)
+                {
+                    if (m_shards[i].readers[previous].load() != 0)
+                    {
+                        return 0;
+                    }
+                }
+
+                std::size_t const count = m_previous.size();
+                destroy(m_previous);
+
+                m_previous.swap(m_current);
+                ++m_epoch;
+
+                return count;
+            }
+
+        private:
+            typedef std::pair<void*, void (*)(void*)> Retired; //!< Object and its deleter
+            typedef std::vector<Retired> RetiredList; //!< Objects waiting for deletion
+
+            static const unsigned int ShardCount = 16; //!< Number of reader counters
+
+            /*!
+             @brief Reader counters of one cache line
+             */
+            struct Shard
+            {
+                std::atomic<std::size_t> readers[2]; //!< Active readers by epoch parity
+                char padding[64 - 2 * sizeof(std::atomic<std::size_t>)]; //!< Avoid false sharing
+            };
+
+            /*!
+             @brief Get the counter used by the calling thread
+
+             @return shard index
+             */
+            static unsigned int currentShard()
+            {
+                static std::atomic<unsigned int> next(0);
+                static thread_local unsigned int shard = next++ % ShardCount;
+                return shard;
+            }
+
+            /*!
+             @brief Delete a retired object of type T
+             */
+            template <typename T>
+            static void deleteObject(void* ptr)
+            {
+                ResourceAllocator<T>::destroy(static_cast<T*>(ptr));
+            }
+
+            /*!
+             @brief Delete all objects of a list and empty it
+             */
+            static void destroy(RetiredList& list)
+            {
+                for (std::size_t i = 0; i < list.size(); ++i)
+                {
+                    list[i].second(list[i].first);
+                }
+                list.clear();
+            }
+
+            Shard m_shards[ShardCount]; //!< Reader counters
+            std::atomic<unsigned int> m_epoch; //!< Current epoch
+            RetiredList m_current; //!< Objects retired during the current epoch
+            RetiredList m_previous; //!< Objects retired during the previous epoch
+        };
+    }
+}
+
+#endif // __SFTOOLS_EPOCHRECLAIMER_HPP__
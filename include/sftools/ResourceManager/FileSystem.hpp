@@ -0,0 +1,430 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file sftools/ResourceManager/FileSystem.hpp
+ @brief Defines a few file system helpers used by the resource managers
+ */
+
+#ifndef __SFTOOLS_FILESYSTEM_HPP__
+#define __SFTOOLS_FILESYSTEM_HPP__
+
+#include <sftools/Common/NonCopyable.hpp>
+
+#include <string>
+#include <set>
+#include <cstddef>
+#include <cstdint>
+
+#ifdef _WIN32
+    // Keep windows.h from defining min/max and most of its other macros in
+    // the user's code; macros we define are undefined afterwards
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+        #define SFTOOLS_UNDEF_WIN32_LEAN_AND_MEAN
+    #endif
+    #ifndef NOMINMAX
+        #define NOMINMAX
+        #define SFTOOLS_UNDEF_NOMINMAX
+    #endif
+    #include <windows.h>
+    #ifdef SFTOOLS_UNDEF_WIN32_LEAN_AND_MEAN
+        #undef WIN32_LEAN_AND_MEAN
+        #undef SFTOOLS_UNDEF_WIN32_LEAN_AND_MEAN
+    #endif
+    #ifdef SFTOOLS_UNDEF_NOMINMAX
+        #undef NOMINMAX
+        #undef SFTOOLS_UNDEF_NOMINMAX
+    #endif
+#else
+    #include <dirent.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+/*!
+ @namespace sftools
+ @brief Simple and Fast Tools
+ */
+namespace sftools
+{
+    namespace priv
+    {
+        /*!
+         @brief Split a path into its directory and file name
+
+         @param path path to split
+         @param directory set to the directory part, "." if there is none
+         @param name set to the file name part
+         */
+        inline void splitPath(std::string const& path, std::string& directory, std::string& name)
+        {
+            std::string::size_type const slash = path.find_last_of("/\\");
+
+            if (slash == std::string::npos)
+            {
+                directory = ".";
+                name = path;
+            }
+            else
+            {
+                // assign() reuses the capacity of the strings
+                directory.assign(path, 0, slash == 0 ? 1 : slash);
+                name.assign(path, slash + 1, std::string::npos);
+            }
+        }
+
+        /*!
+         @brief List the regular files of a directory
+
+         Sub-directories are not visited.
+
+         @param directory directory to list
+         @param names receives the names of the files
+         @param directories if not null, receives the names of the
+                            sub-directories (except "." and "..")
+         @return false if the directory could not be read
+         */
+        inline bool listFiles(std::string const& directory, std::set<std::string>& names,
+                              std::set<std::string>* directories = 0)
+        {
+#ifdef _WIN32
+            WIN32_FIND_DATAA data;
+            HANDLE handle = FindFirstFileA((directory + "\\*").c_str(), &data);
+            if (handle == INVALID_HANDLE_VALUE)
+            {
+                return false;
+            }
+
+            do
+            {
+                std::string const name = data.cFileName;
+
+                if (!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+                {
+                    names.insert(name);
+                }
+                else if (directories && name != "." && name != "..")
+                {
+                    directories->insert(name);
+                }
+            }
+            while (FindNextFileA(handle, &data));
+
+            FindClose(handle);
+            return true;
+#else
+            DIR* dir = opendir(directory.c_str());
+            if (!dir)
+            {
+                return false;
+            }
+
+            while (dirent* entry = readdir(dir))
+            {
+                std::string const name = entry->d_name;
+                bool regular = entry->d_type == DT_REG;
+                bool folder = entry->d_type == DT_DIR;
+
+                if (entry->d_type == DT_LNK || entry->d_type == DT_UNKNOWN)
+                {
+                    // Follow symbolic links and handle file systems that don't
+                    // fill d_type.
+                    struct stat info;
+                    if (stat((directory + "/" + name).c_str(), &info) == 0)
+                    {
+                        regular = S_ISREG(info.st_mode);
+                        folder = S_ISDIR(info.st_mode);
+                    }
+                }
+
+                if (regular)
+                {
+                    names.insert(name);
+                }
+                else if (folder && directories && name != "." && name != "..")
+                {
+                    directories->insert(name);
+                }
+            }
+
+            closedir(dir);
+            return true;
+#endif
+        }
+
+        /*!
+         @brief List the regular files of a directory and its sub-directories
+
+         @param directory directory to list
+         @param paths receives the paths of the files, relative to `directory`
+                      and using `/` as separator
+         @param prefix prepended to every path; used for recursion
+         @return false if `directory` could not be read
+         */
+        inline bool listFilesRecursively(std::string const& directory, std::set<std::string>& paths,
+                                         std::string const& prefix = "")
+        {
+            std::set<std::string> names, directories;
+            if (!listFiles(directory, names, &directories))
+            {
+                return false;
+            }
+
+            for (std::set<std::string>::const_iterator it = names.begin(); it != names.end(); ++it)
+            {
+                paths.insert(prefix + *it);
+            }
+
+            for (std::set<std::string>::const_iterator it = directories.begin(); it != directories.end(); ++it)
+            {
+                listFilesRecursively(directory + "/" + *it, paths, prefix + *it + "/");
+            }
+
+            return true;
+        }
+
+        /*!
+         @brief Tell whether a regular file exists
+
+         @param path file to look for
+         @return true if `path` is a regular file
+         */
+        inline bool isFile(std::string const& path)
+        {
+#ifdef _WIN32
+            DWORD const attributes = GetFileAttributesA(path.c_str());
+            return attributes != INVALID_FILE_ATTRIBUTES && !(attributes & FILE_ATTRIBUTE_DIRECTORY);
+#else
+            struct stat info;
+            return stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode);
+#endif
+        }
+
+        /*!
+         @brief Get the modification time, size and identity of a file
+
+         The modification time has the best resolution the system offers, so
+         that a file rewritten within the same second is noticed; the
+         identity tells apart a file replaced by another one (e.g. renamed
+         over it) that has the same time and size.
+
+         @param path file to inspect
+         @param modified receives the modification time, in nanoseconds since
+                         the epoch on POSIX systems and in 100ns units on
+                         Windows
+         @param size receives the size in bytes
+         @param identity receives the inode, or the file index on Windows
+         @return false if the file doesn't exist
+         */
+        inline bool getFileInfo(std::string const& path, std::int64_t& modified, std::uint64_t& size,
+                                std::uint64_t& identity)
+        {
+#ifdef _WIN32
+            HANDLE file = CreateFileA(path.c_str(), FILE_READ_ATTRIBUTES,
+                                      FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, 0,
+                                      OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+            if (file == INVALID_HANDLE_VALUE)
+            {
+                return false;
+            }
+
+            BY_HANDLE_FILE_INFORMATION data;
+            bool const success = GetFileInformationByHandle(file, &data) != 0;
+            CloseHandle(file);
+
+            if (!success || (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+            {
+                return false;
+            }
+
+            modified = (static_cast<std::int64_t>(data.ftLastWriteTime.dwHighDateTime) << 32)
+                       | data.ftLastWriteTime.dwLowDateTime;
+            size = (static_cast<std::uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+            identity = (static_cast<std::uint64_t>(data.nFileIndexHigh) << 32) | data.nFileIndexLow;
+#else
+            struct stat info;
+            if (stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode))
+            {
+                return false;
+            }
+
+    #ifdef __APPLE__
+            timespec const& time = info.st_mtimespec;
+    #else
+            timespec const& time = info.st_mtim;
+    #endif
+            modified = static_cast<std::int64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+            size = static_cast<std::uint64_t>(info.st_size);
+            identity = static_cast<std::uint64_t>(info.st_ino);
+#endif
+            return true;
+        }
+
+        /*!
+         @class MappedFile
+         @brief Read-only memory mapping of a whole file
+         */
+        class MappedFile : sftools::NonCopyable
+        {
+        public:
+            /*!
+             @brief Default constructor
+             */
+            MappedFile()
+            : m_data(0)
+            , m_size(0)
+#ifdef _WIN32
+            , m_mapping(0)
+#endif
+            {
+                // Nothing mapped yet
+            }
+
+            /*!
+             @brief Destructor; unmap the file
+             */
+            ~MappedFile()
+            {
+                close();
+            }
+
+            /*!
+             @brief Map a file, unmapping the previous one if any
+
+             @param path file to map
+             @return false if the file could not be mapped
+             */
+            bool open(std::string const& path)
+            {
+                close();
+
+#ifdef _WIN32
+                HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, 0,
+                                          OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+                if (file == INVALID_HANDLE_VALUE)
+                {
+                    return false;
+                }
+
+                LARGE_INTEGER size;
+                if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+                {
+                    m_mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+                    if (m_mapping)
+                    {
+                        m_data = static_cast<char const*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+                        m_size = static_cast<std::size_t>(size.QuadPart);
+                    }
+                }
+
+                CloseHandle(file);
+#else
+                int file = ::open(path.c_str(), O_RDONLY);
+                if (file < 0)
+                {
+                    return false;
+                }
+
+                struct stat info;
+                if (fstat(file, &info) == 0 && info.st_size > 0)
+                {
+                    void* data = mmap(0, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+                    if (data != MAP_FAILED)
+                    {
+                        m_data = static_cast<char const*>(data);
+                        m_size = static_cast<std::size_t>(info.st_size);
+                    }
+                }
+
+                ::close(file);
+#endif
+
+                if (!m_data)
+                {
+                    close();
+                    return false;
+                }
+
+                return true;
+            }
+
+            /*!
+             @brief Unmap the file, if any
+             */
+            void close()
+            {
+#ifdef _WIN32
+                if (m_data)
+                {
+                    UnmapViewOfFile(m_data);
+                }
+                if (m_mapping)
+                {
+                    CloseHandle(m_mapping);
+                    m_mapping = 0;
+                }
+#else
+                if (m_data)
+                {
+                    munmap(const_cast<char*>(m_data), m_size);
+                }
+#endif
+                m_data = 0;
+                m_size = 0;
+            }
+
+            /*!
+             @brief Get the mapped content
+
+             @return pointer to the first byte, or 0 if nothing is mapped
+             */
+            char const* getData() const
+            {
+                return m_data;
+            }
+
+            /*!
+             @brief Get the size of the mapped file
+
+             @return size in bytes
+             */
+            std::size_t getSize() const
+            {
+                return m_size;
+            }
+
+        private:
+            char const* m_data; //!< mapped content
+            std::size_t m_size; //!< size of the mapping
+#ifdef _WIN32
+            HANDLE m_mapping; //!< file mapping object
+#endif
+        };
+    }
+}
+
+#endif // __SFTOOLS_FILESYSTEM_HPP__
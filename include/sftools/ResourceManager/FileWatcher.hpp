@@ -0,0 +1,210 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file sftools/ResourceManager/FileWatcher.hpp
+ @brief Defines FileWatcher class
+ @note Requires C++11
+ */
+
+#ifndef __SFTOOLS_FILEWATCHER_HPP__
+#define __SFTOOLS_FILEWATCHER_HPP__
+
+#include <sftools/Common/NonCopyable.hpp>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+
+#ifdef __linux__
+    #include <sys/inotify.h>
+    #include <poll.h>
+    #include <unistd.h>
+    #include <cerrno>
+#else
+    #include <thread>
+    #include <chrono>
+#endif
+
+/*!
+ @namespace sftools
+ @brief Simple and Fast Tools
+ */
+namespace sftools
+{
+    namespace priv
+    {
+        /*!
+         @class FileWatcher
+         @brief Report files written in a set of directories
+
+         On Linux it is based on inotify. On other systems watch() always
+         fails and no change is ever reported.
+
+         watch() and waitForChanges() can be called from different threads.
+         */
+        class FileWatcher : sftools::NonCopyable
+        {
+        public:
+            /*!
+             @brief Constructor
+             */
+            FileWatcher()
+#ifdef __linux__
+            : m_fd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+#endif
+            {
+                // That's it
+            }
+
+            /*!
+             @brief Destructor
+             */
+            ~FileWatcher()
+            {
+#ifdef __linux__
+                if (m_fd >= 0)
+                {
+                    close(m_fd);
+                }
+#endif
+            }
+
+            /*!
+             @brief Tell if file watching is available on this system
+
+             @return true if changes can be reported
+             */
+            bool isSupported() const
+            {
+#ifdef __linux__
+                return m_fd >= 0;
+#else
+                return false;
+#endif
+            }
+
+            /*!
+             @brief Start watching a directory
+
+             Sub-directories are not watched. Watching a directory twice has
+             no effect.
+
+             @param directory directory to watch
+             @return false if the directory can't be watched
+             */
+            bool watch(std::string const& directory)
+            {
+#ifdef __linux__
+                std::lock_guard<std::mutex> lock(m_mutex);
+
+                if (m_fd < 0)
+                {
+                    return false;
+                }
+
+                int const wd = inotify_add_watch(m_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+                if (wd < 0)
+                {
+                    return false;
+                }
+
+                m_directories[wd] = directory;
+                return true;
+#else
+                (void)directory;
+                return false;
+#endif
+            }
+
+            /*!
+             @brief Wait for files to be written
+
+             @param paths receives the paths of the files written, as
+                          `directory + "/" + name`
+             @param timeout maximum time to wait, in milliseconds
+             @return true if at least one change was reported
+             */
+            bool waitForChanges(std::vector<std::string>& paths, int timeout)
+            {
+#ifdef __linux__
+                if (m_fd < 0)
+                {
+                    return false;
+                }
+
+                pollfd descriptor = { m_fd, POLLIN, 0 };
+                if (::poll(&descriptor, 1, timeout) <= 0)
+                {
+                    return false;
+                }
+
+                // Events are variable-sized but aligned as inotify_event
+                alignas(inotify_event) char buffer[4096];
+                std::size_t const before = paths.size();
+
+                for (;;)
+                {
+                    ssize_t const length = read(m_fd, buffer, sizeof(buffer));
+                    if (length <= 0)
+                    {
+                        break; // EAGAIN : everything was read
+                    }
+
+                    std::lock_guard<std::mutex> lock(m_mutex);
+
+                    for (char* ptr = buffer; ptr < buffer + length; )
+                    {
+                        inotify_event const* event = reinterpret_cast<inotify_event const*>(ptr);
+
+                        std::map<int, std::string>::const_iterator it = m_directories.find(event->wd);
+                        if (it != m_directories.end() && event->len > 0)
+                        {
+                            paths.push_back(it->second + "/" + event->name);
+                        }
+
+                        ptr += sizeof(inotify_event) + event->len;
+                    }
+                }
+
+                return paths.size() > before;
+#else
+                (void)paths;
+                std::this_thread::sleep_for(std::chrono::milliseconds(timeout));
+                return false;
+#endif
+            }
+
+        private:
+#ifdef __linux__
+            int m_fd; //!< inotify instance
+            std::map<int, std::string> m_directories; //!< watch descriptor -> directory
+            std::mutex m_mutex; //!< protects m_directories
+#endif
+        };
+    }
+}
+
+#endif // __SFTOOLS_FILEWATCHER_HPP__
@@ -30,10 +30,40 @@
 #ifndef __SFTOOLS_GENERICMANAGERS_HPP__
 #define __SFTOOLS_GENERICMANAGERS_HPP__
 
+#include <sftools/ResourceManager/Storage.hpp>
+#include <sftools/ResourceManager/ResourceSize.hpp>
+#include <sftools/ResourceManager/ResourceCompressor.hpp>
+#include <sftools/ResourceManager/Placeholder.hpp>
+#include <sftools/ResourceManager/Allocator.hpp>
+#include <sftools/ResourceManager/LoaderTraits.hpp>
+#include <sftools/ResourceManager/LoadHandle.hpp>
+#include <sftools/ResourceManager/LoadProgress.hpp>
+#include <sftools/ResourceManager/ThreadPool.hpp>
+#include <sftools/ResourceManager/FileWatcher.hpp>
+#include <sftools/ResourceManager/EpochReclaimer.hpp>
+#include <sftools/ResourceManager/Telemetry.hpp>
+#include <sftools/ResourceManager/Locations.hpp>
+#include <sftools/ResourceManager/ContentHash.hpp>
+#include <sftools/ResourceManager/Handle.hpp>
+#include <sftools/ResourceManager/Ref.hpp>
+#include <sftools/ResourceManager/Manifest.hpp>
 #include <SFML/System/NonCopyable.hpp>
+#include <SFML/System/Time.hpp>
+#include <SFML/System/Clock.hpp>
 #include <string>
 #include <map>
-#include <functional> // std::less
+#include <list>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <utility> // std::pair
+#include <vector>
+#include <cstdint>
+#include <functional> // std::less, std::function
+#include <type_traits> // std::enable_if
 
 /*!
  @namespace sftools
@@ -46,16 +76,52 @@ namespace sftools
     /*!
      @brief A generic resource manager ready to be customized
      
-     Resource objects are stored in a `std::map<Id, Resource*>`.
+     Resource objects are stored in a `Storage<Id, Resource*>`. By default
+     this is a `std::map`; use storage::Hash for large managers whose ids
+     are hashable, or storage::Dense when ids are small integers or enum
+     values. See the sftools::storage namespace for the requirements of
+     custom storage policies.
+
+     Resources accessed often can be referred to by a Handle instead of
+     their id; see getHandle(). To unload resources once nothing uses them
+     anymore, share them through reference-counted Refs; see acquire().
+
+     A memory budget can be given to the manager with setMemoryBudget(); the
+     least recently used resources are then evicted when the budget is
+     exceeded and transparently reloaded when they are fetched again.
+     Resources left unused for a while can also be kept compressed in
+     memory; see setColdCompression().
+
+     Reloading a resource, either with `load(id, true)` or through hot
+     reloading (see enableHotReload()), keeps its address when `OnLoad`
+     defines `commitInto()` (as the loaders of sftools do), so references
+     handed out before remain valid. Every change of a resource increments
+     its generation; see getGeneration().
 
      `OnLoad` type must have an operator `()` taking an `Id` as unique parameter
      and returning a pointer to `Resource` (or 0 if loading failed).
+     Resources are destroyed with ResourceAllocator<Resource>, so they must
+     be created with it; see ResourceAllocator to store them in slabs.
+
+     Resources can also be loaded in the background with loadAsync(). In that
+     case `OnLoad` is used from worker threads and must therefore be
+     thread-safe. If `OnLoad` defines a `Staged` type together with `stage()`
+     and `commit()` methods, only `stage()` runs on the workers; see
+     loader::ResourceLoader.
+
+     Other threads can read resources while the manager is being modified
+     once enableConcurrentReads() was called; see Reader.
+
+     Resources used by a scene can be gathered in named groups, which are
+     prefetched and released as a whole; see addToGroup().
      
      @tparam Resource   Type of the resource to manage
      @tparam Id         Type of resources' identifiers
      @tparam OnLoad     Procedure type to load resources
+     @tparam Storage    Storage policy for the resources
      */
-    template <typename Resource, typename Id, typename OnLoad>
+    template <typename Resource, typename Id, typename OnLoad,
+              template <typename, typename> class Storage = storage::Map>
     class GenericManager : NonCopyable
     {
     public:
@@ -64,8 +130,20 @@ namespace sftools
          */
         GenericManager();
 
+        /*!
+         @brief Destructor
+
+         Pending asynchronous loads are cancelled and all resources unloaded.
+         */
+        ~GenericManager();
+
         /*!
          @brief Load a new resource
+
+         When `forceReload` is true and the resource is already loaded, its
+         content is replaced in place if `OnLoad` supports it. If reloading
+         fails, the previous content is kept. Resources are not reloaded
+         once concurrent reads are enabled; false is returned instead.
          
          @param id id of the resource to load
          @param forceReload ensure the resource is (re)loaded
@@ -75,8 +153,223 @@ namespace sftools
          */
         bool load(Id const& id, bool forceReload = false);
 
+        /*!
+         @brief Load a resource in the background
+
+         The resource is decoded by a worker thread and becomes available
+         once poll() or wait() has committed it. Requesting a resource that
+         is already loaded or being loaded doesn't start a new load.
+
+         @param id id of the resource to load
+         @param priority loads with higher priorities are started first
+         @return a handle to track the progress of the load
+
+         @see poll
+         @see wait
+         */
+        LoadHandle loadAsync(Id const& id, int priority = 0);
+
+        /*!
+         @brief Load a batch of resources in the background
+
+         Each resource is loaded as with loadAsync() by the worker threads,
+         so poll() must be called for the batch to complete. A resource
+         already being loaded keeps the priority of its first request.
+
+         When `OnLoad` can locate the data of the resources (see
+         loader::ResourceLoader::locate), the batch is loaded in the order
+         the data is stored on disk rather than in the order of the ids,
+         and the system is asked to read it ahead of the decoders. Loaders
+         such as loader::LoadFromBatch read the whole batch themselves.
+         Loads of lower quality tiers are not read ahead.
+
+         @code
+
+         std::vector<std::string> const level = { "tiles.png", "hero.png" };
+         sftools::LoadProgress progress = manager.preload(level.begin(), level.end(), 1);
+
+         @endcode
+
+         @param first first id of the batch
+         @param last end of the batch
+         @param priority batches with higher priorities are started first
+         @return lock-free counters to track the progress of the batch
+
+         @see LoadProgress
+         */
+        template <typename Iterator>
+        LoadProgress preload(Iterator first, Iterator last, int priority = 0);
+
+        /*!
+         @brief Load a batch of resources in the background
+
+         @param ids range of ids, such as a container
+         @param priority batches with higher priorities are started first
+         @return lock-free counters to track the progress of the batch
+
+         @see preload(Iterator, Iterator, int)
+         */
+        template <typename Range>
+        LoadProgress preload(Range const& ids, int priority = 0);
+
+        /*!
+         @brief Add a resource to a group
+
+         Groups gather the resources of a scene or a level so they can be
+         loaded and released together. A resource can belong to several
+         groups; it is unloaded when the last of them is released.
+         Adding a resource twice to the same group has no effect.
+
+         @code
+
+         manager.addToGroup("level2", level2.begin(), level2.end());
+         sftools::LoadProgress progress = manager.prefetchGroup("level2");
+         // ... play level 1 until progress.isDone() ...
+         manager.releaseGroup("level1"); // keeps the assets shared with level 2
+
+         @endcode
+
+         @param group name of the group, created if needed
+         @param id id of the resource; it doesn't have to be loaded
+
+         @see prefetchGroup
+         @see releaseGroup
+         */
+        void addToGroup(std::string const& group, Id const& id);
+
+        /*!
+         @brief Add resources to a group
+
+         @param group name of the group, created if needed
+         @param first first id to add
+         @param last end of the ids
+
+         @see addToGroup(std::string const&, Id const&)
+         */
+        template <typename Iterator>
+        void addToGroup(std::string const& group, Iterator first, Iterator last);
+
+        /*!
+         @brief Load the resources of a group in the background
+
+         Resources already loaded, e.g. because they are shared with
+         another group, are not loaded again.
+
+         @param group name of the group
+         @param priority batches with higher priorities are started first
+         @return lock-free counters to track the progress of the group; an
+                 unknown group is an empty batch
+
+         @see preload
+         */
+        LoadProgress prefetchGroup(std::string const& group, int priority = 0);
+
+        /*!
+         @brief Release the resources of a group and forget the group
+
+         Resources that belong to no other group are unloaded, unless they
+         are pinned; resources that were loaded without being added to any
+         group are not affected. Resources still used by Refs are unloaded
+         by applyReleases() once their last Ref is dropped.
+
+         Loads of these resources still in progress, e.g. started by
+         prefetchGroup(), are cancelled : poll() drops them and they count
+         as failed in their LoadHandle and LoadProgress. Loading them again
+         with loadAsync() or preload() before that keeps them.
+
+         @param group name of the group
+         */
+        void releaseGroup(std::string const& group);
+
+        /*!
+         @brief Record the first access to each resource from now on
+
+         Loading or fetching a resource counts as an access; preloads don't.
+         The previous recording is discarded. Save the recording with
+         saveManifest() and replay it at the next launch with
+         replayManifest() to load the resources before they are needed.
+
+         @see stopRecording
+         */
+        void startRecording();
+
+        /*!
+         @brief Stop recording accesses; the recording is kept
+         */
+        void stopRecording();
+
+        /*!
+         @brief Write the recorded accesses to a manifest file
+
+         The file lists the ids in the order of their first access, with
+         the time of the access. Ids are written with ManifestKey<Id>.
+
+         @param path file to write
+         @return false if the file couldn't be written
+         */
+        bool saveManifest(std::string const& path) const;
+
+        /*!
+         @brief Load the resources of a manifest file in the background
+
+         The resources are loaded as with preload(), but in the order in
+         which they were first accessed when the manifest was recorded.
+
+         @param path manifest written by saveManifest()
+         @param priority batches with higher priorities are started first
+         @return lock-free counters to track the progress of the batch; an
+                 empty batch if the file can't be read
+
+         @see preload
+         */
+        LoadProgress replayManifest(std::string const& path, int priority = 0);
+
+        /*!
+         @brief Commit the resources decoded in the background
+
+         This must be called regularly (e.g. once per frame) from the thread
+         owning the manager; for sf::Texture it is where the upload to the
+         graphics card happens.
+
+         It also unloads the resources whose last Ref was dropped, see
+         applyReleases(), and compresses idle resources, see compressIdle().
+
+         @param budget stop once this much time has been spent committing
+                       resources; zero means no limit
+         @return the number of asynchronous loads completed by this call
+
+         @see loadAsync
+         */
+        std::size_t poll(sf::Time budget = sf::Time::Zero);
+
+        /*!
+         @brief Block until all asynchronous loads are over
+
+         @see loadAsync
+         */
+        void wait();
+
+        /*!
+         @brief Set the number of worker threads of the asynchronous loads
+
+         Several managers each have their own workers, so an application
+         using many managers may want fewer workers per manager than the
+         default of one per hardware thread.
+
+         If workers were already started, the pending loads are awaited as
+         with wait() and the workers are replaced the next time a resource
+         is loaded in the background.
+
+         @param count number of workers; 0 means one per hardware thread
+         */
+        void setWorkerCount(unsigned int count);
+
         /*!
          @brief Unload a resource
+
+         A resource still used by Refs stays valid until the last of them
+         is dropped; applyReleases() then unloads it. Loading it again in
+         the meantime, or pinning it, cancels the unload.
          
          @param id id of the resource to unload
          */
@@ -84,13 +377,351 @@ namespace sftools
         
         /*!
          @brief Unload all resources
+
+         As with unload(), the resources still used by Refs are only
+         unloaded by applyReleases() once their last Ref is dropped.
          */
         void unloadAll();
 
         /*!
-         @brief Fetch a resource
+         @brief Set the memory budget of the manager
 
-         A `std::invalid_argument` exception is thrown if `id` doesn't exist.
+         When the estimated size of the loaded resources exceeds the budget,
+         the least recently used resources are unloaded until the manager fits
+         in its budget again. Evicted resources are reloaded transparently the
+         next time they are fetched; pinned resources and the most recently
+         used one are never evicted.
+
+         Sizes are estimated with ResourceSize.
+
+         @note Evicting a resource invalidates the references to it; pin the
+               resources whose address must not change.
+
+         @param bytes budget in bytes; 0 means unlimited, which is the default
+
+         @see pin
+         */
+        void setMemoryBudget(std::size_t bytes);
+
+        /*!
+         @brief Get the memory budget of the manager
+
+         @return budget in bytes; 0 means unlimited
+
+         @see setMemoryBudget
+         */
+        std::size_t getMemoryBudget() const;
+
+        /*!
+         @brief Get the estimated size of the loaded resources
+
+         @return estimated size in bytes
+
+         @see setMemoryBudget
+         */
+        std::size_t getMemoryUsage() const;
+
+        /*!
+         @brief Load lower quality tiers when the memory budget is nearly
+                reached
+
+         Once 3/4 of the memory budget is used, resources are loaded one
+         quality tier below the one selected with Locations::setQuality();
+         once the budget is reached, `tiers` below. Resources already
+         loaded are not affected.
+
+         Only loaders supporting quality tiers, such as those of sf::Image
+         and sf::Texture, are concerned.
+
+         @param tiers maximum number of tiers dropped; 0 disables adaptive
+                      quality, which is the default
+
+         @see Locations::setTierPrefix
+         */
+        void setAdaptiveQuality(unsigned tiers);
+
+        /*!
+         @brief Compress the resources that are not used for a while
+
+         Resources that were not fetched for `delay` are compressed in
+         memory by compressIdle(), which poll() calls, and deleted; the
+         next time they are fetched, they are decompressed instead of
+         being loaded again. This suits large resources used rarely, such
+         as cutscene frames or ambient sounds.
+
+         Resources are compressed with ResourceCompressor, which supports
+         sf::Image and sf::SoundBuffer. Pinned and deduplicated resources
+         are not compressed, nor are those that would not get smaller;
+         these are not tried again until they are reloaded. Compressed
+         resources don't count against the memory budget; their size is
+         reported in ManagerStats::compressedBytes.
+
+         @note Compressing a resource invalidates the references to it, as
+               evicting it does.
+
+         @param delay time without access before a resource is compressed;
+                      zero disables compression, which is the default
+         @param budget time compressIdle() may spend per call, so that
+                       many resources going idle at once don't stall a
+                       frame; zero means no limit
+
+         @see compressIdle
+         */
+        void setColdCompression(sf::Time delay, sf::Time budget = sf::milliseconds(1));
+
+        /*!
+         @brief Compress the resources that are not used for a while
+
+         At least one resource is tried per call, whatever the budget
+         given to setColdCompression(); the others wait for the next calls.
+
+         @return the number of resources compressed by this call
+
+         @see setColdCompression
+         */
+        std::size_t compressIdle();
+
+        /*!
+         @brief Get the memory saved by compressing idle resources
+
+         Unlike ManagerStats::reclaimedBytes, it is available when
+         `SFTOOLS_NO_TELEMETRY` is defined.
+
+         @return size of the compressed resources minus the size of their
+                 compressed data, in bytes
+
+         @see setColdCompression
+         */
+        std::size_t getReclaimedBytes() const;
+
+        /*!
+         @brief Prevent a resource from being evicted
+
+         The resource is reloaded first if it was evicted.
+
+         @param id id of the resource to pin
+
+         @throw std::invalid_argument if `id` was never loaded
+
+         @see unpin
+         */
+        void pin(Id const& id);
+
+        /*!
+         @brief Allow a pinned resource to be evicted again
+
+         Resources used by Refs stay pinned until their last Ref is dropped.
+
+         @param id id of the resource to unpin
+
+         @see pin
+         */
+        void unpin(Id const& id);
+
+        /*!
+         @brief Return placeholders instead of throwing on unloaded resources
+
+         From now on, fetching a resource that is not loaded (or was
+         evicted) with operator[] returns a placeholder created by
+         Placeholder<Resource> and starts loading the resource in the
+         background; once poll() has committed it, operator[] returns the
+         real resource. Resources that fail to load keep being replaced by
+         the placeholder until they are loaded explicitly with load().
+
+         @note The placeholder is shared by all missing resources; don't
+               modify it.
+
+         @see isReady
+         */
+        void enablePlaceholders();
+
+        /*!
+         @brief Tell if a resource can be fetched without a placeholder
+
+         @param id id of the resource
+         @return true if the resource is loaded and not evicted
+         */
+        bool isReady(Id const& id) const;
+
+        /*!
+         @brief Remember the resources that failed to load
+
+         Once a resource failed to load, load(), loadAsync() and preload()
+         fail immediately for it, without calling `OnLoad`, until `duration`
+         has elapsed or singleton::ResourceLocations changed (see
+         Locations::getVersion()). When hot reloading is enabled, files
+         created in the watched directories refresh ResourceLocations too.
+
+         The failures answered this way are counted in
+         ManagerStats::suppressedLoads.
+
+         @param duration how long a failure is remembered; zero disables the
+                         negative cache, which is the default
+         */
+        void setNegativeCacheDuration(sf::Time duration);
+
+        /*!
+         @brief Share one resource between ids whose files are identical
+
+         From now on, the file of a resource, as resolved by
+         singleton::ResourceLocations, is hashed with xxHash before being
+         decoded. When a resident resource was loaded from a file with the
+         same hash, the two files are compared byte for byte and, if they
+         are identical, the resource is shared instead of being decoded
+         again; it is
+         deleted once every id sharing it is unloaded. The memory saved is
+         reported in ManagerStats::deduplicatedBytes.
+
+         `Id` must be convertible to std::string. Call this method before
+         loading resources.
+
+         @note Modifying a shared resource through operator[] modifies it
+               for every id sharing it. Reloading a resource still shared
+               with other ids gives it its own copy instead of updating it
+               in place; references obtained before keep the shared
+               content.
+         */
+        void enableDeduplication();
+
+        /*!
+         @brief Get the activity counters of the manager
+
+         Can be called from any thread. When SFTOOLS_NO_TELEMETRY is
+         defined, all counters are zero.
+
+         @code
+
+         std::cout << manager.getStats().toJson() << std::endl;
+
+         @endcode
+
+         @return a snapshot of the counters
+         */
+        ManagerStats getStats() const;
+
+        /*!
+         @brief Watch the files of the loaded resources
+
+         A background thread watches the directories holding the files of
+         the resources, as resolved by singleton::ResourceLocations. When a
+         file is written, the thread decodes it; the new content is swapped
+         into the existing resource by applyReloads().
+
+         `Id` must be convertible to std::string.
+
+         @note Only supported on Linux, where it uses inotify. Not available
+               once concurrent reads are enabled: Readers may be using the
+               content being replaced.
+
+         @return false if hot reloading is not supported
+
+         @see applyReloads
+         @see disableHotReload
+         */
+        bool enableHotReload();
+
+        /*!
+         @brief Stop watching the files of the resources
+
+         Reloads that were decoded but not applied are dropped.
+
+         @see enableHotReload
+         */
+        void disableHotReload();
+
+        /*!
+         @brief Apply the reloads decoded in the background
+
+         Call this at a point where resources can safely change (e.g.
+         between two frames), from the thread owning the manager.
+
+         @return the number of resources updated
+
+         @see enableHotReload
+         */
+        std::size_t applyReloads();
+
+        /*!
+         @brief Get the generation of a resource
+
+         The generation is incremented every time the resource is (re)loaded,
+         so caches derived from a resource can cheaply detect changes.
+
+         @param id id of the resource
+         @return generation of the resource, 0 if it was never loaded
+         */
+        unsigned long getGeneration(Id const& id) const;
+
+        /*!
+         @brief Get a reference-counted access to a resource
+
+         The resource is loaded if needed and pinned while Refs to it
+         exist. Once the last Ref is destroyed, from any thread, the next
+         call to applyReleases() unloads the resource, or only unpins it if
+         it belongs to a group. Resources pinned with pin() stay loaded.
+
+         @param id id of the resource
+         @return a Ref to the resource
+
+         @throw std::invalid_argument if the resource can't be loaded
+
+         @see Ref
+         */
+        Ref<Resource> acquire(Id const& id);
+
+        /*!
+         @brief Unload the resources whose last Ref was dropped
+
+         Call this at a point where resources can safely be unloaded, from
+         the thread owning the manager; poll() does it. Releases are
+         batched: dropping a Ref only pushes its resource on a lock-free
+         queue.
+
+         @return the number of resources unloaded
+
+         @see acquire
+         */
+        std::size_t applyReleases();
+
+        /*!
+         @brief Allow other threads to read resources through Reader
+
+         From now on, the manager publishes an immutable snapshot of its
+         resources to the Readers, and the deletion of resources is deferred
+         until no Reader can access them anymore. The snapshot is rebuilt by
+         reclaim(), so resources loaded since the last call only become
+         visible to Readers at the next one.
+
+         Readers may be using any resource, so resources are no longer
+         reloaded: hot reloading is disabled and `load(id, true)` fails for
+         resident resources.
+
+         Resources are only reclaimed by reclaim(), which poll() calls.
+
+         @note The manager itself must still be used from a single thread.
+
+         @see Reader
+         */
+        void enableConcurrentReads();
+
+        /*!
+         @brief Delete the resources that Readers can no longer access
+
+         Call this regularly from the thread owning the manager; poll()
+         does it. It also publishes the resources loaded since the last
+         call to the Readers. It never waits for readers.
+
+         @see enableConcurrentReads
+         */
+        void reclaim();
+
+        /*!
+         @brief Look up a resident resource
+
+         Unlike the non-const version, nothing is loaded, recorded or
+         marked as used : a `std::invalid_argument` exception is thrown if
+         the resource isn't resident, or the placeholder is returned when
+         placeholders are enabled; see enablePlaceholders().
 
          @param id the id of the resource to be fetched
          @return the resource corresponding to `id`
@@ -103,6 +734,10 @@ namespace sftools
          @brief Fetch a resource
 
          A `std::invalid_argument` exception is thrown if `id` doesn't exist.
+         If the resource was evicted, it is loaded again first.
+
+         When placeholders are enabled, a placeholder is returned instead;
+         see enablePlaceholders().
 
          @param id the id of the resource to be fetched
          @return the resource corresponding to `id`
@@ -111,17 +746,653 @@ namespace sftools
          */
         Resource& operator[](Id const& id);
 
+        /*!
+         @brief Look up a resident resource from a string that isn't an `Id`
+
+         Only available when `Id` is std::string : `Key` can be
+         `char const*`, a string literal or, with C++17,
+         `std::string_view`. Fetching a loaded resource doesn't allocate
+         memory with storage::Hash, and with storage::Map from C++14 on.
+
+         @param id the id of the resource to be fetched
+         @return the resource corresponding to `id`
+
+         @throw std::invalid_argument
+
+         @see operator[](Id const&) const
+         */
+        template <typename Key>
+        typename std::enable_if<priv::IsStringKey<Id, Key>::value, Resource const&>::type
+        operator[](Key const& id) const;
+
+        /*!
+         @brief Fetch a resource from a string that isn't an `Id`
+
+         @param id the id of the resource to be fetched
+         @return the resource corresponding to `id`
+
+         @throw std::invalid_argument
+
+         @see operator[](Id const&)
+         */
+        template <typename Key>
+        typename std::enable_if<priv::IsStringKey<Id, Key>::value, Resource&>::type
+        operator[](Key const& id);
+
+        /*!
+         @brief Get a handle to a resource
+
+         The handle stays valid until the resource is unloaded, including
+         while it is evicted or after it was reloaded. Getting the handle of
+         a resource twice returns the same handle.
+
+         A `std::invalid_argument` exception is thrown if `id` doesn't exist.
+         If the resource was evicted, it is loaded again first.
+
+         @param id id of a loaded resource
+         @return a handle to the resource
+
+         @throw std::invalid_argument
+
+         @see operator[](Handle<Resource> const&)
+         */
+        Handle<Resource> getHandle(Id const& id);
+
+        /*!
+         @brief Tell whether a handle refers to a loaded resource
+
+         @param handle a handle obtained from this manager
+         @return false if the handle is null or its resource was unloaded
+         */
+        bool isValid(Handle<Resource> const& handle) const;
+
+        /*!
+         @brief Look up a resident resource through a handle
+
+         As with operator[](Id const&) const, an evicted resource isn't
+         loaded again.
+
+         @param handle a handle obtained from this manager
+         @return the resource referred to by `handle`
+
+         @throw std::invalid_argument if the handle is stale
+
+         @see operator[](Handle<Resource> const&)
+         */
+        Resource const& operator[](Handle<Resource> const& handle) const;
+
+        /*!
+         @brief Fetch a resource through a handle
+
+         A `std::invalid_argument` exception is thrown if the resource was
+         unloaded since the handle was created. If the resource was
+         evicted, it is loaded again first, as with operator[](Id const&).
+
+         @param handle a handle obtained from this manager
+         @return the resource referred to by `handle`
+
+         @throw std::invalid_argument
+         */
+        Resource& operator[](Handle<Resource> const& handle);
+
     private:
         typedef Resource* ResourcePtr; //!< A simple alias
-        
-        typedef std::map<Id, ResourcePtr> Map; //!< Internal storage type
 
-        typedef typename Map::iterator MapIterator; //!< Internal storage iterator
-        typedef typename Map::const_iterator MapConstIterator; //!< Internal storage const iterator
+        /*!
+         @brief Use of a resource
+         */
+        struct Use
+        {
+            Use(Id const& id_, sf::Time time_)
+            : id(id_), time(time_)
+            {
+            }
+
+            Id id; //!< The resource's id
+            sf::Time time; //!< Last access, see accessTime()
+        };
+
+        typedef std::list<Use> LruList; //!< Recently used resources, most recent first
+        typedef typename LruList::iterator LruIterator; //!< A simple alias
+
+        struct RefState;
+
+        /*!
+         @brief Bookkeeping of a resource
+         */
+        struct Entry
+        {
+            Entry()
+            : resource(0), bytes(0), pinned(false), userPinned(false), incompressible(false), unloading(false)
+            , generation(0), digest(0), slot(NoSlot), refs(0)
+            {
+            }
+
+            ResourcePtr resource; //!< The resource, or 0 if it was evicted
+            std::size_t bytes; //!< Estimated size of the resource
+            bool pinned; //!< Can't be evicted when true, i.e. userPinned or refs
+            bool userPinned; //!< Pinned with pin()
+            bool incompressible; //!< Compressing the content was not worth it; kept while evicted
+            bool unloading; //!< Unloaded while Refs used it; applyReleases() finishes the job
+            LruIterator lru; //!< Position in m_lru if resident and not pinned
+            unsigned long generation; //!< Incremented on every change
+            std::uint64_t digest; //!< Hash of the content if in m_contents, 0 otherwise
+            std::uint32_t slot; //!< Index in m_slots, or NoSlot
+            RefState* refs; //!< Counter of the current Refs, or 0
+        };
+
+        /*!
+         @brief Counter of the Refs of a resource
+         */
+        struct RefState : priv::RefBlock<Resource>
+        {
+            /*!
+             @brief Constructor; the state starts with one reference
+             */
+            RefState(ResourcePtr resource, priv::ReleaseQueue<Resource>* queue, Id const& id_)
+            : priv::RefBlock<Resource>(resource, queue), id(id_)
+            {
+            }
+
+            Id id; //!< The resource's id
+        };
+
+        static std::uint32_t const NoSlot = ~static_cast<std::uint32_t>(0); //!< Entry without handle
+
+        /*!
+         @brief Target of the handles of a resource
+
+         It mirrors the entry of the resource so handles don't need to look
+         up the id.
+         */
+        struct Slot
+        {
+            Id id; //!< The resource's id
+            ResourcePtr resource; //!< Same as Entry::resource
+            bool pinned; //!< Same as Entry::pinned
+            LruIterator lru; //!< Same as Entry::lru
+            std::uint32_t generation; //!< Incremented when the resource is unloaded
+        };
+
+        /*!
+         @brief A resource shared between ids with identical files
+         */
+        struct Content
+        {
+            ResourcePtr resource; //!< The shared resource
+            std::size_t refs; //!< Number of entries using it
+            Id id; //!< Id it was first loaded for
+        };
+
+        typedef storage::Hash<std::uint64_t, Content> ContentMap; //!< Hash of a file -> resource
+
+        /*!
+         @brief A resource compressed by compressIdle()
+         */
+        struct Cold
+        {
+            std::shared_ptr<std::vector<char> > data; //!< Output of ResourceCompressor
+            std::size_t bytes; //!< Estimated size of the resource
+        };
+
+        typedef Storage<Id, Cold> ColdMap; //!< Compressed resources storage type
+
+        typedef Storage<Id, Entry> Map; //!< Internal storage type
+        typedef Storage<Id, bool> IdSet; //!< Set of ids
+        typedef std::map<std::string, IdSet> GroupMap; //!< Groups storage type
+        typedef Storage<Id, std::size_t> RefCountMap; //!< Number of groups of each resource
+
+        typedef typename Map::Iterator MapIterator; //!< Internal storage iterator
+
+        typedef Storage<Id, Resource const*> Snapshot; //!< Resources visible to Readers
+
+        typedef priv::LoaderTraits<OnLoad, Resource> Traits; //!< Loader adapter
+        typedef typename Traits::Staged Staged; //!< Type produced by workers
+        typedef priv::InPlaceCommit<OnLoad, Resource, Staged> InPlace; //!< Loader adapter
+        typedef priv::TieredStage<OnLoad, Staged, Id> Tiered; //!< Loader adapter
+        typedef priv::IoLocator<OnLoad, Id> Locator; //!< Loader adapter
+        typedef priv::BatchReading<OnLoad> Batch; //!< Loader adapter
+
+        typedef std::pair<Id, Staged*> Reload; //!< A decoded hot reload
+
+        /*!
+         @brief A resource that failed to load
+         */
+        struct Miss
+        {
+            sf::Time expiry; //!< When the failure is forgotten, see m_missClock
+            unsigned long version; //!< Version of ResourceLocations at that time
+        };
+
+        typedef Storage<Id, Miss> MissMap; //!< Negative cache storage type
+
+        /*!
+         @brief State of an asynchronous load
+         */
+        struct AsyncRequest
+        {
+            Id id; //!< Resource being loaded
+            Staged* staged; //!< Worker's output, or 0
+            std::uint64_t digest; //!< Hash of the file if deduplicating, 0 otherwise
+            unsigned tier; //!< Quality tier to load
+            bool cancelled; //!< Set by releaseGroup(); the load is dropped by poll()
+            std::string batchFile; //!< File read by its batch, dropped once decoded, or empty
+            std::shared_ptr<LoadHandle::State> state; //!< Shared with handles
+            std::vector<std::shared_ptr<LoadProgress::Counters> > batches; //!< Preloads waiting for it
+        };
+
+        typedef std::shared_ptr<AsyncRequest> AsyncRequestPtr; //!< A simple alias
+        typedef std::map<Id, AsyncRequestPtr> AsyncRequestMap; //!< Pending loads storage
+
+        /*!
+         @brief Start loading a resource in the background
+
+         @param id id of the resource to load
+         @param priority priority of the task
+         @param batchFile file read ahead by the batch of the load, if any
+         @return the pending load of the resource, or null if it is resident
+         */
+        AsyncRequestPtr enqueue(Id const& id, int priority, std::string const& batchFile = std::string());
+
+        /*!
+         @brief Publish the outcome of an asynchronous load
+
+         @param request load to complete
+         @param entry entry of the resource, or 0 if the load failed
+         */
+        void complete(AsyncRequest& request, Entry const* entry);
+
+        /*!
+         @brief Worker side of loadAsync()
+
+         @param request load to process
+         */
+        void decode(AsyncRequestPtr request);
+
+        /*!
+         @brief Make a resource resident, reloading it if it was evicted
+
+         @param id id of the resource to be fetched
+         @return the resource corresponding to `id`
+
+         @throw std::invalid_argument
+         */
+        Resource& fetch(Id const& id);
+
+        /*!
+         @brief Mark a resident resource as the most recently used
+
+         @param entry entry of the resource
+         */
+        void touch(Entry& entry);
+
+        /*!
+         @brief Get the time of an access, for compressIdle()
+
+         @return the current time, or zero if cold compression is disabled
+         */
+        sf::Time accessTime() const;
+
+        /*!
+         @brief Decompress a resource compressed by compressIdle()
+
+         @param id id of the resource
+         @return false if the resource was not compressed or could not be
+                 decompressed
+         */
+        bool thaw(Id const& id);
+
+        /*!
+         @brief Remove a resource from m_cold
+
+         @param id id of the resource
+         @param cold receives the compressed resource
+         @return false if the resource was not compressed
+         */
+        bool takeCold(Id const& id, Cold& cold);
+
+        /*!
+         @brief Copy the state of an entry to its slot, if it has one
+
+         @param entry entry that was modified
+         */
+        void syncSlot(Entry const& entry);
+
+        /*!
+         @brief Prevent the eviction of a resident resource
+
+         @param entry entry of the resource
+         */
+        void pinEntry(Entry& entry);
+
+        /*!
+         @brief Allow the eviction of a resource again
+
+         @param id id of the resource
+         @param entry entry of the resource; neither pinned by the user
+                      nor used by Refs
+         */
+        void unpinEntry(Id const& id, Entry& entry);
+
+        /*!
+         @brief Tell if Refs still use a resource
+
+         @param entry entry of the resource
+         @return true if the last Ref of the resource wasn't dropped yet
+         */
+        static bool isReferenced(Entry const& entry);
+
+        /*!
+         @brief Invalidate the handles of an entry that was removed
+
+         @param entry entry that was taken out of m_resources
+         */
+        void freeSlot(Entry const& entry);
+
+        /*!
+         @brief Call `OnLoad`, or share an identical resource
+
+         @param id id of the resource to load
+         @param digest receives the hash of the file if deduplicating, or 0
+         @param reload true if the resource is resident and reloaded
+         @return the loaded resource, or 0
+         */
+        ResourcePtr loadResource(Id const& id, std::uint64_t& digest, bool reload);
+
+        /*!
+         @brief Find a shared resource loaded from the same content as a file
+
+         The file of `id` is compared byte for byte with the file of the
+         id the shared resource was first loaded for, so that colliding
+         hashes don't share different resources.
+
+         @param id id of the resource to load
+         @param digest hash of its file, or 0
+         @return the shared resource, or 0 if there is none
+         */
+        Content const* findContent(Id const& id, std::uint64_t digest) const;
+
+        /*!
+         @brief Call `OnLoad`'s stage()
+
+         @param id id of the resource to load
+         @param tier quality tier to load
+         @param reload true if the resource is resident and reloaded
+         @return the staged resource, or 0
+         */
+        Staged* stageResource(Id const& id, unsigned tier, bool reload);
+
+        /*!
+         @brief Select the quality tier of the next loads
+
+         @return tier to load, 0 for the full quality
+         */
+        unsigned selectTier() const;
+
+#ifndef SFTOOLS_NO_TELEMETRY
+        /*!
+         @brief Start measuring a call to `OnLoad`
+
+         @return start time
+         */
+        std::uint64_t beginLoad();
+
+        /*!
+         @brief Record a call to `OnLoad`
+
+         Reloads are not loads; they are only counted once committed.
+
+         @param start value returned by beginLoad()
+         @param success true if a resource was produced
+         @param reload true if the resource is resident and reloaded
+         */
+        void endLoad(std::uint64_t start, bool success, bool reload);
+#endif
+
+        /*!
+         @brief Look up the negative cache
+
+         Stale failures are dropped.
+
+         @param id id of a resource that is not resident
+         @return true if loading `id` is known to fail
+         */
+        bool isKnownMissing(Id const& id);
+
+        /*!
+         @brief Record a failed load in the negative cache, if enabled
+
+         @param id id of the resource
+         */
+        void rememberMissing(Id const& id);
+
+        /*!
+         @brief Record the first access to a resource while recording
+
+         @param id id of the resource
+         */
+        void record(Id const& id);
+
+        /*!
+         @brief Implementation of preload() and replayManifest()
+
+         @param first first id of the batch
+         @param last end of the batch
+         @param priority priority of the batch
+         @param reorder load in the order of the data on disk
+         @return counters of the batch
+         */
+        template <typename Iterator>
+        LoadProgress scheduleBatch(Iterator first, Iterator last, int priority, bool reorder);
+
+        /*!
+         @brief Implementation of operator[]
+
+         @param id id of the resource to be fetched
+         @return the resource corresponding to `id`, or the placeholder
+
+         @throw std::invalid_argument
+         */
+        Resource& lookup(Id const& id);
+
+        /*!
+         @brief Implementation of the const operator[]
+
+         @param entry entry of the resource, or 0
+         @return the resource if it is resident, or the placeholder
+
+         @throw std::invalid_argument
+         */
+        Resource const& peek(Entry const* entry) const;
+
+        /*!
+         @brief Register a freshly loaded resource
+
+         `id` must not be resident.
+
+         @param id id of the resource
+         @param ptr loaded resource, or the resource of m_contents[digest]
+         @param digest hash of the file the resource was loaded from, or 0
+         @return the entry of the resource
+         */
+        Entry& store(Id const& id, ResourcePtr ptr, std::uint64_t digest = 0);
+
+        /*!
+         @brief Delete the resource of an entry, if any
+
+         The entry itself is kept.
+
+         @param entry entry to be released
+         */
+        void release(Entry& entry);
+
+        /*!
+         @brief Delete a resource, or retire it in concurrent mode
+
+         @param ptr resource to be deleted
+         */
+        void destroy(ResourcePtr ptr);
+
+        /*!
+         @brief Publish a new snapshot of the resident resources for Readers
+         */
+        void publish();
+
+        /*!
+         @brief Evict least recently used resources until the budget is met
+         */
+        void enforceBudget();
+
+        /*!
+         @brief Replace the content of a resident resource
+
+         The content is swapped in place when the loader supports it;
+         otherwise a new resource replaces the old one.
+
+         @param id id of the resource
+         @param staged new content; ownership is taken
+         @return false if the new content could not be committed, in which
+                 case the previous content is kept
+         */
+        bool refresh(Id const& id, Staged* staged);
+
+        /*!
+         @brief Start watching the file of a resource; m_watchMutex must be
+                locked
+         */
+        void watchFile(Id const& id);
+
+        /*!
+         @brief Stop watching the file of a resource that was unloaded
+         */
+        void unwatchFile(Id const& id);
+
+        /*!
+         @brief Body of the hot reload thread
+         */
+        void watchFiles();
 
         Map m_resources; //!< Internal resources storage
 
+        bool m_recording; //!< Set by startRecording()
+        sf::Clock m_recordClock; //!< Time base of the recording
+        IdSet m_recorded; //!< Resources in m_manifest
+        priv::Manifest<Id> m_manifest; //!< First accesses
+
+        LruList m_lru; //!< Resident and unpinned resources
+        std::size_t m_budget; //!< Memory budget, 0 if unlimited
+        std::size_t m_usage; //!< Estimated size of resident resources
+        unsigned m_pressureTiers; //!< Set by setAdaptiveQuality()
+
+        sf::Time m_coldDelay; //!< Set by setColdCompression()
+        sf::Time m_coldBudget; //!< Set by setColdCompression()
+        std::size_t m_reclaimed; //!< see getReclaimedBytes()
+        sf::Clock m_accessClock; //!< Time base of the LRU list
+        ColdMap m_cold; //!< Compressed resources
+
         OnLoad m_onLoad; //!< Procedure to load a resource
+
+        std::unique_ptr<Resource> m_placeholder; //!< Set by enablePlaceholders()
+        IdSet m_unavailable; //!< Resources that failed to load in placeholder mode
+
+        GroupMap m_groups; //!< Named groups of resources
+        RefCountMap m_groupRefs; //!< Resources that belong to a group
+
+        sf::Time m_missDuration; //!< Set by setNegativeCacheDuration()
+        sf::Clock m_missClock; //!< Time base of the negative cache
+        MissMap m_misses; //!< Negative cache
+
+        std::function<bool(Id const&, std::uint64_t&)> m_digest; //!< Set by enableDeduplication()
+        std::function<bool(Id const&, Id const&)> m_sameContent; //!< Set by enableDeduplication()
+        ContentMap m_contents; //!< Shared resources
+
+        std::vector<Slot> m_slots; //!< Targets of the handles
+
+        priv::ReleaseQueue<Resource> m_releases; //!< Unused RefState
+        std::vector<std::uint32_t> m_freeSlots; //!< Unused elements of m_slots
+
+        unsigned int m_workerCount; //!< Set by setWorkerCount()
+        std::unique_ptr<priv::ThreadPool> m_workers; //!< Created on first loadAsync()
+        AsyncRequestMap m_pending; //!< Asynchronous loads not committed yet
+        std::deque<AsyncRequestPtr> m_decoded; //!< Loads ready to be committed
+        std::mutex m_asyncMutex; //!< Protects m_decoded
+        std::condition_variable m_asyncCondition; //!< Signals new decoded loads
+
+        std::unique_ptr<priv::FileWatcher> m_watcher; //!< Set while hot reloading
+        std::thread m_watchThread; //!< Decodes modified files
+        std::atomic<bool> m_watching; //!< Tells m_watchThread to keep going
+        std::function<void(Id const&)> m_watchHook; //!< Called by store() while hot reloading
+        std::map<std::string, Id> m_watchedFiles; //!< Path of the resources' files
+        std::map<Id, std::string> m_watchedPaths; //!< Reverse of m_watchedFiles
+        std::deque<Reload> m_reloads; //!< Decoded hot reloads
+        std::mutex m_watchMutex; //!< Protects m_watchedFiles, m_watchedPaths and m_reloads
+
+        bool m_concurrent; //!< Set by enableConcurrentReads()
+        bool m_dirty; //!< Resources were loaded or deleted since the last publish()
+        std::atomic<Snapshot*> m_snapshot; //!< Published to Readers
+        mutable priv::EpochReclaimer m_epochs; //!< Tracks Readers
+
+#ifndef SFTOOLS_NO_TELEMETRY
+        priv::Telemetry m_telemetry; //!< Activity counters
+#endif
+
+    public:
+        /*!
+         @class Reader
+         @brief Wait-free read access to a manager from any thread
+
+         A Reader sees the resources that were published by the last
+         reclaim() (or poll()) before it was created; they stay alive until the Reader is destroyed, even if the manager
+         unloads them in the meantime. Creating a Reader and looking up
+         resources never block, so Readers should be short-lived (e.g. one
+         per frame or per audio callback) to let the manager reclaim memory.
+
+         @code
+
+         // Audio thread
+         sftools::SoundBufferManager::Reader reader(manager);
+         sf::SoundBuffer const* buffer = reader.find("shot.wav");
+         if (buffer)
+         {
+             mix(*buffer);
+         }
+
+         @endcode
+
+         @note Evicted resources are not visible; pin the resources that
+               other threads rely on.
+
+         @see enableConcurrentReads
+         */
+        class Reader : NonCopyable
+        {
+        public:
+            /*!
+             @brief Constructor
+
+             @param manager manager whose resources are read
+             */
+            explicit Reader(GenericManager const& manager);
+
+            /*!
+             @brief Destructor
+             */
+            ~Reader();
+
+            /*!
+             @brief Look up a resource
+
+             @param id id of the resource
+             @return the resource, or 0 if it was not loaded or if concurrent
+                     reads are disabled
+             */
+            Resource const* find(Id const& id) const;
+
+        private:
+            priv::EpochReclaimer& m_epochs; //!< Reclaimer of the manager
+            priv::EpochReclaimer::Token m_token; //!< Read-side critical section
+            Snapshot const* m_snapshot; //!< Resources visible to this Reader
+        };
     };
 }
 
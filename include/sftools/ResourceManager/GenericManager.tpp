@@ -27,7 +27,10 @@
  @brief Implementation of GenericManager class
  */
 
+#include <SFML/System/Clock.hpp>
 #include <stdexcept> // std::invalid_argument
+#include <algorithm> // std::sort, std::unique, std::min
+#include <set>
 
 /*!
  @namespace sftools
@@ -35,89 +38,1941 @@
  */
 namespace sftools
 {
-    template <typename Resource, typename Id, typename OnLoad>
-    GenericManager<Resource, Id, OnLoad>::GenericManager()
-    : m_onLoad(OnLoad())
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    GenericManager<Resource, Id, OnLoad, Storage>::GenericManager()
+    : m_recording(false)
+    , m_budget(0)
+    , m_usage(0)
+    , m_pressureTiers(0)
+    , m_coldDelay(sf::Time::Zero)
+    , m_coldBudget(sf::Time::Zero)
+    , m_reclaimed(0)
+    , m_onLoad(OnLoad())
+    , m_missDuration(sf::Time::Zero)
+    , m_workerCount(0)
+    , m_watching(false)
+    , m_concurrent(false)
+    , m_dirty(false)
+    , m_snapshot(0)
     {
     }
 
-    template <typename Resource, typename Id, typename OnLoad>
-    bool GenericManager<Resource, Id, OnLoad>::load(Id const& id, bool forceReload)
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    GenericManager<Resource, Id, OnLoad, Storage>::~GenericManager()
     {
+        // Stop the threads first; they use this object.
+        disableHotReload();
+        m_workers.reset();
+
+        for (typename AsyncRequestMap::iterator it = m_pending.begin(); it != m_pending.end(); ++it)
+        {
+            Traits::discard(it->second->staged);
+            complete(*it->second, 0);
+        }
+
+        // Refs must be gone by now
+        applyReleases();
+
+        unloadAll();
+
+        // Readers must be gone by now
+        delete m_snapshot.load();
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    bool GenericManager<Resource, Id, OnLoad, Storage>::load(Id const& id, bool forceReload)
+    {
+        record(id);
+
         // Already loaded ?
-        if (m_resources.count(id) != 0)
+        Entry* entry = m_resources.find(id);
+        if (entry && entry->resource)
         {
+            // Wanted again after all
+            entry->unloading = false;
+
             if (!forceReload)
             {
                 // Don't do it twice!
                 return true;
             }
-            else
+            else if (m_concurrent)
             {
-                unload(id);
+                // Readers may be using the current content
+                return false;
             }
+            else if (InPlace::supported)
+            {
+                // Keep the same object
+                Staged* staged = stageResource(id, selectTier(), true);
+                return staged && refresh(id, staged);
+            }
+        }
+        else if (!forceReload && thaw(id))
+        {
+            return true;
+        }
+        else if (isKnownMissing(id))
+        {
+            return false;
         }
         
         // No ? Ok, let my onLoad method do it.
-        ResourcePtr ptr = m_onLoad(id);
+        bool const reload = entry && entry->resource;
+        std::uint64_t digest = 0;
+        ResourcePtr ptr = loadResource(id, digest, reload);
         
         // Was it correctly loaded ?
         if (ptr)
         {
-            m_resources[id] = ptr;
+            // Replace the previous version, if any
+            entry = m_resources.find(id);
+            if (entry && entry->resource == ptr)
+            {
+                // The file didn't change
+                return true;
+            }
+            else if (entry)
+            {
+                release(*entry);
+            }
+
+            store(id, ptr, digest);
+            SFTOOLS_TELEMETRY(if (reload) ++m_telemetry.reloads;)
+
+            // Placeholders are no longer needed
+            bool unavailable = false;
+            m_unavailable.take(id, unavailable);
             
             return true;
         }
         else
         {
+            if (!entry || !entry->resource)
+            {
+                rememberMissing(id);
+            }
+
             return false;
         }
     }
     
-    template <typename Resource, typename Id, typename OnLoad>
-    void GenericManager<Resource, Id, OnLoad>::unload(Id const& id)
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    LoadHandle GenericManager<Resource, Id, OnLoad, Storage>::loadAsync(Id const& id, int priority)
+    {
+        record(id);
+
+        if (!isReady(id) && isKnownMissing(id))
+        {
+            return LoadHandle(std::make_shared<LoadHandle::State>(LoadHandle::Failed));
+        }
+
+        AsyncRequestPtr request = enqueue(id, priority);
+
+        // Nothing to do ?
+        if (!request)
+        {
+            return LoadHandle(std::make_shared<LoadHandle::State>(LoadHandle::Loaded));
+        }
+
+        return LoadHandle(request->state);
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    template <typename Iterator>
+    LoadProgress GenericManager<Resource, Id, OnLoad, Storage>::preload(Iterator first, Iterator last, int priority)
     {
-        delete m_resources[id];
-        m_resources.erase(id);
+        return scheduleBatch(first, last, priority, true);
     }
-    
-    template <typename Resource, typename Id, typename OnLoad>
-    void GenericManager<Resource, Id, OnLoad>::unloadAll()
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    template <typename Range>
+    LoadProgress GenericManager<Resource, Id, OnLoad, Storage>::preload(Range const& ids, int priority)
     {
-        for (MapIterator it = m_resources.begin(); it != m_resources.end(); ++it)
+        return preload(ids.begin(), ids.end(), priority);
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    template <typename Iterator>
+    LoadProgress GenericManager<Resource, Id, OnLoad, Storage>::scheduleBatch(Iterator first, Iterator last, int priority, bool reorder)
+    {
+        std::shared_ptr<LoadProgress::Counters> batch = std::make_shared<LoadProgress::Counters>();
+        priv::IoSchedule<Id> schedule;
+
+        // Lower tiers load other files than the located ones
+        bool const readAhead = selectTier() == 0;
+
+        for (; first != last; ++first)
+        {
+            Id const id(*first);
+
+            ++batch->total;
+
+            Entry const* entry = m_resources.find(id);
+            if (entry && (entry->resource || thaw(id)))
+            {
+                batch->bytes += entry->bytes;
+                ++batch->loaded;
+            }
+            else if (isKnownMissing(id))
+            {
+                ++batch->failed;
+            }
+            else
+            {
+                // Loads already queued don't belong to this batch's reads
+                priv::IoRequest request;
+                bool const located = readAhead && m_pending.find(id) == m_pending.end()
+                                     && Locator::locate(m_onLoad, id, request);
+                schedule.add(id, request, located);
+            }
+        }
+
+        // Avoid seeking back and forth on the disk
+        if (reorder)
         {
-            delete it->second;
+            schedule.sort();
         }
-        m_resources.clear();
+
+        std::vector<priv::IoRequest> requests;
+        schedule.getRequests(requests);
+
+        // Decoders must know their files are read for them
+        if (!requests.empty())
+        {
+            Batch::expect(m_onLoad, requests);
+        }
+
+        for (std::size_t i = 0; i < schedule.size(); ++i)
+        {
+            priv::IoRequest const* request = schedule.getRequest(i);
+            std::string const& batchFile = request && Batch::supported ? request->path : std::string();
+
+            enqueue(schedule.getId(i), priority, batchFile)->batches.push_back(batch);
+        }
+
+        if (!requests.empty() && Batch::supported)
+        {
+            // Read the whole batch at once, ahead of its decoders
+            m_workers->push([this, requests]()
+            {
+                Batch::read(m_onLoad, requests);
+            }, priority + 1);
+        }
+        else if (!requests.empty())
+        {
+            // Served before the decoding of the batch
+            m_workers->push([requests]()
+            {
+                for (std::size_t i = 0; i < requests.size(); ++i)
+                {
+                    priv::readAhead(requests[i]);
+                }
+            }, priority + 1);
+        }
+
+        return LoadProgress(batch);
     }
-    
-    template <typename Resource, typename Id, typename OnLoad>
-    Resource const& GenericManager<Resource, Id, OnLoad>::operator[](Id const& id) const
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    void GenericManager<Resource, Id, OnLoad, Storage>::addToGroup(std::string const& group, Id const& id)
     {
-        MapConstIterator it = m_resources.find(id);
-        
-        if (it != m_resources.end())
+        IdSet& members = m_groups[group];
+
+        if (members.find(id))
+        {
+            return;
+        }
+
+        members.insert(id, true);
+
+        std::size_t* refs = m_groupRefs.find(id);
+        if (refs)
         {
-            return *it->second;
+            ++*refs;
         }
         else
         {
-            throw std::invalid_argument("Resource not loaded");
+            m_groupRefs.insert(id, 1);
+        }
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    template <typename Iterator>
+    void GenericManager<Resource, Id, OnLoad, Storage>::addToGroup(std::string const& group, Iterator first, Iterator last)
+    {
+        for (; first != last; ++first)
+        {
+            addToGroup(group, Id(*first));
+        }
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    LoadProgress GenericManager<Resource, Id, OnLoad, Storage>::prefetchGroup(std::string const& group, int priority)
+    {
+        std::vector<Id> ids;
+
+        typename GroupMap::iterator it = m_groups.find(group);
+        if (it != m_groups.end())
+        {
+            ids.reserve(it->second.size());
+
+            for (typename IdSet::Iterator member = it->second.begin(); member != it->second.end(); ++member)
+            {
+                ids.push_back(member->first);
+            }
+        }
+
+        return preload(ids.begin(), ids.end(), priority);
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    void GenericManager<Resource, Id, OnLoad, Storage>::releaseGroup(std::string const& group)
+    {
+        typename GroupMap::iterator it = m_groups.find(group);
+        if (it == m_groups.end())
+        {
+            return;
+        }
+
+        for (typename IdSet::Iterator member = it->second.begin(); member != it->second.end(); ++member)
+        {
+            std::size_t* refs = m_groupRefs.find(member->first);
+
+            if (--*refs == 0)
+            {
+                std::size_t last = 0;
+                m_groupRefs.take(member->first, last);
+
+                Entry const* entry = m_resources.find(member->first);
+                if (entry && entry->pinned)
+                {
+                    // Pinned by the user, or used by Refs in which case
+                    // applyReleases() unloads it
+                    continue;
+                }
+
+                // Prefetches still in progress are dropped by poll()
+                typename AsyncRequestMap::iterator pending = m_pending.find(member->first);
+                if (pending != m_pending.end())
+                {
+                    pending->second->cancelled = true;
+                }
+
+                unload(member->first);
+            }
+        }
+
+        m_groups.erase(it);
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    void GenericManager<Resource, Id, OnLoad, Storage>::startRecording()
+    {
+        m_recorded.clear();
+        m_manifest.clear();
+        m_recordClock.restart();
+        m_recording = true;
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    void GenericManager<Resource, Id, OnLoad, Storage>::stopRecording()
+    {
+        m_recording = false;
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    bool GenericManager<Resource, Id, OnLoad, Storage>::saveManifest(std::string const& path) const
+    {
+        return m_manifest.save(path);
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    LoadProgress GenericManager<Resource, Id, OnLoad, Storage>::replayManifest(std::string const& path, int priority)
+    {
+        priv::Manifest<Id> manifest;
+        std::vector<Id> ids;
+
+        if (manifest.open(path))
+        {
+            ids.reserve(manifest.size());
+
+            for (std::size_t i = 0; i < manifest.size(); ++i)
+            {
+                ids.push_back(manifest.getId(i));
+            }
+        }
+
+        // The order of the accesses matters more than the order on disk
+        return scheduleBatch(ids.begin(), ids.end(), priority, false);
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    std::size_t GenericManager<Resource, Id, OnLoad, Storage>::poll(sf::Time budget)
+    {
+        sf::Clock clock;
+        std::size_t count = 0;
+
+        for (;;)
+        {
+            AsyncRequestPtr request;
+
+            {
+                std::lock_guard<std::mutex> lock(m_asyncMutex);
+
+                if (m_decoded.empty())
+                {
+                    break;
+                }
+
+                request = m_decoded.front();
+                m_decoded.pop_front();
+            }
+
+            m_pending.erase(request->id);
+
+            // An identical file may have been loaded since it was decoded
+            Content const* content = findContent(request->id, request->digest);
+
+            ResourcePtr ptr = 0;
+            if (request->cancelled)
+            {
+                Traits::discard(request->staged);
+            }
+            else if (content)
+            {
+                Traits::discard(request->staged);
+                ptr = content->resource;
+            }
+            else if (request->staged)
+            {
+                ptr = Traits::commit(m_onLoad, request->staged);
+            }
+            request->staged = 0;
+
+            if (ptr)
+            {
+                // It might have been loaded synchronously in the meantime
+                Entry* entry = m_resources.find(request->id);
+                if (!entry || !entry->resource)
+                {
+                    entry = &store(request->id, ptr, request->digest);
+                }
+                else if (!content)
+                {
+                    ResourceAllocator<Resource>::destroy(ptr);
+                }
+
+                complete(*request, entry);
+            }
+            else
+            {
+                complete(*request, 0);
+            }
+
+            ++count;
+
+            if (budget != sf::Time::Zero && clock.getElapsedTime() >= budget)
+            {
+                break;
+            }
+        }
+
+        applyReleases();
+        compressIdle();
+        reclaim();
+
+        return count;
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    void GenericManager<Resource, Id, OnLoad, Storage>::wait()
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_asyncMutex);
+
+            while (m_decoded.size() < m_pending.size())
+            {
+                m_asyncCondition.wait(lock);
+            }
+        }
+
+        poll();
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    void GenericManager<Resource, Id, OnLoad, Storage>::setWorkerCount(unsigned int count)
+    {
+        m_workerCount = count;
+
+        if (m_workers)
+        {
+            // Tasks still queued, like read-aheads, are only hints
+            wait();
+            m_workers.reset();
+        }
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    typename GenericManager<Resource, Id, OnLoad, Storage>::AsyncRequestPtr GenericManager<Resource, Id, OnLoad, Storage>::enqueue(Id const& id, int priority, std::string const& batchFile)
+    {
+        Entry* entry = m_resources.find(id);
+        if (entry && (entry->resource || thaw(id)))
+        {
+            return AsyncRequestPtr();
+        }
+
+        typename AsyncRequestMap::iterator it = m_pending.find(id);
+        if (it != m_pending.end())
+        {
+            // Requested again after its group was released
+            it->second->cancelled = false;
+            return it->second;
+        }
+
+        // Delegate the work
+        if (!m_workers)
+        {
+            m_workers.reset(new priv::ThreadPool(m_workerCount));
+        }
+
+        AsyncRequestPtr request = std::make_shared<AsyncRequest>();
+        request->id = id;
+        request->staged = 0;
+        request->digest = 0;
+        request->tier = selectTier();
+        request->cancelled = false;
+        request->batchFile = batchFile;
+        request->state = std::make_shared<LoadHandle::State>(LoadHandle::Pending);
+
+        m_pending[id] = request;
+        m_workers->push(std::bind(&GenericManager::decode, this, request), priority);
+
+        return request;
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    void GenericManager<Resource, Id, OnLoad, Storage>::complete(AsyncRequest& request, Entry const* entry)
+    {
+        request.state->store(entry ? LoadHandle::Loaded : LoadHandle::Failed);
+
+        if (!entry && !request.cancelled)
+        {
+            rememberMissing(request.id);
+
+            if (m_placeholder)
+            {
+                m_unavailable.insert(request.id, true);
+            }
+        }
+
+        for (std::size_t i = 0; i < request.batches.size(); ++i)
+        {
+            LoadProgress::Counters& batch = *request.batches[i];
+
+            if (entry)
+            {
+                batch.bytes += entry->bytes;
+                ++batch.loaded;
+            }
+            else
+            {
+                ++batch.failed;
+            }
+        }
+        request.batches.clear();
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    void GenericManager<Resource, Id, OnLoad, Storage>::decode(AsyncRequestPtr request)
+    {
+        // Lower tiers are not shared
+        std::uint64_t digest = 0;
+        if (m_digest && request->tier == 0 && !m_digest(request->id, digest))
+        {
+            digest = 0;
+        }
+
+        Staged* staged = stageResource(request->id, request->tier, false);
+
+        // The loader may not have used the file read for it, e.g. if it
+        // loaded a lower tier or the locations changed
+        if (!request->batchFile.empty())
+        {
+            Batch::drop(m_onLoad, request->batchFile);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_asyncMutex);
+
+            request->staged = staged;
+            request->digest = digest;
+            if (staged)
+            {
+                request->state->store(LoadHandle::Decoded);
+            }
+            m_decoded.push_back(request);
+        }
+
+        m_asyncCondition.notify_all();
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    void GenericManager<Resource, Id, OnLoad, Storage>::unload(Id const& id)
+    {
+        // Refs still point to the resource; the last one releases it
+        Entry* used = m_resources.find(id);
+        if (used && isReferenced(*used))
+        {
+            used->userPinned = false;
+            used->unloading = true;
+            return;
+        }
+
+        Entry entry;
+        if (m_resources.take(id, entry))
+        {
+            Cold cold;
+            takeCold(id, cold);
+
+            release(entry);
+            freeSlot(entry);
+
+            if (m_watcher)
+            {
+                std::lock_guard<std::mutex> lock(m_watchMutex);
+                unwatchFile(id);
+            }
+
+            SFTOOLS_TELEMETRY(++m_telemetry.unloads;)
         }
     }
     
-    template <typename Resource, typename Id, typename OnLoad>
-    Resource& GenericManager<Resource, Id, OnLoad>::operator[](Id const& id)
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    void GenericManager<Resource, Id, OnLoad, Storage>::unloadAll()
     {
-        MapIterator it = m_resources.find(id);
-        
-        if (it != m_resources.end())
+        for (MapIterator it = m_resources.begin(); it != m_resources.end(); ++it)
         {
-            return *it->second;
+            if (isReferenced(it->second))
+            {
+                // Unload the others one by one, and defer the rest
+                std::vector<Id> ids;
+                for (it = m_resources.begin(); it != m_resources.end(); ++it)
+                {
+                    ids.push_back(it->first);
+                }
+                for (std::size_t i = 0; i < ids.size(); ++i)
+                {
+                    unload(ids[i]);
+                }
+
+                m_unavailable.clear();
+                m_misses.clear();
+                return;
+            }
         }
-        else
+
+        for (MapIterator it = m_resources.begin(); it != m_resources.end(); ++it)
         {
-            throw std::invalid_argument("Resource not loaded");
+            if (!it->second.digest)
+            {
+                destroy(it->second.resource);
+            }
         }
+        for (typename ContentMap::Iterator it = m_contents.begin(); it != m_contents.end(); ++it)
+        {
+            destroy(it->second.resource);
+        }
+        SFTOOLS_TELEMETRY(m_telemetry.unloads += m_resources.size();)
+        SFTOOLS_TELEMETRY(m_telemetry.residentCount = 0;)
+        SFTOOLS_TELEMETRY(m_telemetry.residentBytes = 0;)
+        SFTOOLS_TELEMETRY(m_telemetry.deduplicatedBytes = 0;)
+        SFTOOLS_TELEMETRY(m_telemetry.compressedCount = 0;)
+        SFTOOLS_TELEMETRY(m_telemetry.compressedBytes = 0;)
+        SFTOOLS_TELEMETRY(m_telemetry.reclaimedBytes = 0;)
+        m_reclaimed = 0;
+
+        // Invalidate all handles
+        m_freeSlots.clear();
+        for (std::size_t i = m_slots.size(); i-- > 0; )
+        {
+            m_slots[i].resource = 0;
+            ++m_slots[i].generation;
+            m_freeSlots.push_back(static_cast<std::uint32_t>(i));
+        }
+
+        m_resources.clear();
+        m_contents.clear();
+        m_cold.clear();
+
+        if (m_watcher)
+        {
+            std::lock_guard<std::mutex> lock(m_watchMutex);
+            m_watchedFiles.clear();
+            m_watchedPaths.clear();
+        }
+
+        m_unavailable.clear();
+        m_misses.clear();
+        m_lru.clear();
+        m_usage = 0;
+        m_dirty = true;
+    }
+    
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    void GenericManager<Resource, Id, OnLoad, Storage>::setMemoryBudget(std::size_t bytes)
+    {
+        m_budget = bytes;
+        enforceBudget();
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    std::size_t GenericManager<Resource, Id, OnLoad, Storage>::getMemoryBudget() const
+    {
+        return m_budget;
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    std::size_t GenericManager<Resource, Id, OnLoad, Storage>::getMemoryUsage() const
+    {
+        return m_usage;
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    void GenericManager<Resource, Id, OnLoad, Storage>::setAdaptiveQuality(unsigned tiers)
+    {
+        m_pressureTiers = tiers;
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    void GenericManager<Resource, Id, OnLoad, Storage>::setColdCompression(sf::Time delay, sf::Time budget)
+    {
+        // Resources used before weren't timed
+        if (m_coldDelay == sf::Time::Zero)
+        {
+            sf::Time const now = m_accessClock.getElapsedTime();
+            for (LruIterator it = m_lru.begin(); it != m_lru.end(); ++it)
+            {
+                it->time = now;
+            }
+        }
+
+        m_coldDelay = delay;
+        m_coldBudget = budget;
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    std::size_t GenericManager<Resource, Id, OnLoad, Storage>::compressIdle()
+    {
+        if (m_coldDelay == sf::Time::Zero)
+        {
+            return 0;
+        }
+
+        sf::Clock clock;
+        sf::Time const now = m_accessClock.getElapsedTime();
+        std::size_t count = 0;
+        bool tried = false;
+
+        // The least recently used resources are at the back
+        LruIterator it = m_lru.end();
+        while (it != m_lru.begin())
+        {
+            LruIterator use = it;
+            --use;
+
+            if (now - use->time < m_coldDelay)
+            {
+                break;
+            }
+
+            Entry& entry = *m_resources.find(use->id);
+
+            // Shared resources would have to be compressed for all their ids
+            if (entry.incompressible || entry.digest)
+            {
+                it = use;
+                continue;
+            }
+
+            if (tried && m_coldBudget != sf::Time::Zero && clock.getElapsedTime() >= m_coldBudget)
+            {
+                break;
+            }
+            tried = true;
+
+            std::shared_ptr<std::vector<char> > data = std::make_shared<std::vector<char> >();
+            if (!ResourceCompressor<Resource>().compress(*entry.resource, *data) || data->size() >= entry.bytes)
+            {
+                // Don't try again until its content changes
+                entry.incompressible = true;
+                it = use;
+                continue;
+            }
+
+            Cold cold;
+            cold.data = data;
+            cold.bytes = entry.bytes;
+
+            // Erases `use`; `it` stays valid
+            Id const id = use->id;
+            release(entry);
+            m_cold.insert(id, cold);
+
+            SFTOOLS_TELEMETRY(++m_telemetry.compressions;)
+            SFTOOLS_TELEMETRY(++m_telemetry.compressedCount;)
+            SFTOOLS_TELEMETRY(m_telemetry.compressedBytes += data->size();)
+            m_reclaimed += cold.bytes - data->size();
+            SFTOOLS_TELEMETRY(m_telemetry.reclaimedBytes = m_reclaimed;)
+
+            ++count;
+        }
+
+        return count;
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    std::size_t GenericManager<Resource, Id, OnLoad, Storage>::getReclaimedBytes() const
+    {
+        return m_reclaimed;
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    void GenericManager<Resource, Id, OnLoad, Storage>::pin(Id const& id)
+    {
+        fetch(id);
+
+        Entry* entry = m_resources.find(id);
+        pinEntry(*entry);
+        entry->userPinned = true;
+        entry->unloading = false;
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    void GenericManager<Resource, Id, OnLoad, Storage>::unpin(Id const& id)
+    {
+        Entry* entry = m_resources.find(id);
+        if (entry && entry->userPinned)
+        {
+            entry->userPinned = false;
+
+            // Refs keep it pinned until applyReleases()
+            if (!entry->refs)
+            {
+                unpinEntry(id, *entry);
+            }
+        }
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    void GenericManager<Resource, Id, OnLoad, Storage>::enablePlaceholders()
+    {
+        if (!m_placeholder)
+        {
+            m_placeholder.reset(Placeholder<Resource>()());
+        }
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    bool GenericManager<Resource, Id, OnLoad, Storage>::isReady(Id const& id) const
+    {
+        Entry const* entry = m_resources.find(id);
+        return entry && entry->resource;
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    void GenericManager<Resource, Id, OnLoad, Storage>::setNegativeCacheDuration(sf::Time duration)
+    {
+        m_missDuration = duration;
+
+        if (m_missDuration == sf::Time::Zero)
+        {
+            m_misses.clear();
+        }
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    void GenericManager<Resource, Id, OnLoad, Storage>::enableDeduplication()
+    {
+        // Digests are computed by worker threads too
+        m_digest = [](Id const& id, std::uint64_t& digest)
+        {
+            std::string const path = singleton::ResourceLocations::getInstance().resolve(id);
+
+            // 0 is reserved for resources that are not shared
+            return !path.empty() && priv::hashFile(path, digest) && digest != 0;
+        };
+
+        m_sameContent = [](Id const& first, Id const& second)
+        {
+            Locations& locations = singleton::ResourceLocations::getInstance();
+            return priv::sameContent(locations.resolve(first), locations.resolve(second));
+        };
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    ManagerStats GenericManager<Resource, Id, OnLoad, Storage>::getStats() const
+    {
+        ManagerStats stats;
+        SFTOOLS_TELEMETRY(m_telemetry.copyTo(stats);)
+        return stats;
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    bool GenericManager<Resource, Id, OnLoad, Storage>::enableHotReload()
+    {
+        if (m_watcher)
+        {
+            return true;
+        }
+
+        // Reloads can't replace what Readers use
+        if (m_concurrent)
+        {
+            return false;
+        }
+
+        m_watcher.reset(new priv::FileWatcher);
+        if (!m_watcher->isSupported())
+        {
+            m_watcher.reset();
+            return false;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_watchMutex);
+
+            for (MapIterator it = m_resources.begin(); it != m_resources.end(); ++it)
+            {
+                if (it->second.resource)
+                {
+                    watchFile(it->first);
+                }
+            }
+        }
+
+        // Resources loaded from now on must be watched too
+        m_watchHook = [this](Id const& id)
+        {
+            std::lock_guard<std::mutex> lock(m_watchMutex);
+            watchFile(id);
+        };
+
+        m_watching = true;
+        m_watchThread = std::thread(&GenericManager::watchFiles, this);
+
+        return true;
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    void GenericManager<Resource, Id, OnLoad, Storage>::disableHotReload()
+    {
+        if (!m_watcher)
+        {
+            return;
+        }
+
+        m_watching = false;
+        m_watchThread.join();
+
+        m_watcher.reset();
+        m_watchHook = nullptr;
+
+        std::lock_guard<std::mutex> lock(m_watchMutex);
+
+        m_watchedFiles.clear();
+        m_watchedPaths.clear();
+
+        for (typename std::deque<Reload>::iterator it = m_reloads.begin(); it != m_reloads.end(); ++it)
+        {
+            Traits::discard(it->second);
+        }
+        m_reloads.clear();
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    std::size_t GenericManager<Resource, Id, OnLoad, Storage>::applyReloads()
+    {
+        std::deque<Reload> reloads;
+
+        {
+            std::lock_guard<std::mutex> lock(m_watchMutex);
+            reloads.swap(m_reloads);
+        }
+
+        std::size_t count = 0;
+
+        for (typename std::deque<Reload>::iterator it = reloads.begin(); it != reloads.end(); ++it)
+        {
+            if (refresh(it->first, it->second))
+            {
+                ++count;
+            }
+        }
+
+        return count;
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    unsigned long GenericManager<Resource, Id, OnLoad, Storage>::getGeneration(Id const& id) const
+    {
+        Entry const* entry = m_resources.find(id);
+        return entry ? entry->generation : 0;
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    Ref<Resource> GenericManager<Resource, Id, OnLoad, Storage>::acquire(Id const& id)
+    {
+        if (!load(id))
+        {
+            throw std::invalid_argument("Resource could not be loaded");
+        }
+
+        Resource& resource = fetch(id);
+        Entry* entry = m_resources.find(id);
+        RefState* previous = entry->refs;
+
+        // Only this thread creates Refs, so a count can't leave zero
+        // behind our back
+        std::size_t count = previous ? previous->count.load(std::memory_order_relaxed) : 0;
+        while (count != 0 && !previous->count.compare_exchange_weak(count, count + 1, std::memory_order_relaxed))
+        {
+        }
+
+        if (count != 0)
+        {
+            return Ref<Resource>(previous);
+        }
+
+        // A state whose count reached zero is queued; applyReleases()
+        // deletes it once it is replaced
+        pinEntry(*entry);
+        entry->refs = new RefState(&resource, &m_releases, id);
+        return Ref<Resource>(entry->refs);
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    std::size_t GenericManager<Resource, Id, OnLoad, Storage>::applyReleases()
+    {
+        std::size_t count = 0;
+
+        for (priv::RefBlock<Resource>* block = m_releases.takeAll(); block != 0; )
+        {
+            RefState* state = static_cast<RefState*>(block);
+            block = block->next;
+
+            // Skip states replaced by acquire() or whose resource was
+            // unloaded explicitly
+            Entry* entry = m_resources.find(state->id);
+            if (entry && entry->refs == state)
+            {
+                entry->refs = 0;
+
+                // Resources pinned by the user stay as they are, unless
+                // they were unloaded meanwhile
+                if (entry->unloading)
+                {
+                    unload(state->id);
+                    ++count;
+                }
+                else if (!entry->userPinned && m_groupRefs.find(state->id))
+                {
+                    unpinEntry(state->id, *entry);
+                }
+                else if (!entry->userPinned)
+                {
+                    unload(state->id);
+                    ++count;
+                }
+            }
+
+            delete state;
+        }
+
+        return count;
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    void GenericManager<Resource, Id, OnLoad, Storage>::enableConcurrentReads()
+    {
+        if (!m_concurrent)
+        {
+            disableHotReload();
+
+            m_concurrent = true;
+            publish();
+        }
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    void GenericManager<Resource, Id, OnLoad, Storage>::reclaim()
+    {
+        if (m_concurrent)
+        {
+            // Publish the loads, and make the unloaded resources unreachable
+            // before reclaiming them
+            if (m_dirty)
+            {
+                publish();
+            }
+
+            m_epochs.reclaim();
+        }
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    Resource const& GenericManager<Resource, Id, OnLoad, Storage>::operator[](Id const& id) const
+    {
+        return peek(m_resources.find(id));
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    Resource& GenericManager<Resource, Id, OnLoad, Storage>::operator[](Id const& id)
+    {
+        return lookup(id);
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    template <typename Key>
+    typename std::enable_if<priv::IsStringKey<Id, Key>::value, Resource const&>::type
+    GenericManager<Resource, Id, OnLoad, Storage>::operator[](Key const& id) const
+    {
+        return peek(m_resources.find(id));
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    template <typename Key>
+    typename std::enable_if<priv::IsStringKey<Id, Key>::value, Resource&>::type
+    GenericManager<Resource, Id, OnLoad, Storage>::operator[](Key const& id)
+    {
+        Entry* entry = m_resources.find(id);
+
+        if (entry && entry->resource)
+        {
+            SFTOOLS_TELEMETRY(++m_telemetry.lookups;)
+            SFTOOLS_TELEMETRY(++m_telemetry.hits;)
+
+            if (m_recording)
+            {
+                record(Id(id));
+            }
+
+            touch(*entry);
+            return *entry->resource;
+        }
+
+        // Loading allocates memory anyway
+        return lookup(Id(id));
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    Handle<Resource> GenericManager<Resource, Id, OnLoad, Storage>::getHandle(Id const& id)
+    {
+        fetch(id);
+
+        Entry* entry = m_resources.find(id);
+        if (entry->slot == NoSlot)
+        {
+            if (m_freeSlots.empty())
+            {
+                Slot slot;
+                slot.id = id;
+                slot.resource = 0;
+                slot.pinned = false;
+                slot.generation = 0;
+                m_slots.push_back(slot);
+                entry->slot = static_cast<std::uint32_t>(m_slots.size() - 1);
+            }
+            else
+            {
+                entry->slot = m_freeSlots.back();
+                m_freeSlots.pop_back();
+                m_slots[entry->slot].id = id;
+            }
+
+            syncSlot(*entry);
+        }
+
+        return Handle<Resource>(entry->slot, m_slots[entry->slot].generation);
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    bool GenericManager<Resource, Id, OnLoad, Storage>::isValid(Handle<Resource> const& handle) const
+    {
+        // Null handles are out of bounds
+        return handle.m_index < m_slots.size() && m_slots[handle.m_index].generation == handle.m_generation;
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    Resource const& GenericManager<Resource, Id, OnLoad, Storage>::operator[](Handle<Resource> const& handle) const
+    {
+        if (!isValid(handle))
+        {
+            throw std::invalid_argument("Stale handle");
+        }
+
+        Slot const& slot = m_slots[handle.m_index];
+        return slot.resource ? *slot.resource : peek(0);
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    Resource& GenericManager<Resource, Id, OnLoad, Storage>::operator[](Handle<Resource> const& handle)
+    {
+        if (!isValid(handle))
+        {
+            throw std::invalid_argument("Stale handle");
+        }
+
+        Slot& slot = m_slots[handle.m_index];
+
+        if (slot.resource)
+        {
+            SFTOOLS_TELEMETRY(++m_telemetry.lookups;)
+            SFTOOLS_TELEMETRY(++m_telemetry.hits;)
+
+            record(slot.id);
+
+            if (!slot.pinned)
+            {
+                m_lru.splice(m_lru.begin(), m_lru, slot.lru);
+                slot.lru->time = accessTime();
+            }
+
+            return *slot.resource;
+        }
+
+        // It was evicted
+        Id const id = slot.id;
+        return lookup(id);
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    Resource& GenericManager<Resource, Id, OnLoad, Storage>::fetch(Id const& id)
+    {
+        Entry* entry = m_resources.find(id);
+
+        if (!entry)
+        {
+            throw std::invalid_argument("Resource not loaded");
+        }
+
+        if (!entry->resource && thaw(id))
+        {
+            // It was compressed
+            entry = m_resources.find(id);
+        }
+        else if (!entry->resource)
+        {
+            // It was evicted; bring it back
+            std::uint64_t digest = 0;
+            ResourcePtr ptr = loadResource(id, digest, false);
+
+            if (!ptr)
+            {
+                throw std::invalid_argument("Resource could not be reloaded");
+            }
+
+            entry = &store(id, ptr, digest);
+        }
+        else
+        {
+            touch(*entry);
+        }
+
+        return *entry->resource;
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    void GenericManager<Resource, Id, OnLoad, Storage>::touch(Entry& entry)
+    {
+        if (!entry.pinned)
+        {
+            m_lru.splice(m_lru.begin(), m_lru, entry.lru);
+            entry.lru->time = accessTime();
+        }
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    sf::Time GenericManager<Resource, Id, OnLoad, Storage>::accessTime() const
+    {
+        // Don't read the clock on every access for nothing
+        return m_coldDelay != sf::Time::Zero ? m_accessClock.getElapsedTime() : sf::Time::Zero;
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    bool GenericManager<Resource, Id, OnLoad, Storage>::thaw(Id const& id)
+    {
+        Cold cold;
+        if (!takeCold(id, cold))
+        {
+            return false;
+        }
+
+        // On failure, the resource is loaded again
+        ResourcePtr ptr = ResourceCompressor<Resource>().decompress(*cold.data);
+        if (!ptr)
+        {
+            return false;
+        }
+
+        SFTOOLS_TELEMETRY(++m_telemetry.decompressions;)
+
+        store(id, ptr);
+        return true;
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    bool GenericManager<Resource, Id, OnLoad, Storage>::takeCold(Id const& id, Cold& cold)
+    {
+        if (!m_cold.take(id, cold))
+        {
+            return false;
+        }
+
+        SFTOOLS_TELEMETRY(--m_telemetry.compressedCount;)
+        SFTOOLS_TELEMETRY(m_telemetry.compressedBytes -= cold.data->size();)
+        m_reclaimed -= cold.bytes - cold.data->size();
+        SFTOOLS_TELEMETRY(m_telemetry.reclaimedBytes = m_reclaimed;)
+
+        return true;
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    void GenericManager<Resource, Id, OnLoad, Storage>::syncSlot(Entry const& entry)
+    {
+        if (entry.slot != NoSlot)
+        {
+            Slot& slot = m_slots[entry.slot];
+            slot.resource = entry.resource;
+            slot.pinned = entry.pinned;
+
+            if (entry.resource && !entry.pinned)
+            {
+                slot.lru = entry.lru;
+            }
+        }
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    void GenericManager<Resource, Id, OnLoad, Storage>::pinEntry(Entry& entry)
+    {
+        if (!entry.pinned)
+        {
+            m_lru.erase(entry.lru);
+            entry.pinned = true;
+            syncSlot(entry);
+        }
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    void GenericManager<Resource, Id, OnLoad, Storage>::unpinEntry(Id const& id, Entry& entry)
+    {
+        if (entry.pinned)
+        {
+            entry.pinned = false;
+
+            if (entry.resource)
+            {
+                entry.lru = m_lru.insert(m_lru.begin(), Use(id, accessTime()));
+            }
+
+            syncSlot(entry);
+
+            if (entry.resource)
+            {
+                enforceBudget();
+            }
+        }
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    bool GenericManager<Resource, Id, OnLoad, Storage>::isReferenced(Entry const& entry)
+    {
+        // A count that reached zero stays there, even if applyReleases()
+        // didn't see its state yet
+        return entry.refs && entry.refs->count.load(std::memory_order_acquire) != 0;
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    void GenericManager<Resource, Id, OnLoad, Storage>::freeSlot(Entry const& entry)
+    {
+        if (entry.slot != NoSlot)
+        {
+            Slot& slot = m_slots[entry.slot];
+            slot.resource = 0;
+            ++slot.generation;
+            m_freeSlots.push_back(entry.slot);
+        }
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    typename GenericManager<Resource, Id, OnLoad, Storage>::Entry& GenericManager<Resource, Id, OnLoad, Storage>::store(Id const& id, ResourcePtr ptr, std::uint64_t digest)
+    {
+        Entry* entry = m_resources.find(id);
+        if (!entry)
+        {
+            entry = &m_resources.insert(id, Entry());
+        }
+
+        // A compressed copy would be out of date
+        Cold cold;
+        takeCold(id, cold);
+
+        entry->resource = ptr;
+        entry->bytes = ResourceSize<Resource>()(*ptr);
+        entry->digest = 0;
+        ++entry->generation;
+
+        // Shared resources are accounted for once
+        Content* content = digest ? m_contents.find(digest) : 0;
+        if (content && content->resource == ptr)
+        {
+            ++content->refs;
+            entry->digest = digest;
+
+            SFTOOLS_TELEMETRY(m_telemetry.deduplicatedBytes += entry->bytes;)
+        }
+        else
+        {
+            if (digest && !content)
+            {
+                Content const shared = { ptr, 1, id };
+                m_contents.insert(digest, shared);
+                entry->digest = digest;
+            }
+
+            m_usage += entry->bytes;
+        }
+
+        SFTOOLS_TELEMETRY(++m_telemetry.residentCount;)
+        SFTOOLS_TELEMETRY(m_telemetry.residentBytes = m_usage;)
+
+        if (!entry->pinned)
+        {
+            entry->lru = m_lru.insert(m_lru.begin(), Use(id, accessTime()));
+        }
+
+        syncSlot(*entry);
+
+        if (entry->refs)
+        {
+            entry->refs->resource.store(ptr, std::memory_order_release);
+        }
+
+        if (m_watchHook)
+        {
+            m_watchHook(id);
+        }
+
+        // Evicting resources doesn't move entries around
+        enforceBudget();
+
+        // Published by the next reclaim(), once for a whole batch of loads
+        m_dirty = true;
+
+        return *entry;
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    typename GenericManager<Resource, Id, OnLoad, Storage>::ResourcePtr GenericManager<Resource, Id, OnLoad, Storage>::loadResource(Id const& id, std::uint64_t& digest, bool reload)
+    {
+        unsigned const tier = selectTier();
+
+        // Lower tiers are not shared
+        digest = 0;
+        if (m_digest && tier == 0)
+        {
+            if (!m_digest(id, digest))
+            {
+                digest = 0;
+            }
+
+            Content const* content = findContent(id, digest);
+            if (content)
+            {
+                return content->resource;
+            }
+        }
+
+        // Only the telemetry tells reloads apart
+        (void)reload;
+
+        SFTOOLS_TELEMETRY(std::uint64_t const start = beginLoad();)
+        ResourcePtr ptr = 0;
+        if (tier != 0)
+        {
+            Staged* staged = Tiered::stage(m_onLoad, id, tier);
+            ptr = staged ? Traits::commit(m_onLoad, staged) : 0;
+        }
+        else
+        {
+            ptr = m_onLoad(id);
+        }
+        SFTOOLS_TELEMETRY(endLoad(start, ptr != 0, reload);)
+
+        return ptr;
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    typename GenericManager<Resource, Id, OnLoad, Storage>::Content const* GenericManager<Resource, Id, OnLoad, Storage>::findContent(Id const& id, std::uint64_t digest) const
+    {
+        Content const* content = digest ? m_contents.find(digest) : 0;
+
+        // Equal hashes don't prove equal files
+        if (content && !m_sameContent(content->id, id))
+        {
+            return 0;
+        }
+
+        return content;
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    typename GenericManager<Resource, Id, OnLoad, Storage>::Staged* GenericManager<Resource, Id, OnLoad, Storage>::stageResource(Id const& id, unsigned tier, bool reload)
+    {
+        // Only the telemetry tells reloads apart
+        (void)reload;
+
+        SFTOOLS_TELEMETRY(std::uint64_t const start = beginLoad();)
+        Staged* staged = tier != 0 ? Tiered::stage(m_onLoad, id, tier) : Traits::stage(m_onLoad, id);
+        SFTOOLS_TELEMETRY(endLoad(start, staged != 0, reload);)
+
+        return staged;
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    unsigned GenericManager<Resource, Id, OnLoad, Storage>::selectTier() const
+    {
+        if (!Tiered::supported)
+        {
+            return 0;
+        }
+
+        unsigned tier = singleton::ResourceLocations::getInstance().getQuality();
+
+        if (m_pressureTiers != 0 && m_budget != 0)
+        {
+            if (m_usage >= m_budget)
+            {
+                tier += m_pressureTiers;
+            }
+            else if (m_usage >= m_budget - m_budget / 4)
+            {
+                tier += 1;
+            }
+        }
+
+        return tier;
+    }
+
+#ifndef SFTOOLS_NO_TELEMETRY
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    std::uint64_t GenericManager<Resource, Id, OnLoad, Storage>::beginLoad()
+    {
+        priv::probeTime() = 0;
+        return priv::telemetryClock();
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    void GenericManager<Resource, Id, OnLoad, Storage>::endLoad(std::uint64_t start, bool success, bool reload)
+    {
+        if (reload)
+        {
+            // Counted by refresh() once committed
+            return;
+        }
+
+        std::uint64_t const total = priv::telemetryClock() - start;
+        std::uint64_t const probe = std::min(priv::probeTime(), total);
+
+        m_telemetry.loadTime.record(total);
+        m_telemetry.probeTime.record(probe);
+        m_telemetry.decodeTime.record(total - probe);
+
+        ++m_telemetry.loads;
+        if (!success)
+        {
+            ++m_telemetry.failedLoads;
+        }
+    }
+#endif
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    bool GenericManager<Resource, Id, OnLoad, Storage>::isKnownMissing(Id const& id)
+    {
+        Miss const* miss = m_misses.find(id);
+        if (!miss)
+        {
+            return false;
+        }
+
+        if (miss->version != singleton::ResourceLocations::getInstance().getVersion()
+            || m_missClock.getElapsedTime() >= miss->expiry)
+        {
+            // Worth trying again
+            Miss stale;
+            m_misses.take(id, stale);
+            return false;
+        }
+
+        SFTOOLS_TELEMETRY(++m_telemetry.suppressedLoads;)
+        return true;
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    void GenericManager<Resource, Id, OnLoad, Storage>::rememberMissing(Id const& id)
+    {
+        if (m_missDuration == sf::Time::Zero)
+        {
+            return;
+        }
+
+        Miss miss;
+        miss.expiry = m_missClock.getElapsedTime() + m_missDuration;
+        miss.version = singleton::ResourceLocations::getInstance().getVersion();
+
+        Miss* previous = m_misses.find(id);
+        if (previous)
+        {
+            *previous = miss;
+        }
+        else
+        {
+            m_misses.insert(id, miss);
+        }
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    void GenericManager<Resource, Id, OnLoad, Storage>::record(Id const& id)
+    {
+        if (m_recording && !m_recorded.find(id))
+        {
+            m_recorded.insert(id, true);
+            m_manifest.add(id, m_recordClock.getElapsedTime().asMilliseconds());
+        }
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    Resource& GenericManager<Resource, Id, OnLoad, Storage>::lookup(Id const& id)
+    {
+        record(id);
+
+        Entry* entry = m_resources.find(id);
+        bool const ready = entry && entry->resource;
+
+        SFTOOLS_TELEMETRY(++m_telemetry.lookups;)
+        SFTOOLS_TELEMETRY(++(ready ? m_telemetry.hits : m_telemetry.misses);)
+
+        if (ready)
+        {
+            touch(*entry);
+            return *entry->resource;
+        }
+
+        // Compressed resources are restored synchronously by fetch()
+        if (m_placeholder && !m_cold.find(id))
+        {
+            // Don't retry failed loads every frame
+            if (!m_unavailable.find(id))
+            {
+                loadAsync(id);
+            }
+
+            return *m_placeholder;
+        }
+
+        return fetch(id);
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    Resource const& GenericManager<Resource, Id, OnLoad, Storage>::peek(Entry const* entry) const
+    {
+        if (entry && entry->resource)
+        {
+            return *entry->resource;
+        }
+        else if (m_placeholder)
+        {
+            return *m_placeholder;
+        }
+
+        throw std::invalid_argument("Resource not loaded");
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    void GenericManager<Resource, Id, OnLoad, Storage>::release(Entry& entry)
+    {
+        if (entry.resource)
+        {
+            Content* content = entry.digest ? m_contents.find(entry.digest) : 0;
+
+            if (content && --content->refs > 0)
+            {
+                // Other ids still use it
+                SFTOOLS_TELEMETRY(m_telemetry.deduplicatedBytes -= entry.bytes;)
+            }
+            else
+            {
+                if (content)
+                {
+                    Content last;
+                    m_contents.take(entry.digest, last);
+                }
+
+                destroy(entry.resource);
+                m_usage -= entry.bytes;
+            }
+
+            entry.resource = 0;
+            entry.digest = 0;
+            m_dirty = true;
+
+            entry.bytes = 0;
+
+            SFTOOLS_TELEMETRY(--m_telemetry.residentCount;)
+            SFTOOLS_TELEMETRY(m_telemetry.residentBytes = m_usage;)
+
+            if (!entry.pinned)
+            {
+                m_lru.erase(entry.lru);
+            }
+
+            syncSlot(entry);
+        }
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    void GenericManager<Resource, Id, OnLoad, Storage>::destroy(ResourcePtr ptr)
+    {
+        if (m_concurrent)
+        {
+            m_epochs.retire(ptr);
+        }
+        else
+        {
+            ResourceAllocator<Resource>::destroy(ptr);
+        }
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    void GenericManager<Resource, Id, OnLoad, Storage>::publish()
+    {
+        Snapshot* snapshot = new Snapshot;
+
+        for (MapIterator it = m_resources.begin(); it != m_resources.end(); ++it)
+        {
+            if (it->second.resource)
+            {
+                snapshot->insert(it->first, it->second.resource);
+            }
+        }
+
+        m_epochs.retire(m_snapshot.exchange(snapshot));
+        m_dirty = false;
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    void GenericManager<Resource, Id, OnLoad, Storage>::enforceBudget()
+    {
+        // Always keep the most recently used resource
+        while (m_budget != 0 && m_usage > m_budget && m_lru.size() > 1)
+        {
+            release(*m_resources.find(m_lru.back().id));
+            SFTOOLS_TELEMETRY(++m_telemetry.evictions;)
+        }
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    bool GenericManager<Resource, Id, OnLoad, Storage>::refresh(Id const& id, Staged* staged)
+    {
+        Entry* entry = m_resources.find(id);
+
+        if (!entry || !entry->resource)
+        {
+            // Unloaded or evicted in the meantime; a compressed copy would
+            // be out of date
+            Cold cold;
+            takeCold(id, cold);
+
+            if (entry)
+            {
+                entry->incompressible = false;
+            }
+
+            Traits::discard(staged);
+            return false;
+        }
+
+        // Readers may be using the current content
+        if (m_concurrent)
+        {
+            Traits::discard(staged);
+            return false;
+        }
+
+        // Other ids may be using the content of a shared resource; a
+        // resource used by this id only stops being shared instead
+        Content* content = entry->digest ? m_contents.find(entry->digest) : 0;
+        if (content && content->refs == 1)
+        {
+            Content last;
+            m_contents.take(entry->digest, last);
+            entry->digest = 0;
+        }
+
+        if (InPlace::supported && !entry->digest)
+        {
+            if (!InPlace::commit(m_onLoad, *entry->resource, staged))
+            {
+                return false;
+            }
+
+            m_usage -= entry->bytes;
+            entry->bytes = ResourceSize<Resource>()(*entry->resource);
+            m_usage += entry->bytes;
+            ++entry->generation;
+
+            entry->incompressible = false;
+
+            SFTOOLS_TELEMETRY(m_telemetry.residentBytes = m_usage;)
+
+            enforceBudget();
+        }
+        else
+        {
+            ResourcePtr ptr = Traits::commit(m_onLoad, staged);
+
+            if (!ptr)
+            {
+                return false;
+            }
+
+            release(*entry);
+            entry->incompressible = false;
+            store(id, ptr);
+        }
+
+        SFTOOLS_TELEMETRY(++m_telemetry.reloads;)
+
+        return true;
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    void GenericManager<Resource, Id, OnLoad, Storage>::watchFile(Id const& id)
+    {
+        std::string const path = singleton::ResourceLocations::getInstance().resolve(id);
+
+        if (!path.empty())
+        {
+            std::string directory, name;
+            priv::splitPath(path, directory, name);
+
+            if (m_watcher->watch(directory))
+            {
+                // The resource may have moved to another location
+                unwatchFile(id);
+
+                m_watchedFiles[directory + "/" + name] = id;
+                m_watchedPaths[id] = directory + "/" + name;
+            }
+        }
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    void GenericManager<Resource, Id, OnLoad, Storage>::unwatchFile(Id const& id)
+    {
+        typename std::map<Id, std::string>::iterator it = m_watchedPaths.find(id);
+        if (it != m_watchedPaths.end())
+        {
+            m_watchedFiles.erase(it->second);
+            m_watchedPaths.erase(it);
+        }
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    void GenericManager<Resource, Id, OnLoad, Storage>::watchFiles()
+    {
+        std::vector<std::string> paths;
+        std::vector<Id> ids;
+        std::set<std::string> directories;
+
+        while (m_watching)
+        {
+            paths.clear();
+            if (!m_watcher->waitForChanges(paths, 100))
+            {
+                continue;
+            }
+
+            // Saving a file often triggers several events
+            std::sort(paths.begin(), paths.end());
+            paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+
+            ids.clear();
+            directories.clear();
+
+            {
+                std::lock_guard<std::mutex> lock(m_watchMutex);
+
+                for (std::size_t i = 0; i < paths.size(); ++i)
+                {
+                    typename std::map<std::string, Id>::const_iterator it = m_watchedFiles.find(paths[i]);
+                    if (it != m_watchedFiles.end())
+                    {
+                        ids.push_back(it->second);
+                    }
+                    else
+                    {
+                        // A new file : it may be one that failed to load
+                        std::string directory, name;
+                        priv::splitPath(paths[i], directory, name);
+                        directories.insert(directory);
+                    }
+                }
+            }
+
+            for (std::set<std::string>::const_iterator it = directories.begin(); it != directories.end(); ++it)
+            {
+                singleton::ResourceLocations::getInstance().refresh(*it);
+            }
+
+            for (std::size_t i = 0; i < ids.size(); ++i)
+            {
+                // m_usage belongs to the owning thread : ignore the budget
+                Staged* staged = stageResource(ids[i], Tiered::supported ? singleton::ResourceLocations::getInstance().getQuality() : 0, true);
+
+                if (staged)
+                {
+                    std::lock_guard<std::mutex> lock(m_watchMutex);
+                    m_reloads.push_back(Reload(ids[i], staged));
+                }
+            }
+        }
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    GenericManager<Resource, Id, OnLoad, Storage>::Reader::Reader(GenericManager const& manager)
+    : m_epochs(manager.m_epochs)
+    , m_token(m_epochs.enter())
+    , m_snapshot(manager.m_snapshot.load())
+    {
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    GenericManager<Resource, Id, OnLoad, Storage>::Reader::~Reader()
+    {
+        m_epochs.leave(m_token);
+    }
+
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    Resource const* GenericManager<Resource, Id, OnLoad, Storage>::Reader::find(Id const& id) const
+    {
+        if (!m_snapshot)
+        {
+            return 0;
+        }
+
+        Resource const* const* resource = m_snapshot->find(id);
+        return resource ? *resource : 0;
     }
 }
@@ -0,0 +1,122 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file sftools/ResourceManager/Handle.hpp
+ @brief Defines Handle class
+ */
+
+#ifndef __SFTOOLS_HANDLE_HPP__
+#define __SFTOOLS_HANDLE_HPP__
+
+#include <cstdint>
+
+/*!
+ @namespace sftools
+ @brief Simple and Fast Tools
+ */
+namespace sftools
+{
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    class GenericManager;
+
+    /*!
+     @class Handle
+     @brief Generational reference to a resource of a GenericManager
+
+     A handle is an index in the manager's table of handles together with
+     the generation of that slot. Fetching a resource through a handle is
+     one bounds-checked array access, without looking up its id. Unloading
+     the resource increments the generation of the slot, so handles
+     obtained before are detected as stale even if the slot is reused.
+
+     Handles are only meaningful to the manager that created them.
+
+     @tparam Resource Type of the resource
+
+     @see GenericManager::getHandle
+     */
+    template <typename Resource>
+    class Handle
+    {
+    public:
+        /*!
+         @brief Default constructor; a handle to nothing
+         */
+        Handle()
+        : m_index(Null), m_generation(0)
+        {
+            // That's it
+        }
+
+        /*!
+         @brief Tell whether the handle was obtained from a manager
+
+         @return false for default-constructed handles
+         */
+        bool isNull() const
+        {
+            return m_index == Null;
+        }
+
+        /*!
+         @brief Equality operator
+         */
+        bool operator==(Handle const& other) const
+        {
+            return m_index == other.m_index && m_generation == other.m_generation;
+        }
+
+        /*!
+         @brief Inequality operator
+         */
+        bool operator!=(Handle const& other) const
+        {
+            return !(*this == other);
+        }
+
+    private:
+        template <typename, typename, typename, template <typename, typename> class>
+        friend class GenericManager;
+
+        static std::uint32_t const Null = ~static_cast<std::uint32_t>(0); //!< Index of null handles
+
+        /*!
+         @brief Constructor used by GenericManager
+
+         @param index slot of the resource
+         @param generation generation of the slot
+         */
+        Handle(std::uint32_t index, std::uint32_t generation)
+        : m_index(index), m_generation(generation)
+        {
+            // That's it
+        }
+
+        std::uint32_t m_index; //!< Slot in the manager's table
+        std::uint32_t m_generation; //!< Generation of the slot when created
+    };
+}
+
+#endif // __SFTOOLS_HANDLE_HPP__
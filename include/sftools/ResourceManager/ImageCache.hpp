@@ -0,0 +1,414 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file sftools/ResourceManager/ImageCache.hpp
+ @brief Defines ImageCache class and ImageCache singleton object
+ @note Requires C++11
+ */
+
+#ifndef __SFTOOLS_IMAGECACHE_HPP__
+#define __SFTOOLS_IMAGECACHE_HPP__
+
+#include <sftools/Common/NonCopyable.hpp>
+#include <sftools/Singleton.hpp>
+#include <sftools/ResourceManager/FileSystem.hpp>
+#include <sftools/ResourceManager/Compression.hpp>
+#include <sftools/ResourceManager/ResourceId.hpp> // priv::fnv1a
+
+#include <SFML/Graphics/Image.hpp>
+#include <SFML/System/Clock.hpp>
+#include <SFML/System/Time.hpp>
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <atomic>
+#include <cstdio> // std::rename, std::remove
+#include <cstring>
+#include <cstdint>
+
+/*!
+ @namespace sftools
+ @brief Simple and Fast Tools
+ */
+namespace sftools
+{
+    namespace priv
+    {
+        /*!
+         @brief Header of an image cache file
+
+         It is followed by the path of the source file, without terminating
+         null character, and by the RGBA pixels, LZ4-compressed or not.
+         Integers use the native endianness; the cache is not meant to be
+         shared between machines.
+         */
+        struct ImageCacheHeader
+        {
+            char magic[4]; //!< "SFIC"
+            std::uint32_t version; //!< format version, currently 2
+            std::int64_t modified; //!< modification time of the source
+            std::uint64_t sourceSize; //!< size of the source
+            std::uint64_t sourceIdentity; //!< inode of the source
+            std::uint32_t width; //!< width of the image
+            std::uint32_t height; //!< height of the image
+            std::uint32_t compressed; //!< 1 if the pixels are LZ4-compressed
+            std::uint32_t pathLength; //!< length of the source path
+            std::uint64_t payloadSize; //!< size of the stored pixels
+            std::uint64_t decodeTime; //!< time needed to decode the source, in microseconds
+        };
+
+        std::uint32_t const ImageCacheVersion = 2; //!< Current format version
+    }
+
+    /*!
+     @class ImageCache
+     @brief On-disk cache of decoded images
+
+     Decoding compressed images (e.g. PNG) is often the most expensive part
+     of loading textures. Once a directory is given to the cache, the
+     decoded pixels of every image loaded by loader::LoadFromFile<sf::Image>
+     and loader::LoadFromFile<sf::Texture> are saved there, and the next
+     runs load them back without decoding the source again.
+
+     Cache files are keyed by the path of the source; an entry is stale, and
+     replaced, as soon as the modification time (with the resolution of the
+     file system), the size or the inode of the source changes.
+
+     @code
+
+     sftools::singleton::ImageCache::getInstance().setDirectory("cache");
+
+     @endcode
+
+     load() and store() can be used concurrently from several threads.
+
+     @see singleton::ImageCache
+     */
+    class ImageCache : sftools::NonCopyable
+    {
+    public:
+        /*!
+         @brief Constructor
+
+         The cache is disabled until setDirectory() is called.
+         */
+        ImageCache()
+        : m_compression(true)
+        , m_hits(0)
+        , m_misses(0)
+        , m_timeSaved(0)
+        , m_nextTemporary(0)
+        {
+            // That's it
+        }
+
+        /*!
+         @brief Set the directory holding the cache files
+
+         @note Call it before loading resources; it is not thread-safe.
+
+         @param directory an existing directory; empty disables the cache
+         */
+        void setDirectory(std::string const& directory)
+        {
+            m_directory = directory;
+        }
+
+        /*!
+         @brief Get the directory holding the cache files
+
+         @return the directory, or an empty string if the cache is disabled
+         */
+        std::string const& getDirectory() const
+        {
+            return m_directory;
+        }
+
+        /*!
+         @brief Enable or disable the compression of new cache files
+
+         Compression is enabled by default. LZ4 decompresses fast enough to
+         be faster than reading uncompressed pixels from most disks.
+
+         @note Call it before loading resources; it is not thread-safe.
+
+         @param enabled true to compress the pixels
+         */
+        void setCompression(bool enabled)
+        {
+            m_compression = enabled;
+        }
+
+        /*!
+         @brief Load an image from the cache
+
+         @param path path of the source file
+         @param image receives the cached pixels
+         @return false if the cache is disabled or doesn't hold an up-to-date
+                 copy of `path`
+         */
+        bool load(std::string const& path, sf::Image& image)
+        {
+            if (m_directory.empty())
+            {
+                return false;
+            }
+
+            sf::Clock clock;
+
+            priv::ImageCacheHeader header;
+            priv::MappedFile file;
+
+            if (!open(path, file, header))
+            {
+                ++m_misses;
+                return false;
+            }
+
+            std::size_t const pixelCount = static_cast<std::size_t>(header.width) * header.height * 4;
+            char const* payload = file.getData() + sizeof(header) + header.pathLength;
+
+            std::vector<char> pixels;
+            if (header.compressed)
+            {
+                pixels.resize(pixelCount);
+                if (pixelCount != 0 && !priv::lz4Decompress(payload, header.payloadSize, &pixels[0], pixelCount))
+                {
+                    ++m_misses;
+                    return false;
+                }
+                payload = pixels.empty() ? 0 : &pixels[0];
+            }
+
+            image.create(header.width, header.height, reinterpret_cast<sf::Uint8 const*>(payload));
+
+            ++m_hits;
+
+            long long const saved = static_cast<long long>(header.decodeTime) - clock.getElapsedTime().asMicroseconds();
+            if (saved > 0)
+            {
+                m_timeSaved += saved;
+            }
+
+            return true;
+        }
+
+        /*!
+         @brief Save a decoded image into the cache
+
+         @param path path of the source file
+         @param image decoded content of `path`
+         @param decodeTime time taken to decode `path`, used by
+                           getTimeSaved()
+         @return false if the cache is disabled or the cache file could not
+                 be written
+         */
+        bool store(std::string const& path, sf::Image const& image, sf::Time decodeTime)
+        {
+            if (m_directory.empty())
+            {
+                return false;
+            }
+
+            priv::ImageCacheHeader header;
+            std::memcpy(header.magic, "SFIC", 4);
+            header.version = priv::ImageCacheVersion;
+            header.width = image.getSize().x;
+            header.height = image.getSize().y;
+            header.compressed = 0;
+            header.pathLength = static_cast<std::uint32_t>(path.size());
+            header.decodeTime = static_cast<std::uint64_t>(decodeTime.asMicroseconds());
+
+            if (!priv::getFileInfo(path, header.modified, header.sourceSize, header.sourceIdentity))
+            {
+                return false;
+            }
+
+            std::size_t const pixelCount = static_cast<std::size_t>(header.width) * header.height * 4;
+            char const* payload = reinterpret_cast<char const*>(image.getPixelsPtr());
+            header.payloadSize = pixelCount;
+
+            std::vector<char> compressed;
+            if (m_compression && pixelCount != 0)
+            {
+                priv::lz4Compress(payload, pixelCount, compressed);
+
+                // Don't bother if it doesn't help
+                if (!compressed.empty() && compressed.size() < pixelCount)
+                {
+                    header.compressed = 1;
+                    header.payloadSize = compressed.size();
+                    payload = &compressed[0];
+                }
+            }
+
+            // Write a temporary file first so that readers never see a
+            // partial cache file
+            std::string const target = getCachePath(path);
+            std::string const temporary = target + "." + std::to_string(m_nextTemporary++) + ".tmp";
+
+            {
+                std::ofstream out(temporary.c_str(), std::ios::binary | std::ios::trunc);
+                out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+                out.write(path.data(), path.size());
+                out.write(payload, static_cast<std::streamsize>(header.payloadSize));
+
+                if (!out)
+                {
+                    out.close();
+                    std::remove(temporary.c_str());
+                    return false;
+                }
+            }
+
+#ifdef _WIN32
+            std::remove(target.c_str()); // rename doesn't overwrite on Windows
+#endif
+            if (std::rename(temporary.c_str(), target.c_str()) != 0)
+            {
+                std::remove(temporary.c_str());
+                return false;
+            }
+
+            return true;
+        }
+
+        /*!
+         @brief Get the number of images loaded from the cache
+
+         @return number of cache hits
+         */
+        std::size_t getHitCount() const
+        {
+            return m_hits.load();
+        }
+
+        /*!
+         @brief Get the number of images that had to be decoded
+
+         Stale and corrupted cache files count as misses.
+
+         @return number of cache misses
+         */
+        std::size_t getMissCount() const
+        {
+            return m_misses.load();
+        }
+
+        /*!
+         @brief Get the decoding time saved by the cache
+
+         @return sum, over all hits, of the time it took to decode the
+                 source minus the time it took to load the cache file
+         */
+        sf::Time getTimeSaved() const
+        {
+            return sf::microseconds(m_timeSaved.load());
+        }
+
+    private:
+        /*!
+         @brief Get the path of the cache file of a source
+
+         @param path path of the source file
+         @return path of the cache file
+         */
+        std::string getCachePath(std::string const& path) const
+        {
+            static char const digits[] = "0123456789abcdef";
+
+            unsigned long long const hash = priv::fnv1a(path.data(), path.size());
+
+            std::string name(16, '0');
+            for (std::size_t i = 0; i < 16; ++i)
+            {
+                name[15 - i] = digits[(hash >> (4 * i)) & 0xF];
+            }
+
+            return m_directory + "/" + name + ".sfic";
+        }
+
+        /*!
+         @brief Map and validate the cache file of a source
+
+         @param path path of the source file
+         @param file receives the mapping of the cache file
+         @param header receives the header of the cache file
+         @return false if there is no up-to-date and well-formed cache file
+         */
+        bool open(std::string const& path, priv::MappedFile& file, priv::ImageCacheHeader& header) const
+        {
+            std::int64_t modified = 0;
+            std::uint64_t sourceSize = 0;
+            std::uint64_t sourceIdentity = 0;
+
+            if (!priv::getFileInfo(path, modified, sourceSize, sourceIdentity) || !file.open(getCachePath(path)))
+            {
+                return false;
+            }
+
+            if (file.getSize() < sizeof(header))
+            {
+                return false;
+            }
+            std::memcpy(&header, file.getData(), sizeof(header));
+
+            std::size_t const pixelCount = static_cast<std::size_t>(header.width) * header.height * 4;
+
+            return std::memcmp(header.magic, "SFIC", 4) == 0
+                && header.version == priv::ImageCacheVersion
+                && header.modified == modified
+                && header.sourceSize == sourceSize
+                && header.sourceIdentity == sourceIdentity
+                && header.pathLength == path.size()
+                && file.getSize() == sizeof(header) + header.pathLength + header.payloadSize
+                && (header.compressed ? header.payloadSize <= file.getSize() : header.payloadSize == pixelCount)
+                && std::memcmp(file.getData() + sizeof(header), path.data(), path.size()) == 0;
+        }
+
+        std::string m_directory; //!< where cache files are stored; empty if disabled
+        bool m_compression; //!< compress new cache files
+        std::atomic<std::size_t> m_hits; //!< images loaded from the cache
+        std::atomic<std::size_t> m_misses; //!< images not found in the cache
+        std::atomic<long long> m_timeSaved; //!< in microseconds
+        std::atomic<unsigned long> m_nextTemporary; //!< makes temporary file names unique
+    };
+
+    /*!
+     @namespace sftools::singleton
+     @brief Contains singleton object typedefs
+     */
+    namespace singleton
+    {
+        /*!
+         @typedef sftools::singleton::ImageCache
+         @brief Cache used by the image and texture loaders
+         */
+        typedef sftools::Singleton<sftools::ImageCache> ImageCache;
+    }
+}
+
+#endif // __SFTOOLS_IMAGECACHE_HPP__
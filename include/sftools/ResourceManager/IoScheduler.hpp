@@ -0,0 +1,280 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file sftools/ResourceManager/IoScheduler.hpp
+ @brief Defines the helpers used to order and read ahead bulk loads
+ */
+
+#ifndef __SFTOOLS_IOSCHEDULER_HPP__
+#define __SFTOOLS_IOSCHEDULER_HPP__
+
+#include <string>
+#include <vector>
+#include <algorithm> // std::stable_sort
+#include <cstddef>
+#include <cstdint>
+
+#ifndef _WIN32
+    #include <sys/types.h>
+    #include <sys/stat.h>
+    #include <sys/mman.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+/*!
+ @namespace sftools
+ @brief Simple and Fast Tools
+ */
+namespace sftools
+{
+    namespace priv
+    {
+        /*!
+         @brief Physical location of the data of a resource
+
+         Requests are ordered by device, then by position on the device,
+         which approximates the order of the data on disk.
+         */
+        struct IoRequest
+        {
+            /*!
+             @brief Default constructor; an unknown location
+             */
+            IoRequest()
+            : device(0), position(0), data(0), size(0)
+            {
+            }
+
+            std::uint64_t device; //!< Device holding the data
+            std::uint64_t position; //!< Inode of the file, or address in a mapping
+            std::string path; //!< File to read ahead, or empty
+            char const* data; //!< Mapped memory to read ahead, or 0
+            std::size_t size; //!< Size of the mapped memory
+        };
+
+        /*!
+         @brief Order requests by physical location
+         */
+        inline bool operator<(IoRequest const& a, IoRequest const& b)
+        {
+            return a.device != b.device ? a.device < b.device : a.position < b.position;
+        }
+
+        /*!
+         @brief Locate a file
+
+         @param path file to locate
+         @param request receives the location of the file
+         @return false if the file doesn't exist or if it can't be located
+                 on this system
+         */
+        inline bool locateFile(std::string const& path, IoRequest& request)
+        {
+#ifdef _WIN32
+            (void)path;
+            (void)request;
+            return false;
+#else
+            struct stat info;
+            if (stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode))
+            {
+                return false;
+            }
+
+            request.device = static_cast<std::uint64_t>(info.st_dev);
+            request.position = static_cast<std::uint64_t>(info.st_ino);
+            request.path = path;
+            return true;
+#endif
+        }
+
+        /*!
+         @brief Locate a memory block of a mapped file
+
+         Blocks of the same mapping are ordered by address, hence by offset
+         in the file.
+
+         @param data first byte of the block
+         @param size size of the block
+         @param request receives the location of the block
+         */
+        inline void locateMemory(char const* data, std::size_t size, IoRequest& request)
+        {
+            request.device = ~static_cast<std::uint64_t>(0); // after real devices
+            request.position = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(data));
+            request.data = data;
+            request.size = size;
+        }
+
+        /*!
+         @brief Ask the system to read the data of a request in the
+                background
+
+         It doesn't wait for the data; reads issued afterwards find it in
+         the page cache.
+
+         @param request location of the data
+         */
+        inline void readAhead(IoRequest const& request)
+        {
+#ifndef _WIN32
+            if (request.data && request.size > 0)
+            {
+                // Advice is given on whole pages
+                std::uintptr_t const page = static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+                std::uintptr_t const begin = reinterpret_cast<std::uintptr_t>(request.data) & ~(page - 1);
+                std::uintptr_t const end = reinterpret_cast<std::uintptr_t>(request.data) + request.size;
+
+                posix_madvise(reinterpret_cast<void*>(begin), end - begin, POSIX_MADV_WILLNEED);
+            }
+    #ifdef __linux__
+            else if (!request.path.empty())
+            {
+                int const fd = open(request.path.c_str(), O_RDONLY | O_CLOEXEC);
+                if (fd >= 0)
+                {
+                    posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+                    close(fd);
+                }
+            }
+    #endif
+#else
+            (void)request;
+#endif
+        }
+
+        /*!
+         @class IoSchedule
+         @brief Order a batch of loads by physical location
+
+         Located loads come first, sorted by location; the others keep the
+         order in which they were added.
+
+         @tparam Id Type of resources' identifiers
+         */
+        template <typename Id>
+        class IoSchedule
+        {
+        public:
+            /*!
+             @brief Add a load to the batch
+
+             @param id id of the resource
+             @param request location of its data
+             @param located false if `request` is unknown
+             */
+            void add(Id const& id, IoRequest const& request, bool located)
+            {
+                Load const load = { id, request, located };
+                m_loads.push_back(load);
+            }
+
+            /*!
+             @brief Sort the batch
+             */
+            void sort()
+            {
+                std::stable_sort(m_loads.begin(), m_loads.end(), &IoSchedule::before);
+            }
+
+            /*!
+             @brief Get the size of the batch
+
+             @return number of loads
+             */
+            std::size_t size() const
+            {
+                return m_loads.size();
+            }
+
+            /*!
+             @brief Get the id of a load
+
+             @param i index of the load
+             @return its id
+             */
+            Id const& getId(std::size_t i) const
+            {
+                return m_loads[i].id;
+            }
+
+            /*!
+             @brief Get the location of a load
+
+             @param i index of the load
+             @return its location, or 0 if it is unknown
+             */
+            IoRequest const* getRequest(std::size_t i) const
+            {
+                return m_loads[i].located ? &m_loads[i].request : 0;
+            }
+
+            /*!
+             @brief Get the locations to read ahead, in order
+
+             @param requests receives the locations of the located loads
+             */
+            void getRequests(std::vector<IoRequest>& requests) const
+            {
+                for (std::size_t i = 0; i < m_loads.size(); ++i)
+                {
+                    if (m_loads[i].located)
+                    {
+                        requests.push_back(m_loads[i].request);
+                    }
+                }
+            }
+
+        private:
+            /*!
+             @brief A load of the batch
+             */
+            struct Load
+            {
+                Id id; //!< Resource to load
+                IoRequest request; //!< Location of its data
+                bool located; //!< false if `request` is unknown
+            };
+
+            /*!
+             @brief Ordering of the loads
+             */
+            static bool before(Load const& a, Load const& b)
+            {
+                if (a.located != b.located)
+                {
+                    return a.located;
+                }
+
+                return a.located && a.request < b.request;
+            }
+
+            std::vector<Load> m_loads; //!< The batch
+        };
+    }
+}
+
+#endif // __SFTOOLS_IOSCHEDULER_HPP__
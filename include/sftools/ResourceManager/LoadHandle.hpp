@@ -0,0 +1,115 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file sftools/ResourceManager/LoadHandle.hpp
+ @brief Defines LoadHandle class
+ @note Requires C++11
+ */
+
+#ifndef __SFTOOLS_LOADHANDLE_HPP__
+#define __SFTOOLS_LOADHANDLE_HPP__
+
+#include <atomic>
+#include <memory>
+
+/*!
+ @namespace sftools
+ @brief Simple and Fast Tools
+ */
+namespace sftools
+{
+    /*!
+     @class LoadHandle
+     @brief Track the progress of an asynchronous load
+
+     Handles are cheap to copy; all copies share the same status.
+
+     @see GenericManager::loadAsync
+     */
+    class LoadHandle
+    {
+    public:
+        /*!
+         @enum Status
+         @brief Stages of an asynchronous load
+         */
+        enum Status
+        {
+            Pending = 0, //!< Waiting for or being decoded by a worker
+            Decoded,     //!< Decoded; waiting for GenericManager::poll
+            Loaded,      //!< Available through the manager
+            Failed       //!< Could not be loaded
+        };
+
+        typedef std::atomic<int> State; //!< Shared state type
+
+        /*!
+         @brief Constructor
+
+         @param state shared status; a null state means the load failed
+         */
+        explicit LoadHandle(std::shared_ptr<State> const& state)
+        : m_state(state)
+        {
+            // That's it
+        }
+
+        /*!
+         @brief Get the current status of the load
+
+         @return current status
+         */
+        Status getStatus() const
+        {
+            return m_state ? static_cast<Status>(m_state->load()) : Failed;
+        }
+
+        /*!
+         @brief Tell if the load is over, whether it succeeded or not
+
+         @return true if the status is either Loaded or Failed
+         */
+        bool isDone() const
+        {
+            Status status = getStatus();
+            return status == Loaded || status == Failed;
+        }
+
+        /*!
+         @brief Tell if the resource can be fetched from its manager
+
+         @return true if the status is Loaded
+         */
+        bool isLoaded() const
+        {
+            return getStatus() == Loaded;
+        }
+
+    private:
+        std::shared_ptr<State> m_state; //!< Status shared with the manager
+    };
+}
+
+#endif // __SFTOOLS_LOADHANDLE_HPP__
@@ -0,0 +1,174 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file sftools/ResourceManager/LoadProgress.hpp
+ @brief Defines LoadProgress class
+ @note Requires C++11
+ */
+
+#ifndef __SFTOOLS_LOADPROGRESS_HPP__
+#define __SFTOOLS_LOADPROGRESS_HPP__
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+
+/*!
+ @namespace sftools
+ @brief Simple and Fast Tools
+ */
+namespace sftools
+{
+    /*!
+     @class LoadProgress
+     @brief Track the progress of a batch of asynchronous loads
+
+     The counters are lock-free and can be read every frame, from any
+     thread. Like LoadHandle, copies share the same counters.
+
+     @code
+
+     sftools::LoadProgress progress = manager.preload(ids.begin(), ids.end());
+
+     while (!progress.isDone())
+     {
+         manager.poll(sf::milliseconds(4));
+         drawLoadingBar(progress.getRatio());
+     }
+
+     @endcode
+
+     @see GenericManager::preload
+     */
+    class LoadProgress
+    {
+    public:
+        /*!
+         @brief Counters shared by the manager and the progress objects
+         */
+        struct Counters
+        {
+            Counters()
+            : total(0), loaded(0), failed(0), bytes(0)
+            {
+                // That's it
+            }
+
+            std::atomic<std::size_t> total; //!< Number of resources requested
+            std::atomic<std::size_t> loaded; //!< Number of resources available
+            std::atomic<std::size_t> failed; //!< Number of failed loads
+            std::atomic<std::size_t> bytes; //!< Estimated size of the loaded resources
+        };
+
+        /*!
+         @brief Constructor
+
+         @param counters shared counters
+         */
+        explicit LoadProgress(std::shared_ptr<Counters> const& counters)
+        : m_counters(counters)
+        {
+            // That's it
+        }
+
+        /*!
+         @brief Get the number of resources of the batch
+
+         @return number of resources
+         */
+        std::size_t getTotal() const
+        {
+            return m_counters->total.load();
+        }
+
+        /*!
+         @brief Get the number of resources loaded so far
+
+         @return number of resources available through the manager
+         */
+        std::size_t getLoaded() const
+        {
+            return m_counters->loaded.load();
+        }
+
+        /*!
+         @brief Get the number of resources that could not be loaded
+
+         @return number of failed loads
+         */
+        std::size_t getFailed() const
+        {
+            return m_counters->failed.load();
+        }
+
+        /*!
+         @brief Get the number of resources processed so far
+
+         @return number of loaded and failed resources
+         */
+        std::size_t getDone() const
+        {
+            return getLoaded() + getFailed();
+        }
+
+        /*!
+         @brief Get the estimated size of the resources loaded so far
+
+         @return size in bytes, as estimated by ResourceSize
+
+         @see ResourceSize
+         */
+        std::size_t getBytes() const
+        {
+            return m_counters->bytes.load();
+        }
+
+        /*!
+         @brief Get the progress as a ratio
+
+         @return a value between 0 and 1; 1 for an empty batch
+         */
+        float getRatio() const
+        {
+            std::size_t const total = getTotal();
+            return total == 0 ? 1.f : static_cast<float>(getDone()) / total;
+        }
+
+        /*!
+         @brief Tell if every load of the batch is over
+
+         @return true if all resources were either loaded or failed
+         */
+        bool isDone() const
+        {
+            return getDone() >= getTotal();
+        }
+
+    private:
+        std::shared_ptr<Counters> m_counters; //!< Counters shared with the manager
+    };
+}
+
+#endif // __SFTOOLS_LOADPROGRESS_HPP__
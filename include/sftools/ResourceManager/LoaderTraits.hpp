@@ -0,0 +1,291 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file sftools/ResourceManager/LoaderTraits.hpp
+ @brief Defines the adapter used by GenericManager to talk to its loader
+ */
+
+#ifndef __SFTOOLS_LOADERTRAITS_HPP__
+#define __SFTOOLS_LOADERTRAITS_HPP__
+
+#include <sftools/ResourceManager/Allocator.hpp>
+#include <sftools/ResourceManager/IoScheduler.hpp>
+
+#include <string>
+#include <utility> // std::declval
+#include <vector>
+
+/*!
+ @namespace sftools
+ @brief Simple and Fast Tools
+ */
+namespace sftools
+{
+    namespace priv
+    {
+        /*!
+         @brief Helper used to detect nested types
+         */
+        template <typename T>
+        struct Void
+        {
+            typedef void Type;
+        };
+
+        /*!
+         @brief Adapt an `OnLoad` procedure to the features GenericManager
+                expects from it
+
+         Loaders that don't define a `Staged` type (e.g. plain user functors)
+         are decoded in one step: the staged object is the resource itself.
+
+         @tparam OnLoad   Procedure type to load resources
+         @tparam Resource Type of the resource
+         */
+        template <typename OnLoad, typename Resource, typename Enable = void>
+        struct LoaderTraits
+        {
+            typedef Resource Staged; //!< Type produced by worker threads
+
+            /*!
+             @brief Decode a resource; may be called from any thread
+             */
+            template <typename Id>
+            static Staged* stage(OnLoad& onLoad, Id const& id)
+            {
+                return onLoad(id);
+            }
+
+            /*!
+             @brief Turn a staged object into a resource; takes ownership of
+                    `staged`
+             */
+            static Resource* commit(OnLoad&, Staged* staged)
+            {
+                return staged;
+            }
+
+            /*!
+             @brief Destroy a staged object that won't be committed
+             */
+            static void discard(Staged* staged)
+            {
+                ResourceAllocator<Staged>::destroy(staged);
+            }
+        };
+
+        /*!
+         @brief Specialisation for loaders defining their own staging process
+
+         @see loader::ResourceLoader::stage
+         @see loader::ResourceLoader::commit
+         */
+        template <typename OnLoad, typename Resource>
+        struct LoaderTraits<OnLoad, Resource, typename Void<typename OnLoad::Staged>::Type>
+        {
+            typedef typename OnLoad::Staged Staged; //!< Type produced by worker threads
+
+            template <typename Id>
+            static Staged* stage(OnLoad& onLoad, Id const& id)
+            {
+                return onLoad.stage(id);
+            }
+
+            static Resource* commit(OnLoad& onLoad, Staged* staged)
+            {
+                return onLoad.commit(staged);
+            }
+
+            static void discard(Staged* staged)
+            {
+                ResourceAllocator<Staged>::destroy(staged);
+            }
+        };
+
+        /*!
+         @brief Tell whether a loader can refresh an existing resource
+
+         Loaders opt in by defining `bool commitInto(Resource&, Staged*)`,
+         which replaces the content of a resource with a staged object
+         (taking its ownership) without changing its address.
+
+         @see loader::LoadFromFile::commitInto
+         */
+        template <typename OnLoad, typename Resource, typename Staged, typename Enable = void>
+        struct InPlaceCommit
+        {
+            static bool const supported = false; //!< No commitInto()
+
+            static bool commit(OnLoad&, Resource&, Staged*)
+            {
+                return false; // never called
+            }
+        };
+
+        /*!
+         @brief Specialisation for loaders defining commitInto()
+         */
+        template <typename OnLoad, typename Resource, typename Staged>
+        struct InPlaceCommit<OnLoad, Resource, Staged,
+                             typename Void<decltype(std::declval<OnLoad&>().commitInto(std::declval<Resource&>(),
+                                                                                       static_cast<Staged*>(0)))>::Type>
+        {
+            static bool const supported = true; //!< commitInto() is available
+
+            static bool commit(OnLoad& onLoad, Resource& target, Staged* staged)
+            {
+                return onLoad.commitInto(target, staged);
+            }
+        };
+
+        /*!
+         @brief Tell whether a loader can load lower quality tiers
+
+         Loaders opt in by defining `Staged* stage(Id const&, unsigned tier)`;
+         other loaders always load the full quality.
+
+         @see Locations::setTierPrefix
+         @see loader::LoadFromFile<sf::Image>
+         */
+        template <typename OnLoad, typename Staged, typename Id, typename Enable = void>
+        struct TieredStage
+        {
+            static bool const supported = false; //!< No tiered stage()
+
+            static Staged* stage(OnLoad&, Id const&, unsigned)
+            {
+                return 0; // never called
+            }
+        };
+
+        /*!
+         @brief Specialisation for loaders defining a tiered stage()
+         */
+        template <typename OnLoad, typename Staged, typename Id>
+        struct TieredStage<OnLoad, Staged, Id,
+                           typename Void<decltype(std::declval<OnLoad&>().stage(std::declval<Id const&>(), 0u))>::Type>
+        {
+            static bool const supported = true; //!< stage(id, tier) is available
+
+            static Staged* stage(OnLoad& onLoad, Id const& id, unsigned tier)
+            {
+                return onLoad.stage(id, tier);
+            }
+        };
+
+        /*!
+         @brief Tell whether a loader can locate the data of a resource
+
+         Loaders opt in by defining `bool locate(Id const&, IoRequest&)`,
+         which lets GenericManager::preload() order loads by physical
+         location and read their data ahead.
+
+         @see loader::ResourceLoader::locate
+         */
+        template <typename OnLoad, typename Id, typename Enable = void>
+        struct IoLocator
+        {
+            static bool const supported = false; //!< No locate()
+
+            static bool locate(OnLoad&, Id const&, IoRequest&)
+            {
+                return false;
+            }
+        };
+
+        /*!
+         @brief Specialisation for loaders defining locate()
+         */
+        template <typename OnLoad, typename Id>
+        struct IoLocator<OnLoad, Id,
+                         typename Void<decltype(std::declval<OnLoad&>().locate(std::declval<Id const&>(),
+                                                                               std::declval<IoRequest&>()))>::Type>
+        {
+            static bool const supported = true; //!< locate() is available
+
+            static bool locate(OnLoad& onLoad, Id const& id, IoRequest& request)
+            {
+                return onLoad.locate(id, request);
+            }
+        };
+
+        /*!
+         @brief Tell whether a loader reads the files of a batch itself
+
+         Loaders opt in by defining `void expectBatch(std::vector<IoRequest>
+         const&)`, called by GenericManager::preload() before the decoders
+         of a batch are queued, `void readBatch(std::vector<IoRequest>
+         const&)`, called by a worker thread instead of readAhead(), and
+         `void dropBatchFile(std::string const&)`, called once the decoder
+         of a file of the batch is done, whether it used the file or not.
+
+         @see loader::LoadFromBatch
+         */
+        template <typename OnLoad, typename Enable = void>
+        struct BatchReading
+        {
+            static bool const supported = false; //!< No readBatch()
+
+            static void expect(OnLoad&, std::vector<IoRequest> const&)
+            {
+            }
+
+            static void read(OnLoad&, std::vector<IoRequest> const&)
+            {
+            }
+
+            static void drop(OnLoad&, std::string const&)
+            {
+            }
+        };
+
+        /*!
+         @brief Specialisation for loaders defining readBatch()
+         */
+        template <typename OnLoad>
+        struct BatchReading<OnLoad,
+                            typename Void<decltype(std::declval<OnLoad&>().readBatch(std::declval<std::vector<IoRequest> const&>()))>::Type>
+        {
+            static bool const supported = true; //!< readBatch() is available
+
+            static void expect(OnLoad& onLoad, std::vector<IoRequest> const& requests)
+            {
+                onLoad.expectBatch(requests);
+            }
+
+            static void read(OnLoad& onLoad, std::vector<IoRequest> const& requests)
+            {
+                onLoad.readBatch(requests);
+            }
+
+            static void drop(OnLoad& onLoad, std::string const& path)
+            {
+                onLoad.dropBatchFile(path);
+            }
+        };
+    }
+}
+
+#endif // __SFTOOLS_LOADERTRAITS_HPP__
@@ -31,7 +31,14 @@
 #define __SFTOOLS_LOADERS_HPP__
 
 #include <sftools/ResourceManager/Locations.hpp>
+#include <sftools/ResourceManager/PackFile.hpp>
+#include <sftools/ResourceManager/Allocator.hpp>
+#include <sftools/ResourceManager/IoScheduler.hpp>
+#include <sftools/ResourceManager/BatchRead.hpp>
 #include <string>
+#include <vector>
+#include <memory>
+#include <cstddef>
 
 /*!
  @namespace sftools
@@ -39,6 +46,35 @@
  */
 namespace sftools
 {
+    namespace priv
+    {
+        /*!
+         @brief Decode a resource from the content of its file
+
+         Used by loader::LoadFromBatch; specialise it for resources that
+         are loaded differently, e.g. through a cache.
+
+         @tparam R Resource type, with `loadFromMemory()`
+         */
+        template <typename R>
+        struct MemoryDecoder
+        {
+            /*!
+             @brief Decode a resource
+
+             @param resource resource to be fed with the content
+             @param path file the content was read from
+             @param data content of the file, not empty
+             @return true on success
+             */
+            static bool decode(R& resource, std::string const& path, std::vector<char> const& data)
+            {
+                (void)path;
+                return resource.loadFromMemory(&data[0], data.size());
+            }
+        };
+    }
+
     /*!
      @namespace sftools::loader
      @brief Contains loader utilities for the resource managers
@@ -56,10 +92,20 @@ namespace sftools
          @see GenericManager
          @see LoadFromFile
          @see OpenFromFile
+         @see LoadFromPack
          */
         template <typename R>
         struct ResourceLoader
         {
+            /*!
+             @brief Type of the object produced by stage()
+
+             Subclasses can redefine it, together with stage() and commit(),
+             to move only the expensive part of the loading process to
+             GenericManager's worker threads.
+             */
+            typedef R Staged;
+
             /*!
              @brief Virtual destructor
              */
@@ -71,7 +117,10 @@ namespace sftools
             /*!
              @brief Load operator
              
-             It create a resource and use load() to initialize its content.
+             It locates the file with Locations::resolve(), create a resource
+             with ResourceAllocator and use load() to initialize its content.
+             Only one file is opened, and nothing is allocated if no location
+             holds the file.
              
              @param id Resource id to load
              @return a pointer to a valid R object if load() succeed or 0 if it
@@ -79,28 +128,74 @@ namespace sftools
              */
             R* operator()(std::string const& id)
             {
-                R* ptr = new R;
-
                 Locations& locs = singleton::ResourceLocations::getInstance();
 
                 // Find the first location that holds an file called "id"
-                for (Locations::ConstIterator it = locs.begin();
-                     it != locs.end();
-                     ++it)
+                std::string const path = locs.resolve(id);
+                if (path.empty())
+                {
+                    return 0;
+                }
+
+                R* ptr = ResourceAllocator<R>::create();
+
+                if (load(*ptr, path))
                 {
-                    if (load(*ptr, *it + id))
-                    {
-                        return ptr; // Success!
-                    }
+                    return ptr; // Success!
                 }
 
                 // Hum... got here ?
                 // This means the resource was not loaded properly.
-                delete ptr;
+                ResourceAllocator<R>::destroy(ptr);
                 ptr = 0;
                 return 0;
             }
 
+            /*!
+             @brief Decode a resource on a worker thread
+
+             By default the whole resource is loaded here.
+
+             @param id Resource id to load
+             @return a pointer to a valid staged object or 0 on failure
+
+             @see GenericManager::loadAsync
+             */
+            Staged* stage(std::string const& id)
+            {
+                return (*this)(id);
+            }
+
+            /*!
+             @brief Finalize a staged resource on the thread owning the manager
+
+             By default the staged object is the resource itself.
+
+             @param staged object returned by stage(); ownership is taken
+             @return a pointer to a valid R object or 0 on failure
+
+             @see GenericManager::poll
+             */
+            R* commit(Staged* staged)
+            {
+                return staged;
+            }
+
+            /*!
+             @brief Locate the file of a resource
+
+             @param id Resource id
+             @param request receives the location of the file
+             @return false if the file can't be found or located
+
+             @see GenericManager::preload
+             */
+            bool locate(std::string const& id, priv::IoRequest& request)
+            {
+                std::string const path = singleton::ResourceLocations::getInstance().resolve(id);
+                return !path.empty() && priv::locateFile(path, request);
+            }
+
             /*!
              @brief Load the content of a resource with the given file
              
@@ -126,20 +221,289 @@ namespace sftools
             {
                 return res.loadFromFile(src);
             }
+
+            /*!
+             @brief Replace the content of a resource, keeping its address
+
+             @param res resource to be updated
+             @param staged new content; ownership is taken
+             @return true on success
+
+             @see GenericManager::applyReloads
+             */
+            bool commitInto(R& res, R* staged)
+            {
+                res = *staged;
+                ResourceAllocator<R>::destroy(staged);
+                return true;
+            }
+        };
+
+        /*!
+         @brief Loader reading the files of preloaded batches at once
+
+         When GenericManager::preload() loads a batch, one worker reads all
+         its files into memory, through io_uring on Linux when
+         `SFTOOLS_IO_URING` is defined (see BatchRead.hpp), while the other
+         workers decode the files already read with `loadFromMemory()`.
+         Other asynchronous loads read their file in one go with pread().
+         Synchronous loads and lower quality tiers use LoadFromFile, and
+         are not read ahead. Files are decoded with priv::MemoryDecoder,
+         which goes through singleton::ImageCache for sf::Image and
+         sf::Texture.
+
+         Only use it with resources that copy the memory they are loaded
+         from; sf::Font and sf::Music don't.
+
+         @tparam R Resource type
+
+         @see LoadFromFile
+         */
+        template <typename R>
+        struct LoadFromBatch : LoadFromFile<R>
+        {
+            typedef typename LoadFromFile<R>::Staged Staged; //!< Decoded by the workers
+
+            using LoadFromFile<R>::stage;
+
+            /*!
+             @brief Constructor
+             */
+            LoadFromBatch()
+            : m_files(std::make_shared<priv::BufferCache>())
+            {
+                // That's it
+            }
+
+            /*!
+             @brief Decode a resource from its file in memory
+
+             @param id Resource id to load
+             @return a pointer to a valid staged object or 0 on failure
+             */
+            Staged* stage(std::string const& id)
+            {
+                priv::FileRead file;
+                file.path = singleton::ResourceLocations::getInstance().resolve(id);
+                if (file.path.empty())
+                {
+                    return 0;
+                }
+
+                // Not part of a batch ?
+                if (!m_files->take(file))
+                {
+                    priv::readFile(file);
+                }
+
+                if (!file.success || file.data.empty())
+                {
+                    return 0;
+                }
+
+                Staged* staged = ResourceAllocator<Staged>::create();
+
+                if (!priv::MemoryDecoder<Staged>::decode(*staged, file.path, file.data))
+                {
+                    ResourceAllocator<Staged>::destroy(staged);
+                    staged = 0;
+                }
+
+                return staged;
+            }
+
+            /*!
+             @brief Register the files of a batch before its decoders start
+
+             @param requests located resources of the batch
+             */
+            void expectBatch(std::vector<priv::IoRequest> const& requests)
+            {
+                m_files->expect(requests);
+            }
+
+            /*!
+             @brief Read the files of a batch
+
+             @param requests located resources of the batch
+             */
+            void readBatch(std::vector<priv::IoRequest> const& requests)
+            {
+                m_files->read(requests);
+            }
+
+            /*!
+             @brief Forget a file of a batch that was not decoded
+
+             @param path file whose decoder is done
+             */
+            void dropBatchFile(std::string const& path)
+            {
+                m_files->drop(path);
+            }
+
+            /*!
+             @brief Get the number of files of batches waiting for their decoder
+
+             @return number of files registered and not decoded yet
+             */
+            std::size_t getPendingFiles() const
+            {
+                return m_files->size();
+            }
+
+        private:
+            std::shared_ptr<priv::BufferCache> m_files; //!< Shared by the copies of the loader
         };
 
         /*!
          @brief Specialisation of ResourceLoader for `openFromFile()`-resources
 
+         Such resources (e.g. sf::Music) stream their file and can't be
+         copied : staging only locates the file, which is then opened on the
+         thread owning the manager.
+
          @tparam R Resource type
          */
         template <typename R>
         struct OpenFromFile : ResourceLoader<R>
         {
+            typedef std::string Staged; //!< Path of the file
+
             bool load(R& res, std::string src)
             {
                 return res.openFromFile(src);
             }
+
+            Staged* stage(std::string const& id)
+            {
+                std::string const path = singleton::ResourceLocations::getInstance().resolve(id);
+                return path.empty() ? 0 : ResourceAllocator<Staged>::create(path);
+            }
+
+            /*!
+             @brief Don't read streamed files ahead; they are read
+                    progressively while playing
+             */
+            bool locate(std::string const&, priv::IoRequest&)
+            {
+                return false;
+            }
+
+            R* commit(Staged* path)
+            {
+                R* ptr = ResourceAllocator<R>::create();
+
+                if (!load(*ptr, *path))
+                {
+                    ResourceAllocator<R>::destroy(ptr);
+                    ptr = 0;
+                }
+
+                ResourceAllocator<Staged>::destroy(path);
+                return ptr;
+            }
+
+            /*!
+             @brief Reopen a resource, keeping its address
+
+             @param res resource to be reopened
+             @param path new file; ownership is taken
+             @return true on success
+             */
+            bool commitInto(R& res, Staged* path)
+            {
+                bool const success = load(res, *path);
+                ResourceAllocator<Staged>::destroy(path);
+                return success;
+            }
+        };
+
+        /*!
+         @brief Loader for `loadFromMemory()`-resources stored in
+                singleton::ResourcePack
+
+         Resources are decoded straight from the memory mapping of the
+         archive; ResourceLocations is not used.
+
+         @code
+
+         typedef sftools::GenericManager<sf::SoundBuffer,
+                                         std::string,
+                                         sftools::loader::LoadFromPack<sf::SoundBuffer> >
+                 PackedSoundBufferManager;
+
+         @endcode
+
+         @tparam R Resource type
+
+         @see PackFile
+         */
+        template <typename R>
+        struct LoadFromPack
+        {
+            /*!
+             @brief Load operator
+
+             @param id Resource id to load
+             @return a pointer to a valid R object or 0 if the archive doesn't
+                     contain `id` or if decoding failed
+             */
+            R* operator()(std::string const& id)
+            {
+                char const* data = 0;
+                std::size_t size = 0;
+
+                if (!singleton::ResourcePack::getInstance().find(id, data, size))
+                {
+                    return 0;
+                }
+
+                R* ptr = ResourceAllocator<R>::create();
+
+                if (ptr->loadFromMemory(data, size))
+                {
+                    return ptr;
+                }
+
+                ResourceAllocator<R>::destroy(ptr);
+                return 0;
+            }
+
+            /*!
+             @brief Locate a resource in the archive
+
+             @param id Resource id
+             @param request receives the location of the resource
+             @return false if the archive doesn't contain `id`
+             */
+            bool locate(std::string const& id, priv::IoRequest& request)
+            {
+                char const* data = 0;
+                std::size_t size = 0;
+
+                if (!singleton::ResourcePack::getInstance().find(id, data, size))
+                {
+                    return false;
+                }
+
+                priv::locateMemory(data, size, request);
+                return true;
+            }
+
+            /*!
+             @brief Replace the content of a resource, keeping its address
+
+             @param res resource to be updated
+             @param staged new content; ownership is taken
+             @return true on success
+             */
+            bool commitInto(R& res, R* staged)
+            {
+                res = *staged;
+                ResourceAllocator<R>::destroy(staged);
+                return true;
+            }
         };
     }
 }
@@ -32,9 +32,16 @@
 
 #include <sftools/Common/NonCopyable.hpp>
 #include <sftools/Singleton.hpp>
+#include <sftools/ResourceManager/FileSystem.hpp>
+#include <sftools/ResourceManager/Telemetry.hpp>
 
 #include <string>
 #include <vector>
+#include <map>
+#include <set>
+#include <memory>
+#include <mutex>
+#include <atomic>
 #include <algorithm>
 
 /*!
@@ -58,6 +65,25 @@ namespace sftools
              (e.g. if $path is "high_definition_" implies that load("foo") will
              load "hight_definition_foo" files).
 
+     Instead of probing every location each time a resource is loaded,
+     resolve() looks files up in an index of the directories' content. The
+     index is built lazily, one directory listing at a time, and dropped
+     whenever the locations change. The listings are trusted : call
+     refresh() if files are added or removed while the application is
+     running, and make ids match the case of the file names even if the
+     file system ignores it. Only directories that can't be listed are
+     probed on disk.
+
+     Resources can come in several quality tiers. Tier 0 is the full
+     quality; the files of tier N are named with the prefix given to
+     setTierPrefix() (e.g. "half/" or "low_"). setQuality() selects the
+     tier loaded by default. When a tier has no file for a resource,
+     resolve(std::string const&, unsigned, unsigned&) falls back to the
+     next better tier and the loaders of sf::Image and sf::Texture
+     downscale it.
+
+     All methods are thread-safe.
+
      @todo It could be interesting to have a `Path` class and be able to
            do something like
            `Locations loc; loc.add({"res"}.add({"img"}, {"snd"}), {"extra"})`.
@@ -69,11 +95,54 @@ namespace sftools
     {
         typedef std::vector<std::string> Storage; //!< Private storage type
         typedef Storage::iterator Iterator; //!< Private mutable iterator type
-        Storage m_locations; //!< locations storage
+
+        /*!
+         @brief Result of a resolution
+         */
+        struct Resolution
+        {
+            std::string path; //!< resolved path, empty if not found
+            std::size_t probes; //!< locations checked to resolve it
+        };
+
+        /*!
+         @brief Content of a directory
+         */
+        struct Listing
+        {
+            std::set<std::string> files; //!< names of the regular files
+            bool readable; //!< false if the directory could not be listed
+        };
+
+        typedef std::shared_ptr<Storage const> Snapshot; //!< Locations shared with resolve()
+        typedef std::map<std::string, Resolution> Index; //!< id -> resolution
+        typedef std::map<std::string, Listing> Listings; //!< directory -> files
+        typedef std::map<unsigned, std::string> Tiers; //!< tier -> prefix
+
+        Snapshot m_locations; //!< locations storage, replaced on change
+        Index m_index; //!< resolved ids
+        Listings m_listings; //!< content of the directories visited so far
+        Tiers m_tiers; //!< prefixes of the quality tiers
+        std::atomic<unsigned long> m_avoidedProbes; //!< see getAvoidedProbes()
+        std::atomic<unsigned long> m_version; //!< see getVersion()
+        std::atomic<unsigned> m_quality; //!< see getQuality()
+        mutable std::mutex m_mutex; //!< protects everything above
 
     public:
         typedef Storage::const_iterator ConstIterator; //!< Constant iterator type
 
+        /*!
+         @brief Default constructor
+         */
+        Locations()
+        : m_locations(std::make_shared<Storage>())
+        , m_avoidedProbes(0)
+        , m_version(0)
+        , m_quality(0)
+        {
+            // That's it
+        }
+
         /*!
          @brief Add a path to the locations
 
@@ -81,7 +150,13 @@ namespace sftools
          */
         void add(std::string const& path)
         {
-            m_locations.push_back(path);
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            // resolve() may still be iterating the current ones
+            std::shared_ptr<Storage> locations = std::make_shared<Storage>(*m_locations);
+            locations->push_back(path);
+            m_locations = locations;
+            invalidate();
         }
 
         /*!
@@ -95,10 +170,15 @@ namespace sftools
          */
         void remove(std::string const& path)
         {
-            Iterator it = std::find(m_locations.begin(), m_locations.end(), path);
-            if (it != m_locations.end())
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            std::shared_ptr<Storage> locations = std::make_shared<Storage>(*m_locations);
+            Iterator it = std::find(locations->begin(), locations->end(), path);
+            if (it != locations->end())
             {
-                m_locations.erase(it);
+                locations->erase(it);
+                m_locations = locations;
+                invalidate();
             }
         }
 
@@ -109,7 +189,214 @@ namespace sftools
          */
         void clear()
         {
-            m_locations.clear();
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_locations = std::make_shared<Storage>();
+            invalidate();
+        }
+
+        /*!
+         @brief Forget the content of the directories
+
+         Use this method when files were added to or removed from the
+         locations.
+         */
+        void refresh()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            invalidate();
+        }
+
+        /*!
+         @brief Forget the content of one directory
+
+         Use this method when files were added to or removed from
+         `directory` only.
+
+         @param directory directory that changed, as given by splitPath()
+         */
+        void refresh(std::string const& directory)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_listings.erase(directory);
+            m_index.clear();
+            ++m_version;
+        }
+
+        /*!
+         @brief Find the file corresponding to a resource id
+
+         Locations are checked in the order they were added and the first
+         one holding a file called "id" wins.
+
+         Both found and missing files are remembered until the locations
+         change or refresh() is called.
+
+         @param id resource id
+         @return path to the file, or an empty string if no location holds it
+         */
+        std::string resolve(std::string const& id)
+        {
+            SFTOOLS_TELEMETRY(priv::ProbeScope probe;)
+
+            Snapshot locations;
+            unsigned long version;
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+
+                Index::const_iterator it = m_index.find(id);
+                if (it != m_index.end())
+                {
+                    // Every location checked last time is now a probe avoided
+                    m_avoidedProbes += it->second.probes;
+                    return it->second.path;
+                }
+
+                locations = m_locations;
+                version = m_version;
+            }
+
+            Resolution resolution;
+            resolution.probes = 0;
+
+            // Reuse the buffers of the thread instead of allocating them for
+            // every probe
+            static thread_local std::string path, directory, name;
+
+            for (ConstIterator loc = locations->begin(); loc != locations->end(); ++loc)
+            {
+                path.assign(*loc).append(id);
+                priv::splitPath(path, directory, name);
+
+                ++resolution.probes;
+
+                // Only probe the disk when the directory has no listing
+                bool readable = true;
+                if (isListed(directory, name, version, readable) || (!readable && priv::isFile(path)))
+                {
+                    resolution.path = path;
+                    break;
+                }
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+
+                // Don't remember results computed with outdated locations
+                if (m_version == version)
+                {
+                    m_index[id] = resolution;
+                }
+            }
+
+            return resolution.path;
+        }
+
+        /*!
+         @brief Find the file of a resource in a quality tier
+
+         Tiers are checked from `tier` down to 0; tiers without a prefix
+         are skipped, except tier 0 which has none.
+
+         @param id resource id
+         @param tier tier wanted
+         @param found receives the tier of the file found, at most `tier`
+         @return path to the file, or an empty string if no tier has it
+         */
+        std::string resolve(std::string const& id, unsigned tier, unsigned& found)
+        {
+            for (unsigned t = tier; t > 0; --t)
+            {
+                std::string prefix;
+
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+
+                    Tiers::const_iterator it = m_tiers.find(t);
+                    if (it == m_tiers.end())
+                    {
+                        continue;
+                    }
+                    prefix = it->second;
+                }
+
+                std::string const path = resolve(prefix + id);
+                if (!path.empty())
+                {
+                    found = t;
+                    return path;
+                }
+            }
+
+            found = 0;
+            return resolve(id);
+        }
+
+        /*!
+         @brief Set the prefix of the files of a quality tier
+
+         The prefix is prepended to the resource ids; like locations, it can
+         be a directory (ending with `/`) or the beginning of a file name.
+
+         @param tier tier, starting at 1 for the first lower quality
+         @param prefix prefix of the files of the tier
+         */
+        void setTierPrefix(unsigned tier, std::string const& prefix)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tiers[tier] = prefix;
+            ++m_version;
+        }
+
+        /*!
+         @brief Select the quality tier loaded by default
+
+         Each tier halves the resolution of images; see setTierPrefix().
+         Resources already loaded are not affected.
+
+         @param tier 0 for the full quality, which is the default
+         */
+        void setQuality(unsigned tier)
+        {
+            m_quality = tier;
+            ++m_version;
+        }
+
+        /*!
+         @brief Get the quality tier loaded by default
+
+         @return tier selected with setQuality()
+         */
+        unsigned getQuality() const
+        {
+            return m_quality;
+        }
+
+        /*!
+         @brief Get the number of file system probes avoided by the index
+
+         A probe is the check of one location for one resource. Probes are
+         avoided when resolve() is answered from memory.
+
+         @return number of probes avoided since the creation of the object
+         */
+        unsigned long getAvoidedProbes() const
+        {
+            return m_avoidedProbes;
+        }
+
+        /*!
+         @brief Get the version of the locations
+
+         The version is incremented every time the locations or the index
+         change, so results derived from resolve() can cheaply detect that
+         they are stale.
+
+         @return current version
+         */
+        unsigned long getVersion() const
+        {
+            return m_version;
         }
 
         /*!
@@ -117,11 +404,13 @@ namespace sftools
 
          If no location was added yet this method return the same iterator as `end`.
 
+         @note Iterating is not thread-safe.
+
          @return constant iterator on the first location
          */
         ConstIterator begin() const
         {
-            return m_locations.begin();
+            return m_locations->begin();
         }
 
         /*!
@@ -131,7 +420,64 @@ namespace sftools
          */
         ConstIterator end() const
         {
-            return m_locations.end();
+            return m_locations->end();
+        }
+
+    private:
+        /*!
+         @brief Look a file up in the listing of its directory
+
+         The directory is listed first if needed, without holding m_mutex
+         so that other threads can resolve ids in the meantime.
+
+         @param directory directory of the file
+         @param name name of the file
+         @param version version of the locations the caller started with
+         @param readable set to false if the directory could not be listed
+         @return true if the listing holds the file
+         */
+        bool isListed(std::string const& directory, std::string const& name, unsigned long version, bool& readable)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+
+                Listings::const_iterator listing = m_listings.find(directory);
+                if (listing != m_listings.end())
+                {
+                    ++m_avoidedProbes;
+                    readable = listing->second.readable;
+                    return listing->second.files.count(name) != 0;
+                }
+            }
+
+            // Unreadable directories are remembered too
+            Listing listing;
+            listing.readable = priv::listFiles(directory, listing.files);
+            bool const listed = listing.files.count(name) != 0;
+            readable = listing.readable;
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            // Another thread may have listed it too, or the index may have
+            // been dropped in the meantime
+            if (m_version == version && m_listings.find(directory) == m_listings.end())
+            {
+                Listing& stored = m_listings[directory];
+                stored.files.swap(listing.files);
+                stored.readable = listing.readable;
+            }
+
+            return listed;
+        }
+
+        /*!
+         @brief Drop the index; m_mutex must be locked
+         */
+        void invalidate()
+        {
+            m_index.clear();
+            m_listings.clear();
+            ++m_version;
         }
     };
 
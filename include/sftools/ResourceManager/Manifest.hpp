@@ -0,0 +1,299 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file sftools/ResourceManager/Manifest.hpp
+ @brief Defines ManifestKey and the manifest files of GenericManager
+ */
+
+#ifndef __SFTOOLS_MANIFEST_HPP__
+#define __SFTOOLS_MANIFEST_HPP__
+
+#include <sftools/ResourceManager/ResourceId.hpp>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <cstdint>
+#include <type_traits>
+
+/*!
+ @namespace sftools
+ @brief Simple and Fast Tools
+ */
+namespace sftools
+{
+    namespace priv
+    {
+        /*!
+         @brief Integer type used to write an integral or enum id
+
+         @tparam T Id type
+         */
+        template <typename T, bool = std::is_enum<T>::value>
+        struct IntegerOf
+        {
+            typedef T type; //!< T itself
+        };
+
+        /*!
+         @brief Integer type used to write an enum id
+         */
+        template <typename T>
+        struct IntegerOf<T, true>
+        {
+            typedef typename std::underlying_type<T>::type type; //!< Underlying type of the enum
+        };
+    }
+
+    /*!
+     @brief Convert ids to and from the text of manifest files
+
+     The default implementation handles integral and enum ids; std::string
+     and ResourceId are supported too. Specialise this template for other
+     id types. Converted ids must not contain line breaks.
+
+     @tparam Id Type of resources' identifiers
+
+     @see GenericManager::saveManifest
+     */
+    template <typename Id>
+    struct ManifestKey
+    {
+        static_assert(std::is_integral<Id>::value || std::is_enum<Id>::value,
+                      "specialise ManifestKey to record this type of ids");
+
+        typedef typename priv::IntegerOf<Id>::type Integer; //!< A simple alias
+        typedef typename std::conditional<std::is_signed<Integer>::value,
+                                          long long,
+                                          unsigned long long>::type Widest; //!< A simple alias
+
+        /*!
+         @brief Convert an id to text
+
+         @param id id to be converted
+         @return its text
+         */
+        static std::string toString(Id const& id)
+        {
+            return std::to_string(static_cast<Widest>(id));
+        }
+
+        /*!
+         @brief Convert text back to an id
+
+         @param text text produced by toString()
+         @param id receives the id
+         @return false if `text` is not a valid id
+         */
+        static bool fromString(std::string const& text, Id& id)
+        {
+            std::istringstream in(text);
+            Widest value;
+
+            if (!(in >> value) || !in.eof())
+            {
+                return false;
+            }
+
+            id = static_cast<Id>(static_cast<Integer>(value));
+            return true;
+        }
+    };
+
+    /*!
+     @brief Specialisation of ManifestKey for std::string
+     */
+    template <>
+    struct ManifestKey<std::string>
+    {
+        static std::string toString(std::string const& id)
+        {
+            return id;
+        }
+
+        static bool fromString(std::string const& text, std::string& id)
+        {
+            id = text;
+            return true;
+        }
+    };
+
+    /*!
+     @brief Specialisation of ManifestKey for ResourceId
+     */
+    template <>
+    struct ManifestKey<ResourceId>
+    {
+        static std::string toString(ResourceId const& id)
+        {
+            return id;
+        }
+
+        static bool fromString(std::string const& text, ResourceId& id)
+        {
+            // The name is needed to load the resource, even in release builds
+            id = ResourceId(priv::internName(text), text.size());
+            return true;
+        }
+    };
+
+    namespace priv
+    {
+        /*!
+         @class Manifest
+         @brief First accesses to the resources of a manager
+
+         A manifest file is a text file starting with a header line,
+         followed by one line per resource, in the order of their first
+         access :
+
+         @code
+         sftools-manifest 1
+         <milliseconds since the start of the recording> <id>
+         @endcode
+
+         @tparam Id Type of resources' identifiers
+
+         @see ManifestKey
+         */
+        template <typename Id>
+        class Manifest
+        {
+        public:
+            /*!
+             @brief Append an access
+
+             @param id id of the resource
+             @param milliseconds time of the access
+             */
+            void add(Id const& id, std::int64_t milliseconds)
+            {
+                Access const access = { id, milliseconds };
+                m_accesses.push_back(access);
+            }
+
+            /*!
+             @brief Remove all accesses
+             */
+            void clear()
+            {
+                m_accesses.clear();
+            }
+
+            /*!
+             @brief Get the number of accesses
+             */
+            std::size_t size() const
+            {
+                return m_accesses.size();
+            }
+
+            /*!
+             @brief Get the id of an access
+
+             @param i index of the access, in order
+             @return its id
+             */
+            Id const& getId(std::size_t i) const
+            {
+                return m_accesses[i].id;
+            }
+
+            /*!
+             @brief Write the manifest to a file
+
+             @param path file to write
+             @return false if the file couldn't be written
+             */
+            bool save(std::string const& path) const
+            {
+                std::ofstream out(path.c_str(), std::ios::trunc);
+                out << Header << '\n';
+
+                for (std::size_t i = 0; i < m_accesses.size(); ++i)
+                {
+                    out << m_accesses[i].milliseconds << ' ' << ManifestKey<Id>::toString(m_accesses[i].id) << '\n';
+                }
+
+                return static_cast<bool>(out);
+            }
+
+            /*!
+             @brief Read a manifest file, replacing the current accesses
+
+             Invalid lines are skipped.
+
+             @param path file to read
+             @return false if the file doesn't exist or isn't a manifest
+             */
+            bool open(std::string const& path)
+            {
+                std::ifstream in(path.c_str());
+                std::string line;
+
+                if (!std::getline(in, line) || line != Header)
+                {
+                    return false;
+                }
+
+                m_accesses.clear();
+
+                while (std::getline(in, line))
+                {
+                    std::string::size_type const space = line.find(' ');
+                    Access access;
+
+                    if (space != std::string::npos
+                        && ManifestKey<std::int64_t>::fromString(line.substr(0, space), access.milliseconds)
+                        && ManifestKey<Id>::fromString(line.substr(space + 1), access.id))
+                    {
+                        m_accesses.push_back(access);
+                    }
+                }
+
+                return true;
+            }
+
+        private:
+            static char const* const Header; //!< First line of the files
+
+            /*!
+             @brief An access to a resource
+             */
+            struct Access
+            {
+                Id id; //!< The resource
+                std::int64_t milliseconds; //!< Since the start of the recording
+            };
+
+            std::vector<Access> m_accesses; //!< In order
+        };
+
+        template <typename Id>
+        char const* const Manifest<Id>::Header = "sftools-manifest 1";
+    }
+}
+
+#endif // __SFTOOLS_MANIFEST_HPP__
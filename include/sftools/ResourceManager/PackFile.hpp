@@ -0,0 +1,539 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file sftools/ResourceManager/PackFile.hpp
+ @brief Defines PackFile and PackWriter classes, and ResourcePack singleton
+        object
+ @note Requires C++11
+ */
+
+#ifndef __SFTOOLS_PACKFILE_HPP__
+#define __SFTOOLS_PACKFILE_HPP__
+
+#include <sftools/Common/NonCopyable.hpp>
+#include <sftools/Singleton.hpp>
+#include <sftools/ResourceManager/FileSystem.hpp>
+#include <sftools/ResourceManager/ResourceId.hpp> // priv::fnv1a
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+/*!
+ @namespace sftools
+ @brief Simple and Fast Tools
+ */
+namespace sftools
+{
+    namespace priv
+    {
+        /*!
+         @brief Read a little-endian unsigned integer
+
+         @param data first byte of the integer
+         @param bytes size of the integer, at most 8
+         @return the integer
+         */
+        inline std::uint64_t readLittleEndian(char const* data, std::size_t bytes)
+        {
+            std::uint64_t value = 0;
+            for (std::size_t i = bytes; i-- > 0; )
+            {
+                value = (value << 8) | static_cast<unsigned char>(data[i]);
+            }
+            return value;
+        }
+
+        /*!
+         @brief Write a little-endian unsigned integer
+
+         @param data first byte of the integer
+         @param value the integer
+         @param bytes size of the integer, at most 8
+         */
+        inline void writeLittleEndian(char* data, std::uint64_t value, std::size_t bytes)
+        {
+            for (std::size_t i = 0; i < bytes; ++i, value >>= 8)
+            {
+                data[i] = static_cast<char>(value & 0xFF);
+            }
+        }
+
+        /*!
+         @brief Header of a pack file, stored at offset 0
+
+         A pack file is made of :
+
+         \li this header;
+         \li the content of each file, aligned on PackAlignment bytes;
+         \li the index : an array of PackEntry sorted by hash then name,
+             aligned on 8 bytes;
+         \li the names referenced by the index, without terminating null
+             character.
+
+         All integers are little-endian, whatever the host, and stored in
+         the order and with the sizes of the fields below, without padding.
+         */
+        struct PackHeader
+        {
+            static std::size_t const Size = 24; //!< Bytes in the file
+
+            /*!
+             @brief Decode the header
+
+             @param data Size bytes
+             */
+            void read(char const* data)
+            {
+                std::memcpy(magic, data, 4);
+                version = static_cast<std::uint32_t>(readLittleEndian(data + 4, 4));
+                count = static_cast<std::uint32_t>(readLittleEndian(data + 8, 4));
+                reserved = static_cast<std::uint32_t>(readLittleEndian(data + 12, 4));
+                indexOffset = readLittleEndian(data + 16, 8);
+            }
+
+            /*!
+             @brief Encode the header
+
+             @param data receives Size bytes
+             */
+            void write(char* data) const
+            {
+                std::memcpy(data, magic, 4);
+                writeLittleEndian(data + 4, version, 4);
+                writeLittleEndian(data + 8, count, 4);
+                writeLittleEndian(data + 12, reserved, 4);
+                writeLittleEndian(data + 16, indexOffset, 8);
+            }
+
+            char magic[4]; //!< "SFPK"
+            std::uint32_t version; //!< format version, currently 1
+            std::uint32_t count; //!< number of entries
+            std::uint32_t reserved; //!< 0
+            std::uint64_t indexOffset; //!< position of the index
+        };
+
+        /*!
+         @brief Index entry of a pack file
+         */
+        struct PackEntry
+        {
+            static std::size_t const Size = 32; //!< Bytes in the file
+
+            /*!
+             @brief Decode the entry
+
+             @param data Size bytes
+             */
+            void read(char const* data)
+            {
+                hash = readLittleEndian(data, 8);
+                offset = readLittleEndian(data + 8, 8);
+                size = readLittleEndian(data + 16, 8);
+                nameOffset = static_cast<std::uint32_t>(readLittleEndian(data + 24, 4));
+                nameLength = static_cast<std::uint32_t>(readLittleEndian(data + 28, 4));
+            }
+
+            /*!
+             @brief Encode the entry
+
+             @param data receives Size bytes
+             */
+            void write(char* data) const
+            {
+                writeLittleEndian(data, hash, 8);
+                writeLittleEndian(data + 8, offset, 8);
+                writeLittleEndian(data + 16, size, 8);
+                writeLittleEndian(data + 24, nameOffset, 4);
+                writeLittleEndian(data + 28, nameLength, 4);
+            }
+
+            std::uint64_t hash; //!< FNV-1a hash of the name
+            std::uint64_t offset; //!< position of the content
+            std::uint64_t size; //!< size of the content
+            std::uint32_t nameOffset; //!< position of the name, relative to the end of the index
+            std::uint32_t nameLength; //!< length of the name
+        };
+
+        std::size_t const PackAlignment = 16; //!< Alignment of the files' content
+        std::uint32_t const PackVersion = 1; //!< Current format version
+    }
+
+    /*!
+     @class PackFile
+     @brief Read-only access to a pack file
+
+     The whole archive is mapped in memory once; find() then returns pointers
+     into the mapping, so resources can be decoded with `loadFromMemory`
+     without any intermediate copy.
+
+     Pack files are created with PackWriter or with the `sfpack` tool.
+
+     After open(), find() can be used concurrently from several threads.
+
+     @see PackWriter
+     @see loader::LoadFromPack
+     */
+    class PackFile : sftools::NonCopyable
+    {
+    public:
+        /*!
+         @brief Default constructor
+
+         No archive is opened.
+         */
+        PackFile()
+        : m_index(0)
+        , m_names(0)
+        , m_count(0)
+        {
+            // That's it
+        }
+
+        /*!
+         @brief Open an archive, closing the previous one if any
+
+         @note Don't call it while the content of the previous archive is
+               still in use (e.g. an sf::Music streaming from it).
+
+         @param path path to the archive
+         @return false if the file could not be mapped or is not a valid
+                 archive
+         */
+        bool open(std::string const& path)
+        {
+            close();
+
+            if (!m_file.open(path))
+            {
+                return false;
+            }
+
+            char const* const data = m_file.getData();
+            std::size_t const size = m_file.getSize();
+
+            priv::PackHeader header;
+            if (size < priv::PackHeader::Size)
+            {
+                close();
+                return false;
+            }
+            header.read(data);
+
+            // Sizes are compared to what is left of the file so that corrupted
+            // offsets can't overflow
+            if (std::memcmp(header.magic, "SFPK", 4) != 0
+                || header.version != priv::PackVersion
+                || header.indexOffset % 8 != 0
+                || header.indexOffset > size
+                || header.count > (size - header.indexOffset) / priv::PackEntry::Size)
+            {
+                close();
+                return false;
+            }
+
+            std::uint64_t const indexEnd = header.indexOffset + std::uint64_t(header.count) * priv::PackEntry::Size;
+
+            m_index = data + header.indexOffset;
+            m_names = data + indexEnd;
+            m_count = header.count;
+
+            // Reject archives pointing outside of the mapping
+            for (std::size_t i = 0; i < m_count; ++i)
+            {
+                priv::PackEntry entry;
+                entry.read(m_index + i * priv::PackEntry::Size);
+
+                if (entry.offset > size
+                    || entry.size > size - entry.offset
+                    || entry.nameOffset > size - indexEnd
+                    || entry.nameLength > size - indexEnd - entry.nameOffset)
+                {
+                    close();
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        /*!
+         @brief Close the archive, if any
+         */
+        void close()
+        {
+            m_file.close();
+            m_index = 0;
+            m_names = 0;
+            m_count = 0;
+        }
+
+        /*!
+         @brief Tell if an archive is opened
+
+         @return true if an archive is opened
+         */
+        bool isOpen() const
+        {
+            return m_file.getData() != 0;
+        }
+
+        /*!
+         @brief Find the content of a file
+
+         This is a binary search on the names' hashes.
+
+         @param id name of the file in the archive
+         @param data set to the content of the file
+         @param size set to the size of the file
+         @return false if the archive doesn't contain `id`
+         */
+        bool find(std::string const& id, char const*& data, std::size_t& size) const
+        {
+            std::uint64_t const hash = priv::fnv1a(id.c_str(), id.size());
+
+            // Only the hashes are decoded while searching
+            std::size_t first = 0;
+            std::size_t count = m_count;
+            while (count > 0)
+            {
+                std::size_t const half = count / 2;
+                if (priv::readLittleEndian(m_index + (first + half) * priv::PackEntry::Size, 8) < hash)
+                {
+                    first += half + 1;
+                    count -= half + 1;
+                }
+                else
+                {
+                    count = half;
+                }
+            }
+
+            for (; first < m_count; ++first)
+            {
+                priv::PackEntry entry;
+                entry.read(m_index + first * priv::PackEntry::Size);
+
+                if (entry.hash != hash)
+                {
+                    break;
+                }
+                else if (entry.nameLength == id.size()
+                         && std::memcmp(m_names + entry.nameOffset, id.data(), id.size()) == 0)
+                {
+                    data = m_file.getData() + entry.offset;
+                    size = static_cast<std::size_t>(entry.size);
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+    private:
+        priv::MappedFile m_file; //!< the mapped archive
+        char const* m_index; //!< encoded index, inside the mapping
+        char const* m_names; //!< names, inside the mapping
+        std::size_t m_count; //!< number of entries
+    };
+
+    /*!
+     @class PackWriter
+     @brief Create pack files
+
+     @code
+
+     sftools::PackWriter writer;
+     writer.add("hero.png", "assets/hero.png");
+     writer.add("theme.ogg", "assets/music/theme.ogg");
+     writer.write("assets.pack");
+
+     @endcode
+
+     @see PackFile
+     */
+    class PackWriter
+    {
+    public:
+        /*!
+         @brief Add a file to the archive
+
+         @param id name of the file in the archive
+         @param path path of the file to be read when write() is called
+         */
+        void add(std::string const& id, std::string const& path)
+        {
+            m_files.push_back(File(id, path));
+        }
+
+        /*!
+         @brief Write the archive
+
+         Files are stored in the order they were added.
+
+         @param path path of the archive
+         @return false if a file could not be read or the archive written
+         */
+        bool write(std::string const& path) const
+        {
+            std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+            if (!out)
+            {
+                return false;
+            }
+
+            priv::PackHeader header;
+            std::memcpy(header.magic, "SFPK", 4);
+            header.version = priv::PackVersion;
+            header.count = static_cast<std::uint32_t>(m_files.size());
+            header.reserved = 0;
+            header.indexOffset = 0;
+
+            // Large enough for the header too
+            char bytes[priv::PackEntry::Size];
+            header.write(bytes);
+            out.write(bytes, priv::PackHeader::Size);
+
+            // Content
+            std::vector<priv::PackEntry> entries;
+            std::string names;
+            std::vector<char> buffer;
+
+            for (std::size_t i = 0; i < m_files.size(); ++i)
+            {
+                pad(out, priv::PackAlignment);
+
+                std::ifstream in(m_files[i].path.c_str(), std::ios::binary);
+                if (!in)
+                {
+                    return false;
+                }
+                buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+
+                priv::PackEntry entry;
+                entry.hash = priv::fnv1a(m_files[i].id.c_str(), m_files[i].id.size());
+                entry.offset = static_cast<std::uint64_t>(out.tellp());
+                entry.size = buffer.size();
+                entry.nameOffset = static_cast<std::uint32_t>(names.size());
+                entry.nameLength = static_cast<std::uint32_t>(m_files[i].id.size());
+                entries.push_back(entry);
+
+                names += m_files[i].id;
+                out.write(buffer.empty() ? "" : &buffer[0], buffer.size());
+            }
+
+            // Index
+            pad(out, 8);
+            header.indexOffset = static_cast<std::uint64_t>(out.tellp());
+
+            std::sort(entries.begin(), entries.end(), EntryLess(names));
+            for (std::size_t i = 0; i < entries.size(); ++i)
+            {
+                entries[i].write(bytes);
+                out.write(bytes, priv::PackEntry::Size);
+            }
+            out.write(names.data(), names.size());
+
+            // Header, now that the index position is known
+            out.seekp(0);
+            header.write(bytes);
+            out.write(bytes, priv::PackHeader::Size);
+
+            return static_cast<bool>(out);
+        }
+
+    private:
+        /*!
+         @brief File to be packed
+         */
+        struct File
+        {
+            File(std::string const& id, std::string const& path) : id(id), path(path) { }
+
+            std::string id; //!< name in the archive
+            std::string path; //!< source file
+        };
+
+        /*!
+         @brief Index order : by hash, then by name
+         */
+        struct EntryLess
+        {
+            explicit EntryLess(std::string const& names) : names(names) { }
+
+            bool operator()(priv::PackEntry const& a, priv::PackEntry const& b) const
+            {
+                if (a.hash != b.hash)
+                {
+                    return a.hash < b.hash;
+                }
+
+                return names.compare(a.nameOffset, a.nameLength, names, b.nameOffset, b.nameLength) < 0;
+            }
+
+            std::string const& names; //!< name table
+        };
+
+        /*!
+         @brief Write zeros until the position is a multiple of `alignment`
+         */
+        static void pad(std::ofstream& out, std::size_t alignment)
+        {
+            std::size_t const position = static_cast<std::size_t>(out.tellp());
+            std::size_t const padding = (alignment - position % alignment) % alignment;
+            char const zeros[priv::PackAlignment] = { 0 };
+            out.write(zeros, padding);
+        }
+
+        std::vector<File> m_files; //!< files to be packed
+    };
+
+    /*!
+     @namespace sftools::singleton
+     @brief Contains singleton object typedefs
+     */
+    namespace singleton
+    {
+        /*!
+         @typedef sftools::singleton::ResourcePack
+         @brief Singleton PackFile object used by loader::LoadFromPack
+
+         @code
+
+         singleton::ResourcePack::getInstance().open(resourcePath() + "assets.pack");
+
+         @endcode
+
+         @see PackFile
+         */
+        typedef sftools::Singleton<PackFile> ResourcePack;
+    }
+}
+
+#endif // __SFTOOLS_PACKFILE_HPP__
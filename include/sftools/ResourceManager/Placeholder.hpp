@@ -0,0 +1,66 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file sftools/ResourceManager/Placeholder.hpp
+ @brief Defines Placeholder factory
+ */
+
+#ifndef __SFTOOLS_PLACEHOLDER_HPP__
+#define __SFTOOLS_PLACEHOLDER_HPP__
+
+/*!
+ @namespace sftools
+ @brief Simple and Fast Tools
+ */
+namespace sftools
+{
+    /*!
+     @brief Create the stand-in of resources that are not loaded yet
+
+     Used by GenericManager when placeholders are enabled. The default
+     placeholder is a default-constructed resource. Specialise this
+     template for your own resource types; SFMLManagers.hpp does it for
+     SFML's types.
+
+     @tparam R Resource type
+
+     @see GenericManager::enablePlaceholders
+     */
+    template <typename R>
+    struct Placeholder
+    {
+        /*!
+         @brief Create a placeholder
+
+         @return a new resource, owned by the caller
+         */
+        R* operator()() const
+        {
+            return new R;
+        }
+    };
+}
+
+#endif // __SFTOOLS_PLACEHOLDER_HPP__
@@ -0,0 +1,279 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file sftools/ResourceManager/Ref.hpp
+ @brief Defines Ref class
+ @note Requires C++11
+ */
+
+#ifndef __SFTOOLS_REF_HPP__
+#define __SFTOOLS_REF_HPP__
+
+#include <atomic>
+#include <utility> // std::swap
+#include <cstddef>
+
+/*!
+ @namespace sftools
+ @brief Simple and Fast Tools
+ */
+namespace sftools
+{
+    template <typename Resource, typename Id, typename OnLoad, template <typename, typename> class Storage>
+    class GenericManager;
+
+    namespace priv
+    {
+        template <typename Resource>
+        class ReleaseQueue;
+
+        /*!
+         @brief State shared by the Refs of a resource
+
+         Once its count dropped to zero, a block is never used again for
+         new Refs: it is pushed once to its ReleaseQueue and deleted by the
+         manager.
+         */
+        template <typename Resource>
+        struct RefBlock
+        {
+            /*!
+             @brief Constructor; the block starts with one reference
+
+             @param r referenced resource
+             @param q where to push the block when unused
+             */
+            RefBlock(Resource* r, ReleaseQueue<Resource>* q)
+            : count(1), resource(r), queue(q), next(0)
+            {
+            }
+
+            std::atomic<std::size_t> count; //!< Number of Refs
+            std::atomic<Resource*> resource; //!< Updated when the resource is replaced
+            ReleaseQueue<Resource>* queue; //!< Queue of the owning manager
+            RefBlock* next; //!< Next block in the queue
+        };
+
+        /*!
+         @class ReleaseQueue
+         @brief Lock-free stack of unused RefBlock
+
+         Any thread can push; only the thread owning the manager takes the
+         blocks, all at once, so there is no ABA problem.
+         */
+        template <typename Resource>
+        class ReleaseQueue
+        {
+        public:
+            /*!
+             @brief Constructor
+             */
+            ReleaseQueue()
+            : m_head(0)
+            {
+            }
+
+            /*!
+             @brief Add a block
+
+             @param block block whose count dropped to zero
+             */
+            void push(RefBlock<Resource>* block)
+            {
+                RefBlock<Resource>* head = m_head.load(std::memory_order_relaxed);
+
+                do
+                {
+                    block->next = head;
+                }
+                while (!m_head.compare_exchange_weak(head, block, std::memory_order_release, std::memory_order_relaxed));
+            }
+
+            /*!
+             @brief Take all blocks
+
+             @return the blocks, linked through RefBlock::next, or 0
+             */
+            RefBlock<Resource>* takeAll()
+            {
+                // Cheap when nothing was released
+                if (!m_head.load(std::memory_order_relaxed))
+                {
+                    return 0;
+                }
+
+                return m_head.exchange(0, std::memory_order_acquire);
+            }
+
+        private:
+            std::atomic<RefBlock<Resource>*> m_head; //!< Last pushed block
+        };
+    }
+
+    /*!
+     @class Ref
+     @brief Reference-counted access to a resource of a GenericManager
+
+     Refs can be copied and destroyed from any thread without locking;
+     only an atomic counter is updated. When the last Ref of a resource is
+     destroyed, the resource is queued for release, and the manager
+     unloads it the next time GenericManager::applyReleases() is called.
+
+     @note Refs must not outlive their manager. Unloading their resource
+           explicitly is deferred until the last of them is dropped.
+
+     @tparam Resource Type of the resource
+
+     @see GenericManager::acquire
+     */
+    template <typename Resource>
+    class Ref
+    {
+    public:
+        /*!
+         @brief Default constructor; a Ref to nothing
+         */
+        Ref()
+        : m_block(0)
+        {
+            // That's it
+        }
+
+        /*!
+         @brief Copy constructor
+         */
+        Ref(Ref const& other)
+        : m_block(other.m_block)
+        {
+            if (m_block)
+            {
+                m_block->count.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        /*!
+         @brief Move constructor; `other` becomes null
+         */
+        Ref(Ref&& other)
+        : m_block(other.m_block)
+        {
+            other.m_block = 0;
+        }
+
+        /*!
+         @brief Destructor
+         */
+        ~Ref()
+        {
+            reset();
+        }
+
+        /*!
+         @brief Assignment operator
+         */
+        Ref& operator=(Ref other)
+        {
+            std::swap(m_block, other.m_block);
+            return *this;
+        }
+
+        /*!
+         @brief Drop the reference; the Ref becomes null
+         */
+        void reset()
+        {
+            // The last Ref to be dropped queues the block
+            if (m_block && m_block->count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                m_block->queue->push(m_block);
+            }
+
+            m_block = 0;
+        }
+
+        /*!
+         @brief Get the resource
+
+         @return the resource, or 0 if the Ref is null
+         */
+        Resource* get() const
+        {
+            return m_block ? m_block->resource.load(std::memory_order_acquire) : 0;
+        }
+
+        /*!
+         @brief Get the resource; the Ref must not be null
+         */
+        Resource& operator*() const
+        {
+            return *get();
+        }
+
+        /*!
+         @brief Access the resource; the Ref must not be null
+         */
+        Resource* operator->() const
+        {
+            return get();
+        }
+
+        /*!
+         @brief Tell whether the Ref refers to a resource
+         */
+        explicit operator bool() const
+        {
+            return m_block != 0;
+        }
+
+        /*!
+         @brief Get the number of Refs sharing this resource
+
+         @return the count, 0 for a null Ref
+         */
+        std::size_t useCount() const
+        {
+            return m_block ? m_block->count.load(std::memory_order_relaxed) : 0;
+        }
+
+    private:
+        template <typename, typename, typename, template <typename, typename> class>
+        friend class GenericManager;
+
+        /*!
+         @brief Constructor used by GenericManager
+
+         @param block shared state; its count must already include this Ref
+         */
+        explicit Ref(priv::RefBlock<Resource>* block)
+        : m_block(block)
+        {
+            // That's it
+        }
+
+        priv::RefBlock<Resource>* m_block; //!< Shared state, or 0
+    };
+}
+
+#endif // __SFTOOLS_REF_HPP__
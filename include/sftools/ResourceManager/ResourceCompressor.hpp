@@ -0,0 +1,83 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+/*!
+ @file sftools/ResourceManager/ResourceCompressor.hpp
+ @brief Defines ResourceCompressor codec
+ */
+
+#ifndef __SFTOOLS_RESOURCECOMPRESSOR_HPP__
+#define __SFTOOLS_RESOURCECOMPRESSOR_HPP__
+
+#include <vector>
+
+/*!
+ @namespace sftools
+ @brief Simple and Fast Tools
+ */
+namespace sftools
+{
+    /*!
+     @brief Compress idle resources in memory
+
+     Used by GenericManager when cold compression is enabled. By default
+     resources can't be compressed and stay as they are. Specialise this
+     template for your own resource types; SFMLManagers.hpp does it for
+     sf::Image and sf::SoundBuffer.
+
+     @tparam R Resource type
+
+     @see GenericManager::setColdCompression
+     */
+    template <typename R>
+    struct ResourceCompressor
+    {
+        /*!
+         @brief Compress a resource
+
+         @param res resource to be compressed
+         @param out receives the compressed resource
+         @return false if the resource can't be compressed
+         */
+        bool compress(R const& res, std::vector<char>& out) const
+        {
+            (void)res;
+            (void)out;
+            return false;
+        }
+
+        /*!
+         @brief Restore a compressed resource
+
+         @param data output of compress()
+         @return a new resource, owned by the caller, or 0 on error
+         */
+        R* decompress(std::vector<char> const& data) const
+        {
+            (void)data;
+            return 0;
+        }
+    };
+}
+
+#endif // __SFTOOLS_RESOURCECOMPRESSOR_HPP__
@@ -0,0 +1,312 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file sftools/ResourceManager/ResourceId.hpp
+ @brief Defines ResourceId class
+ @note Requires C++11
+ */
+
+#ifndef __SFTOOLS_RESOURCEID_HPP__
+#define __SFTOOLS_RESOURCEID_HPP__
+
+#include <string>
+#include <set>
+#include <mutex>
+#include <ostream>
+#include <functional> // std::hash
+#include <cstddef>
+#ifndef NDEBUG
+    #include <cstring>
+    #include <stdexcept>
+#endif
+
+/*!
+ @namespace sftools
+ @brief Simple and Fast Tools
+ */
+namespace sftools
+{
+    namespace priv
+    {
+        /*!
+         @brief 64-bit FNV-1a hash, usable at compile time
+
+         @param str string to hash
+         @param length number of characters to hash
+         @param hash hash of the previous characters
+         */
+        constexpr unsigned long long fnv1a(char const* str, std::size_t length,
+                                           unsigned long long hash = 14695981039346656037ull)
+        {
+            return length == 0
+                   ? hash
+                   : fnv1a(str + 1, length - 1, (hash ^ static_cast<unsigned char>(*str)) * 1099511628211ull);
+        }
+
+        /*!
+         @brief Keep a copy of a name alive for the whole program
+
+         The copies are never freed : only the debug builds of ResourceId
+         and the ids read from manifests use it.
+
+         @param name name to copy
+         @return a pointer to a copy of `name` that is never freed
+         */
+        inline char const* internName(std::string const& name)
+        {
+            static std::set<std::string> names;
+            static std::mutex mutex;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            return names.insert(name).first->c_str();
+        }
+    }
+
+    /*!
+     @class ResourceId
+     @brief Resource identifier hashed at compile time
+
+     A ResourceId is built from a string literal; its FNV-1a hash is then the
+     only thing compared by GenericManager, which turns lookups into integer
+     probes. To ensure the hash is computed at compile time, declare ids as
+     `constexpr` :
+
+     @code
+
+     typedef sftools::GenericManager<sf::Texture,
+                                     sftools::ResourceId,
+                                     sftools::loader::TextureLoaderFromFile,
+                                     sftools::storage::Hash>
+             HashedTextureManager;
+
+     constexpr sftools::ResourceId hero("hero.png");
+
+     HashedTextureManager manager;
+     manager.load(hero);
+     manager[hero]; // or manager["hero.png"]
+
+     @endcode
+
+     The name is still carried along (it's just a pointer to the literal) so
+     loaders, which need a file name, can use it thanks to the implicit
+     conversion to std::string.
+
+     In debug builds (i.e. when `NDEBUG` is not defined), comparing two ids
+     with the same hash also compares their names and throws
+     `std::logic_error` if they differ, so hash collisions are detected as
+     soon as two colliding ids meet in a manager. Release builds only
+     compare the hashes.
+
+     @note Only pass string literals to the implicit constructor : for arrays
+           it uses the array's size, not the string's length. Use the
+           explicit `std::string` constructor for names built at runtime;
+           in release builds it keeps only the hash, so such ids find
+           resources loaded under the same name but can't load them.
+     */
+    class ResourceId
+    {
+    public:
+        typedef unsigned long long HashType; //!< Type of the hash
+
+        /*!
+         @brief Default constructor
+
+         Build the id of the empty name.
+         */
+        constexpr ResourceId()
+        : m_hash(priv::fnv1a("", 0))
+        , m_name("")
+        {
+            // That's it
+        }
+
+        /*!
+         @brief Constructor from a string literal
+
+         @param name string literal naming the resource
+         */
+        template <std::size_t N>
+        constexpr ResourceId(char const (&name)[N])
+        : m_hash(priv::fnv1a(name, N - 1))
+        , m_name(name)
+        {
+            // That's it
+        }
+
+        /*!
+         @brief Constructor from a name that outlives the id
+
+         @param name name of the resource, not copied
+         @param length number of characters of `name`
+         */
+        constexpr ResourceId(char const* name, std::size_t length)
+        : m_hash(priv::fnv1a(name, length))
+        , m_name(name)
+        {
+            // That's it
+        }
+
+        /*!
+         @brief Constructor from a runtime string
+
+         In debug builds, a copy of `name` is kept for the whole program to
+         check collisions. Release builds don't keep the name : getName()
+         then returns an empty string.
+
+         @param name name of the resource
+         */
+        explicit ResourceId(std::string const& name)
+        : m_hash(priv::fnv1a(name.c_str(), name.size()))
+#ifndef NDEBUG
+        , m_name(priv::internName(name))
+#else
+        , m_name("")
+#endif
+        {
+            // That's it
+        }
+
+        /*!
+         @brief Get the hash of the id
+
+         @return hash of the name
+         */
+        constexpr HashType getHash() const
+        {
+            return m_hash;
+        }
+
+        /*!
+         @brief Get the name of the id
+
+         @return name of the resource
+         */
+        constexpr char const* getName() const
+        {
+            return m_name;
+        }
+
+        /*!
+         @brief Implicit conversion to std::string
+
+         Used by loaders to locate the resource.
+
+         @return name of the resource
+         */
+        operator std::string() const
+        {
+            return m_name;
+        }
+
+        /*!
+         @brief Equality operator
+
+         @throw std::logic_error in debug builds when a collision is detected
+         */
+        bool operator==(ResourceId const& other) const
+        {
+#ifndef NDEBUG
+            return m_hash == other.m_hash && checkCollision(other);
+#else
+            return m_hash == other.m_hash;
+#endif
+        }
+
+        /*!
+         @brief Inequality operator
+
+         @throw std::logic_error in debug builds when a collision is detected
+         */
+        bool operator!=(ResourceId const& other) const
+        {
+            return !(*this == other);
+        }
+
+        /*!
+         @brief Ordering operator, based on the hashes
+
+         @throw std::logic_error in debug builds when a collision is detected
+         */
+        bool operator<(ResourceId const& other) const
+        {
+#ifndef NDEBUG
+            return m_hash < other.m_hash || (m_hash == other.m_hash && !checkCollision(other));
+#else
+            return m_hash < other.m_hash;
+#endif
+        }
+
+    private:
+#ifndef NDEBUG
+        /*!
+         @brief Check that two ids with the same hash have the same name
+
+         @return true
+         @throw std::logic_error if the names differ
+         */
+        bool checkCollision(ResourceId const& other) const
+        {
+            if (m_name != other.m_name && std::strcmp(m_name, other.m_name) != 0)
+            {
+                throw std::logic_error(std::string("ResourceId collision between \"")
+                                       + m_name + "\" and \"" + other.m_name + "\"");
+            }
+            return true;
+        }
+#endif
+
+        HashType m_hash; //!< hash of the name
+        char const* m_name; //!< name of the resource, not owned
+    };
+
+    /*!
+     @brief Print the name of an id
+
+     @param out output stream
+     @param id id to print
+     @return out
+     */
+    inline std::ostream& operator<<(std::ostream& out, ResourceId const& id)
+    {
+        return out << id.getName();
+    }
+}
+
+namespace std
+{
+    /*!
+     @brief std::hash specialisation for ResourceId, used by storage::Hash
+     */
+    template <>
+    struct hash<sftools::ResourceId>
+    {
+        std::size_t operator()(sftools::ResourceId const& id) const
+        {
+            return static_cast<std::size_t>(id.getHash());
+        }
+    };
+}
+
+#endif // __SFTOOLS_RESOURCEID_HPP__
@@ -0,0 +1,70 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file sftools/ResourceManager/ResourceSize.hpp
+ @brief Defines ResourceSize estimator
+ */
+
+#ifndef __SFTOOLS_RESOURCESIZE_HPP__
+#define __SFTOOLS_RESOURCESIZE_HPP__
+
+#include <cstddef>
+
+/*!
+ @namespace sftools
+ @brief Simple and Fast Tools
+ */
+namespace sftools
+{
+    /*!
+     @brief Estimate the memory footprint of a resource
+
+     Used by GenericManager to enforce its memory budget. The default
+     estimation is 0 : resources of unknown size don't count against the
+     budget and are therefore never evicted. Specialise this template for
+     your own resource types; SFMLManagers.hpp does it for SFML's types.
+
+     @tparam R Resource type
+
+     @see GenericManager::setMemoryBudget
+     */
+    template <typename R>
+    struct ResourceSize
+    {
+        /*!
+         @brief Estimate the size of a resource
+
+         @param res resource to be measured
+         @return estimated size in bytes
+         */
+        std::size_t operator()(R const& res) const
+        {
+            (void)res;
+            return 0;
+        }
+    };
+}
+
+#endif // __SFTOOLS_RESOURCESIZE_HPP__
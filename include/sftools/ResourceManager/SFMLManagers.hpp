@@ -31,9 +31,18 @@
 #define __SFTOOLS_SFMLMANAGERS_HPP__
 
 #include <sftools/ResourceManager/Loaders.hpp>
+#include <sftools/ResourceManager/ImageCache.hpp>
+#include <sftools/ResourceManager/Downscale.hpp>
+#include <sftools/ResourceManager/Compression.hpp>
+#include <SFML/System/InputStream.hpp>
 #include <SFML/Graphics/Texture.hpp>
 #include <SFML/Graphics/Image.hpp>
 #include <SFML/Graphics/Font.hpp>
+#include <algorithm> // std::min
+#include <type_traits> // std::is_base_of
+#include <cstring>
+#include <cstdint>
+#include <vector>
 
 // SFML's audio module is not always used. We don't want the user to be forced
 // to link against sfml-audio if he doesn't use it.
@@ -49,12 +58,379 @@
  */
 namespace sftools
 {
+    namespace priv
+    {
+        /*!
+         @brief Upload a decoded image to a new texture
+
+         @param image decoded image; ownership is taken
+         @return a new texture, or 0 if the upload failed
+         */
+        inline sf::Texture* uploadTexture(sf::Image* image)
+        {
+            sf::Texture* texture = ResourceAllocator<sf::Texture>::create();
+
+            if (!texture->loadFromImage(*image))
+            {
+                ResourceAllocator<sf::Texture>::destroy(texture);
+                texture = 0;
+            }
+
+            ResourceAllocator<sf::Image>::destroy(image);
+            return texture;
+        }
+
+        /*!
+         @brief Halve the resolution of an image several times
+
+         @param image image to downscale
+         @param halvings number of times its resolution is halved
+         */
+        inline void downscale(sf::Image& image, unsigned halvings)
+        {
+            for (; halvings > 0; --halvings)
+            {
+                sf::Vector2u const size = image.getSize();
+                if (size.x * size.y <= 1)
+                {
+                    break;
+                }
+
+                std::vector<sf::Uint8> pixels(static_cast<std::size_t>(halvedSize(size.x)) * halvedSize(size.y) * 4);
+                halveRgba(image.getPixelsPtr(), size.x, size.y, &pixels[0]);
+                image.create(halvedSize(size.x), halvedSize(size.y), &pixels[0]);
+            }
+        }
+
+        /*!
+         @brief Specialisation of MemoryDecoder for sf::Image
+
+         Like LoadFromFile<sf::Image>, decoded images are looked up in and
+         saved to singleton::ImageCache.
+         */
+        template <>
+        struct MemoryDecoder<sf::Image>
+        {
+            static bool decode(sf::Image& image, std::string const& path, std::vector<char> const& data)
+            {
+                ImageCache& cache = singleton::ImageCache::getInstance();
+
+                if (cache.load(path, image))
+                {
+                    return true;
+                }
+
+                sf::Clock clock;
+                if (!image.loadFromMemory(&data[0], data.size()))
+                {
+                    return false;
+                }
+                cache.store(path, image, clock.getElapsedTime());
+
+                return true;
+            }
+        };
+
+        /*!
+         @class MemoryStream
+         @brief sf::InputStream reading a memory block it doesn't own
+         */
+        class MemoryStream : public sf::InputStream
+        {
+        public:
+            MemoryStream(char const* data, std::size_t size)
+            : m_data(data), m_size(size), m_position(0)
+            {
+            }
+
+            virtual sf::Int64 read(void* data, sf::Int64 size)
+            {
+                sf::Int64 const count = std::min(size, static_cast<sf::Int64>(m_size - m_position));
+                if (count > 0)
+                {
+                    std::memcpy(data, m_data + m_position, static_cast<std::size_t>(count));
+                    m_position += static_cast<std::size_t>(count);
+                }
+                return count;
+            }
+
+            virtual sf::Int64 seek(sf::Int64 position)
+            {
+                if (position < 0 || position > static_cast<sf::Int64>(m_size))
+                {
+                    return -1;
+                }
+                m_position = static_cast<std::size_t>(position);
+                return position;
+            }
+
+            virtual sf::Int64 tell()
+            {
+                return static_cast<sf::Int64>(m_position);
+            }
+
+            virtual sf::Int64 getSize()
+            {
+                return static_cast<sf::Int64>(m_size);
+            }
+
+        private:
+            char const* m_data; //!< streamed memory
+            std::size_t m_size; //!< size of the memory block
+            std::size_t m_position; //!< read position
+        };
+    }
+
     /*!
      @namespace sftools::loader
      @brief Contains loader utilities for the resource managers
      */
     namespace loader
     {
+        /*!
+         @brief Specialisation of LoadFromFile for sf::Image
+
+         Decoded images are looked up in and saved to singleton::ImageCache.
+         */
+        template <>
+        struct LoadFromFile<sf::Image> : ResourceLoader<sf::Image>
+        {
+            using ResourceLoader<sf::Image>::operator();
+            using ResourceLoader<sf::Image>::stage;
+
+            /*!
+             @brief Load an image in a quality tier
+
+             When the tier has no file for `id`, the file of the best tier
+             below is downscaled.
+
+             @param id Resource id to load
+             @param tier quality tier; see Locations::setTierPrefix()
+             @return a pointer to a valid image or 0 on failure
+             */
+            sf::Image* operator()(std::string const& id, unsigned tier)
+            {
+                unsigned found = 0;
+                std::string const path = singleton::ResourceLocations::getInstance().resolve(id, tier, found);
+                if (path.empty())
+                {
+                    return 0;
+                }
+
+                sf::Image* image = ResourceAllocator<sf::Image>::create();
+
+                if (!load(*image, path))
+                {
+                    ResourceAllocator<sf::Image>::destroy(image);
+                    return 0;
+                }
+
+                priv::downscale(*image, tier - found);
+                return image;
+            }
+
+            /*!
+             @brief Decode an image in a quality tier on a worker thread
+             */
+            Staged* stage(std::string const& id, unsigned tier)
+            {
+                return (*this)(id, tier);
+            }
+
+            bool load(sf::Image& res, std::string src)
+            {
+                ImageCache& cache = singleton::ImageCache::getInstance();
+
+                if (cache.load(src, res))
+                {
+                    return true;
+                }
+
+                sf::Clock clock;
+                if (!res.loadFromFile(src))
+                {
+                    return false;
+                }
+                cache.store(src, res, clock.getElapsedTime());
+
+                return true;
+            }
+
+            bool commitInto(sf::Image& res, sf::Image* staged)
+            {
+                res = *staged;
+                ResourceAllocator<sf::Image>::destroy(staged);
+                return true;
+            }
+        };
+
+        /*!
+         @brief Specialisation of LoadFromFile for sf::Texture
+
+         When loaded asynchronously, the file is decoded into an sf::Image by
+         a worker thread and only the upload to the graphics card is done
+         on the thread owning the manager.
+         */
+        template <>
+        struct LoadFromFile<sf::Texture> : ResourceLoader<sf::Texture>
+        {
+            typedef sf::Image Staged; //!< Decoded pixels
+
+            using ResourceLoader<sf::Texture>::operator();
+
+            /*!
+             @brief Load a texture in a quality tier
+
+             @param id Resource id to load
+             @param tier quality tier; see LoadFromFile<sf::Image>
+             @return a pointer to a valid texture or 0 on failure
+             */
+            sf::Texture* operator()(std::string const& id, unsigned tier)
+            {
+                Staged* image = stage(id, tier);
+                return image ? commit(image) : 0;
+            }
+
+            /*!
+             @brief Decode a texture in a quality tier on a worker thread
+             */
+            Staged* stage(std::string const& id, unsigned tier)
+            {
+                return LoadFromFile<sf::Image>()(id, tier);
+            }
+
+            bool load(sf::Texture& res, std::string src)
+            {
+                // Decode through singleton::ImageCache
+                sf::Image image;
+                return LoadFromFile<sf::Image>().load(image, src) && res.loadFromImage(image);
+            }
+
+            Staged* stage(std::string const& id)
+            {
+                return LoadFromFile<sf::Image>()(id);
+            }
+
+            sf::Texture* commit(Staged* image)
+            {
+                return priv::uploadTexture(image);
+            }
+
+            bool commitInto(sf::Texture& res, Staged* image)
+            {
+                bool const success = res.loadFromImage(*image);
+                ResourceAllocator<sf::Image>::destroy(image);
+                return success;
+            }
+        };
+
+        /*!
+         @brief Specialisation of LoadFromPack for sf::Texture
+
+         Like LoadFromFile<sf::Texture>, only the upload is done on the
+         thread owning the manager when loading asynchronously.
+         */
+        template <>
+        struct LoadFromPack<sf::Texture>
+        {
+            typedef sf::Image Staged; //!< Decoded pixels
+
+            sf::Texture* operator()(std::string const& id)
+            {
+                return commit(stage(id));
+            }
+
+            Staged* stage(std::string const& id)
+            {
+                return LoadFromPack<sf::Image>()(id);
+            }
+
+            bool locate(std::string const& id, priv::IoRequest& request)
+            {
+                return LoadFromPack<sf::Image>().locate(id, request);
+            }
+
+            sf::Texture* commit(Staged* image)
+            {
+                return image ? priv::uploadTexture(image) : 0;
+            }
+
+            bool commitInto(sf::Texture& res, Staged* image)
+            {
+                bool const success = res.loadFromImage(*image);
+                ResourceAllocator<sf::Image>::destroy(image);
+                return success;
+            }
+        };
+
+#ifndef SFTOOLS_NO_AUDIO
+
+        /*!
+         @brief Specialisation of LoadFromPack for sf::Music
+
+         The music is streamed from the memory mapping of the archive.
+
+         @note The musics it creates are not sf::Music objects but objects
+               derived from it : ResourceAllocator<sf::Music> must not be
+               specialised.
+         */
+        template <>
+        struct LoadFromPack<sf::Music>
+        {
+            sf::Music* operator()(std::string const& id)
+            {
+                static_assert(priv::UsesNewDelete<sf::Music>::value,
+                              "LoadFromPack<sf::Music> requires the default ResourceAllocator<sf::Music>");
+
+                char const* data = 0;
+                std::size_t size = 0;
+
+                if (!singleton::ResourcePack::getInstance().find(id, data, size))
+                {
+                    return 0;
+                }
+
+                StreamedMusic* music = new StreamedMusic(data, size);
+
+                if (music->open())
+                {
+                    return music;
+                }
+
+                delete music;
+                return 0;
+            }
+
+        private:
+            /*!
+             @brief Hold the stream of a StreamedMusic
+
+             As a base class listed before sf::Music, the stream is created
+             before and destroyed after the music that reads from it.
+             */
+            struct StreamHolder
+            {
+                StreamHolder(char const* data, std::size_t size) : stream(data, size) { }
+
+                priv::MemoryStream stream; //!< stream over the archive
+            };
+
+            /*!
+             @brief sf::Music owning its stream
+
+             It can be deleted through a pointer to sf::Music since sf::Music
+             has a virtual destructor.
+             */
+            struct StreamedMusic : private StreamHolder, public sf::Music
+            {
+                StreamedMusic(char const* data, std::size_t size) : StreamHolder(data, size) { }
+
+                bool open() { return openFromStream(stream); }
+            };
+        };
+
+#endif
+
         /*!
          @typedef sftools::loader::TextureLoaderFromFile
          @brief Load sf::Texture from file
@@ -87,9 +463,281 @@ namespace sftools
          */
         typedef loader::OpenFromFile<sf::Music> MusicOpenerFromFile;
         
+#endif
+
+        /*!
+         @typedef sftools::loader::TextureLoaderFromPack
+         @brief Load sf::Texture from singleton::ResourcePack
+         */
+        typedef loader::LoadFromPack<sf::Texture> TextureLoaderFromPack;
+
+        /*!
+         @typedef sftools::loader::ImageLoaderFromPack
+         @brief Load sf::Image from singleton::ResourcePack
+         */
+        typedef loader::LoadFromPack<sf::Image> ImageLoaderFromPack;
+
+        /*!
+         @typedef sftools::loader::FontLoaderFromPack
+         @brief Load sf::Font from singleton::ResourcePack
+         */
+        typedef loader::LoadFromPack<sf::Font> FontLoaderFromPack;
+
+#ifndef SFTOOLS_NO_AUDIO
+
+        /*!
+         @typedef sftools::loader::SoundBufferLoaderFromPack
+         @brief Load sf::SoundBuffer from singleton::ResourcePack
+         */
+        typedef loader::LoadFromPack<sf::SoundBuffer> SoundBufferLoaderFromPack;
+
+        /*!
+         @typedef sftools::loader::MusicOpenerFromPack
+         @brief Stream sf::Music from singleton::ResourcePack
+         */
+        typedef loader::LoadFromPack<sf::Music> MusicOpenerFromPack;
+
+#endif
+
+        /*!
+         @typedef sftools::loader::TextureLoaderFromBatch
+         @brief Load sf::Texture from files read in batches
+         */
+        typedef loader::LoadFromBatch<sf::Texture> TextureLoaderFromBatch;
+
+        /*!
+         @typedef sftools::loader::ImageLoaderFromBatch
+         @brief Load sf::Image from files read in batches
+         */
+        typedef loader::LoadFromBatch<sf::Image> ImageLoaderFromBatch;
+
+#ifndef SFTOOLS_NO_AUDIO
+
+        /*!
+         @typedef sftools::loader::SoundBufferLoaderFromBatch
+         @brief Load sf::SoundBuffer from files read in batches
+         */
+        typedef loader::LoadFromBatch<sf::SoundBuffer> SoundBufferLoaderFromBatch;
+
 #endif
     }
 
+    /*!
+     @brief Size estimator for sf::Texture : 4 bytes per pixel
+     */
+    template <>
+    struct ResourceSize<sf::Texture>
+    {
+        std::size_t operator()(sf::Texture const& res) const
+        {
+            return static_cast<std::size_t>(res.getSize().x) * res.getSize().y * 4;
+        }
+    };
+
+    /*!
+     @brief Size estimator for sf::Image : 4 bytes per pixel
+     */
+    template <>
+    struct ResourceSize<sf::Image>
+    {
+        std::size_t operator()(sf::Image const& res) const
+        {
+            return static_cast<std::size_t>(res.getSize().x) * res.getSize().y * 4;
+        }
+    };
+
+    /*!
+     @brief Placeholder for sf::Texture : a 1x1 magenta texture
+     */
+    template <>
+    struct Placeholder<sf::Texture>
+    {
+        sf::Texture* operator()() const
+        {
+            sf::Image image;
+            image.create(1, 1, sf::Color::Magenta);
+
+            sf::Texture* texture = new sf::Texture;
+            texture->loadFromImage(image);
+            return texture;
+        }
+    };
+
+    /*!
+     @brief Placeholder for sf::Image : a 1x1 magenta image
+     */
+    template <>
+    struct Placeholder<sf::Image>
+    {
+        sf::Image* operator()() const
+        {
+            sf::Image* image = new sf::Image;
+            image->create(1, 1, sf::Color::Magenta);
+            return image;
+        }
+    };
+
+    /*!
+     @brief Compressor for sf::Image : LZ4 block of the pixels
+     */
+    template <>
+    struct ResourceCompressor<sf::Image>
+    {
+        bool compress(sf::Image const& res, std::vector<char>& out) const
+        {
+            std::uint32_t const header[2] = { res.getSize().x, res.getSize().y };
+            std::size_t const size = static_cast<std::size_t>(header[0]) * header[1] * 4;
+            if (size == 0)
+            {
+                return false;
+            }
+
+            priv::lz4Compress(reinterpret_cast<char const*>(res.getPixelsPtr()), size, out);
+            if (out.empty())
+            {
+                return false;
+            }
+
+            char const* bytes = reinterpret_cast<char const*>(header);
+            out.insert(out.begin(), bytes, bytes + sizeof(header));
+            return true;
+        }
+
+        sf::Image* decompress(std::vector<char> const& data) const
+        {
+            std::uint32_t header[2];
+            if (data.size() < sizeof(header))
+            {
+                return 0;
+            }
+            std::memcpy(header, &data[0], sizeof(header));
+
+            std::vector<char> pixels(static_cast<std::size_t>(header[0]) * header[1] * 4);
+            if (pixels.empty() || !priv::lz4Decompress(&data[0] + sizeof(header), data.size() - sizeof(header), &pixels[0], pixels.size()))
+            {
+                return 0;
+            }
+
+            sf::Image* image = ResourceAllocator<sf::Image>::create();
+            image->create(header[0], header[1], reinterpret_cast<sf::Uint8 const*>(&pixels[0]));
+            return image;
+        }
+    };
+
+#ifndef SFTOOLS_NO_AUDIO
+
+    /*!
+     @brief Placeholder for sf::SoundBuffer : a single silent sample
+     */
+    template <>
+    struct Placeholder<sf::SoundBuffer>
+    {
+        sf::SoundBuffer* operator()() const
+        {
+            sf::Int16 const silence = 0;
+
+            sf::SoundBuffer* buffer = new sf::SoundBuffer;
+            buffer->loadFromSamples(&silence, 1, 1, 44100);
+            return buffer;
+        }
+    };
+
+    /*!
+     @brief Size estimator for sf::SoundBuffer : 2 bytes per sample
+     */
+    template <>
+    struct ResourceSize<sf::SoundBuffer>
+    {
+        std::size_t operator()(sf::SoundBuffer const& res) const
+        {
+            return static_cast<std::size_t>(res.getSampleCount()) * 2;
+        }
+    };
+
+    /*!
+     @brief Compressor for sf::SoundBuffer : LZ4 block of the samples
+
+     Samples are stored as their difference with the previous sample of
+     their channel, low bytes first then high bytes; the high bytes of
+     such differences are mostly 0 or -1, which LZ4 compresses well.
+     */
+    template <>
+    struct ResourceCompressor<sf::SoundBuffer>
+    {
+        bool compress(sf::SoundBuffer const& res, std::vector<char>& out) const
+        {
+            std::size_t const count = static_cast<std::size_t>(res.getSampleCount());
+            std::size_t const channels = res.getChannelCount();
+            if (count == 0 || channels == 0)
+            {
+                return false;
+            }
+
+            sf::Int16 const* samples = res.getSamples();
+            std::vector<char> planes(count * 2);
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                std::uint16_t const previous = i >= channels ? static_cast<std::uint16_t>(samples[i - channels]) : 0;
+                std::uint16_t const delta = static_cast<std::uint16_t>(static_cast<std::uint16_t>(samples[i]) - previous);
+                planes[i] = static_cast<char>(delta & 0xFF);
+                planes[count + i] = static_cast<char>(delta >> 8);
+            }
+
+            priv::lz4Compress(&planes[0], planes.size(), out);
+            if (out.empty())
+            {
+                return false;
+            }
+
+            std::uint64_t const header[3] = { count, channels, res.getSampleRate() };
+            char const* bytes = reinterpret_cast<char const*>(header);
+            out.insert(out.begin(), bytes, bytes + sizeof(header));
+            return true;
+        }
+
+        sf::SoundBuffer* decompress(std::vector<char> const& data) const
+        {
+            std::uint64_t header[3];
+            if (data.size() < sizeof(header))
+            {
+                return 0;
+            }
+            std::memcpy(header, &data[0], sizeof(header));
+
+            std::size_t const count = static_cast<std::size_t>(header[0]);
+            std::size_t const channels = static_cast<std::size_t>(header[1]);
+            if (count == 0 || channels == 0)
+            {
+                return 0;
+            }
+
+            std::vector<char> planes(count * 2);
+            if (!priv::lz4Decompress(&data[0] + sizeof(header), data.size() - sizeof(header), &planes[0], planes.size()))
+            {
+                return 0;
+            }
+
+            std::vector<sf::Int16> samples(count);
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                std::uint16_t const previous = i >= channels ? static_cast<std::uint16_t>(samples[i - channels]) : 0;
+                std::uint16_t const delta = static_cast<std::uint16_t>(static_cast<unsigned char>(planes[i])
+                                                                       | static_cast<unsigned char>(planes[count + i]) << 8);
+                samples[i] = static_cast<sf::Int16>(static_cast<std::uint16_t>(previous + delta));
+            }
+
+            sf::SoundBuffer* buffer = ResourceAllocator<sf::SoundBuffer>::create();
+            if (!buffer->loadFromSamples(&samples[0], count, static_cast<unsigned int>(channels), static_cast<unsigned int>(header[2])))
+            {
+                ResourceAllocator<sf::SoundBuffer>::destroy(buffer);
+                return 0;
+            }
+            return buffer;
+        }
+    };
+
+#endif
+
     /*!
      @typedef sftools::TextureManager
      @brief A manager type for sf::Texture
@@ -0,0 +1,660 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file sftools/ResourceManager/Storage.hpp
+ @brief Defines the storage policies of GenericManager
+ */
+
+#ifndef __SFTOOLS_STORAGE_HPP__
+#define __SFTOOLS_STORAGE_HPP__
+
+#include <sftools/ResourceManager/ContentHash.hpp>
+#include <map>
+#include <vector>
+#include <string>
+#include <utility> // std::pair
+#include <functional> // std::hash, std::less
+#include <cstddef>
+#include <cstring> // std::strlen
+#include <type_traits>
+
+#if __cplusplus >= 201703L
+    #include <string_view>
+#endif
+
+/*!
+ @namespace sftools
+ @brief Simple and Fast Tools
+ */
+namespace sftools
+{
+    namespace priv
+    {
+        /*!
+         @brief Tell whether `Key` is a string type that can look up `K`
+                keys without being converted to std::string
+
+         @tparam K   Key type of a storage
+         @tparam Key Type of a lookup argument
+         */
+        template <typename K, typename Key>
+        struct IsStringKey
+        {
+            static bool const value = std::is_same<K, std::string>::value
+                                      && (std::is_convertible<Key const&, char const*>::value
+#if __cplusplus >= 201703L
+                                          || std::is_same<Key, std::string_view>::value
+#endif
+                                         );
+        };
+    }
+
+    /*!
+     @namespace sftools::storage
+     @brief Contains the storage policies of GenericManager
+
+     A storage policy is a class template taking a key type and a value type
+     and providing :
+
+     \li `V* find(K const&)` (and its const version) returning 0 when the
+         key is not stored;
+     \li optionally, a `find()` template accepting other key types, such
+         as `char const*` for std::string keys, without converting them;
+     \li `V& insert(K const&, V const&)` which adds or replaces an entry;
+     \li `bool take(K const&, V&)` which removes an entry and gives back its
+         value, in one lookup;
+     \li `void clear()` and `std::size_t size() const`;
+     \li `Iterator` and `ConstIterator` types, with `begin()` and `end()`,
+         pointing to `std::pair<K, V>`-like objects.
+
+     @see GenericManager
+     */
+    namespace storage
+    {
+        /*!
+         @brief Hash function of the keys of storage::Hash
+
+         By default `std::hash` is used.
+
+         @tparam K Key type
+         */
+        template <typename K>
+        struct KeyHash
+        {
+            std::size_t operator()(K const& key) const
+            {
+                return std::hash<K>()(key);
+            }
+        };
+
+        /*!
+         @brief Hash function for std::string keys
+
+         Strings can also be looked up as `char const*` or, with C++17,
+         `std::string_view` : they hash the same.
+         */
+        template <>
+        struct KeyHash<std::string>
+        {
+            std::size_t operator()(std::string const& key) const
+            {
+                return hash(key.data(), key.size());
+            }
+
+            std::size_t operator()(char const* key) const
+            {
+                return hash(key, std::strlen(key));
+            }
+
+#if __cplusplus >= 201703L
+            std::size_t operator()(std::string_view key) const
+            {
+                return hash(key.data(), key.size());
+            }
+#endif
+
+        private:
+            static std::size_t hash(char const* data, std::size_t size)
+            {
+                return static_cast<std::size_t>(priv::xxHash64(data, size));
+            }
+        };
+
+        /*!
+         @class Map
+         @brief Ordered storage based on `std::map`
+
+         Lookups are O(log n) key comparisons. From C++14 on, keys can be
+         looked up with any type comparable with `K` (e.g. `char const*`
+         for std::string keys) without being converted; before, they are
+         converted into a buffer reused by the thread.
+
+         @tparam K Key type; must be less-than comparable
+         @tparam V Value type
+         */
+        template <typename K, typename V>
+        class Map
+        {
+#if __cplusplus >= 201402L
+            typedef std::map<K, V, std::less<> > Storage; //!< Private storage type
+#else
+            typedef std::map<K, V> Storage; //!< Private storage type
+#endif
+            Storage m_entries; //!< entries storage
+
+#if __cplusplus < 201402L
+            /*!
+             @brief Convert a key without allocating in the steady state
+
+             The buffer of the thread is reused, so only keys longer than
+             any previous one allocate.
+             */
+            template <typename Key>
+            static K const& convert(Key const& key)
+            {
+                static thread_local K buffer;
+                buffer = key;
+                return buffer;
+            }
+#endif
+
+        public:
+            typedef typename Storage::iterator Iterator; //!< Mutable iterator type
+            typedef typename Storage::const_iterator ConstIterator; //!< Constant iterator type
+
+            V* find(K const& key)
+            {
+                Iterator it = m_entries.find(key);
+                return it != m_entries.end() ? &it->second : 0;
+            }
+
+            V const* find(K const& key) const
+            {
+                ConstIterator it = m_entries.find(key);
+                return it != m_entries.end() ? &it->second : 0;
+            }
+
+            template <typename Key>
+            V* find(Key const& key)
+            {
+#if __cplusplus >= 201402L
+                Iterator it = m_entries.find(key);
+#else
+                Iterator it = m_entries.find(convert(key));
+#endif
+                return it != m_entries.end() ? &it->second : 0;
+            }
+
+            template <typename Key>
+            V const* find(Key const& key) const
+            {
+#if __cplusplus >= 201402L
+                ConstIterator it = m_entries.find(key);
+#else
+                ConstIterator it = m_entries.find(convert(key));
+#endif
+                return it != m_entries.end() ? &it->second : 0;
+            }
+
+            V& insert(K const& key, V const& value)
+            {
+                return m_entries[key] = value;
+            }
+
+            bool take(K const& key, V& value)
+            {
+                Iterator it = m_entries.find(key);
+                if (it == m_entries.end())
+                {
+                    return false;
+                }
+
+                value = it->second;
+                m_entries.erase(it);
+                return true;
+            }
+
+            void clear()
+            {
+                m_entries.clear();
+            }
+
+            std::size_t size() const
+            {
+                return m_entries.size();
+            }
+
+            Iterator begin() { return m_entries.begin(); }
+            Iterator end() { return m_entries.end(); }
+            ConstIterator begin() const { return m_entries.begin(); }
+            ConstIterator end() const { return m_entries.end(); }
+        };
+
+        /*!
+         @class Hash
+         @brief Unordered storage based on an open-addressing hash table
+
+         Lookups are O(1) on average: the table uses linear probing over an
+         array of cached hashes, so keys are only compared when their full
+         hashes match. Deletion shifts the following entries back instead of
+         leaving tombstones, so lookups never slow down after many unloads.
+
+         Entries are moved around when the table grows or when an entry is
+         removed : pointers returned by find() are only valid until the next
+         insertion or removal.
+
+         Keys can be looked up with any type that KeyHash<K> accepts and
+         that is equality comparable with `K`, without being converted.
+
+         @tparam K Key type; must be default constructible, equality
+                   comparable and hashable with KeyHash
+         @tparam V Value type; must be default constructible
+         */
+        template <typename K, typename V>
+        class Hash
+        {
+            typedef std::pair<K, V> Entry; //!< Private entry type
+
+        public:
+            /*!
+             @brief Iterator over the occupied slots
+             */
+            template <typename T, typename Table>
+            class BasicIterator
+            {
+            public:
+                BasicIterator(Table* table, std::size_t index)
+                : m_table(table), m_index(index)
+                {
+                    skipEmpty();
+                }
+
+                T& operator*() const { return m_table->m_entries[m_index]; }
+                T* operator->() const { return &m_table->m_entries[m_index]; }
+
+                BasicIterator& operator++()
+                {
+                    ++m_index;
+                    skipEmpty();
+                    return *this;
+                }
+
+                bool operator==(BasicIterator const& other) const { return m_index == other.m_index; }
+                bool operator!=(BasicIterator const& other) const { return m_index != other.m_index; }
+
+            private:
+                void skipEmpty()
+                {
+                    while (m_index < m_table->m_hashes.size() && m_table->m_hashes[m_index] == 0)
+                    {
+                        ++m_index;
+                    }
+                }
+
+                Table* m_table; //!< iterated table
+                std::size_t m_index; //!< current slot
+            };
+
+            typedef BasicIterator<Entry, Hash> Iterator; //!< Mutable iterator type
+            typedef BasicIterator<Entry const, Hash const> ConstIterator; //!< Constant iterator type
+
+            /*!
+             @brief Constructor
+             */
+            Hash()
+            : m_size(0)
+            , m_shift(sizeof(std::size_t) * 8)
+            {
+                // Slots are allocated on first insertion
+            }
+
+            V* find(K const& key)
+            {
+                std::size_t index = lookup(key);
+                return index != NotFound ? &m_entries[index].second : 0;
+            }
+
+            V const* find(K const& key) const
+            {
+                std::size_t index = lookup(key);
+                return index != NotFound ? &m_entries[index].second : 0;
+            }
+
+            template <typename Key>
+            V* find(Key const& key)
+            {
+                std::size_t index = lookup(key);
+                return index != NotFound ? &m_entries[index].second : 0;
+            }
+
+            template <typename Key>
+            V const* find(Key const& key) const
+            {
+                std::size_t index = lookup(key);
+                return index != NotFound ? &m_entries[index].second : 0;
+            }
+
+            V& insert(K const& key, V const& value)
+            {
+                if ((m_size + 1) * 2 > m_hashes.size())
+                {
+                    grow();
+                }
+
+                std::size_t const hash = hashOf(key);
+                std::size_t index = home(hash);
+
+                for (;; index = next(index))
+                {
+                    if (m_hashes[index] == 0)
+                    {
+                        m_hashes[index] = hash;
+                        m_entries[index] = Entry(key, value);
+                        ++m_size;
+                        return m_entries[index].second;
+                    }
+                    else if (m_hashes[index] == hash && m_entries[index].first == key)
+                    {
+                        return m_entries[index].second = value;
+                    }
+                }
+            }
+
+            bool take(K const& key, V& value)
+            {
+                std::size_t hole = lookup(key);
+                if (hole == NotFound)
+                {
+                    return false;
+                }
+
+                value = m_entries[hole].second;
+
+                // Backward shift deletion: pull back every following entry
+                // of the cluster that can legally fill the hole.
+                for (std::size_t index = next(hole); m_hashes[index] != 0; index = next(index))
+                {
+                    std::size_t const ideal = home(m_hashes[index]);
+
+                    // Can the entry move to the hole without being placed
+                    // before its home slot ?
+                    if (((index - ideal) & mask()) >= ((index - hole) & mask()))
+                    {
+                        m_hashes[hole] = m_hashes[index];
+                        m_entries[hole] = m_entries[index];
+                        hole = index;
+                    }
+                }
+
+                m_hashes[hole] = 0;
+                m_entries[hole] = Entry();
+                --m_size;
+
+                return true;
+            }
+
+            void clear()
+            {
+                m_hashes.assign(m_hashes.size(), 0);
+                m_entries.assign(m_entries.size(), Entry());
+                m_size = 0;
+            }
+
+            std::size_t size() const
+            {
+                return m_size;
+            }
+
+            Iterator begin() { return Iterator(this, 0); }
+            Iterator end() { return Iterator(this, m_hashes.size()); }
+            ConstIterator begin() const { return ConstIterator(this, 0); }
+            ConstIterator end() const { return ConstIterator(this, m_hashes.size()); }
+
+        private:
+            static std::size_t const NotFound = static_cast<std::size_t>(-1); //!< lookup() failure
+
+            /*!
+             @brief Compute the hash of a key; 0 is reserved for empty slots
+             */
+            template <typename Key>
+            static std::size_t hashOf(Key const& key)
+            {
+                std::size_t const hash = KeyHash<K>()(key);
+                return hash != 0 ? hash : 1;
+            }
+
+            /*!
+             @brief Compute the preferred slot of a hash
+
+             Fibonacci hashing spreads weak hashes (e.g. integers) over the
+             whole table.
+             */
+            std::size_t home(std::size_t hash) const
+            {
+                return m_shift >= sizeof(std::size_t) * 8
+                       ? 0
+                       : static_cast<std::size_t>(hash * static_cast<std::size_t>(0x9E3779B97F4A7C15ull)) >> m_shift;
+            }
+
+            std::size_t mask() const
+            {
+                return m_hashes.size() - 1;
+            }
+
+            std::size_t next(std::size_t index) const
+            {
+                return (index + 1) & mask();
+            }
+
+            /*!
+             @brief Find the slot of a key, or NotFound
+             */
+            template <typename Key>
+            std::size_t lookup(Key const& key) const
+            {
+                if (m_size == 0)
+                {
+                    return NotFound;
+                }
+
+                std::size_t const hash = hashOf(key);
+
+                for (std::size_t index = home(hash); m_hashes[index] != 0; index = next(index))
+                {
+                    if (m_hashes[index] == hash && m_entries[index].first == key)
+                    {
+                        return index;
+                    }
+                }
+
+                return NotFound;
+            }
+
+            /*!
+             @brief Double the capacity and re-insert all entries
+             */
+            void grow()
+            {
+                std::vector<std::size_t> hashes(m_hashes.empty() ? 16 : m_hashes.size() * 2, 0);
+                std::vector<Entry> entries(hashes.size());
+
+                hashes.swap(m_hashes);
+                entries.swap(m_entries);
+
+                m_shift = sizeof(std::size_t) * 8;
+                for (std::size_t capacity = m_hashes.size(); capacity > 1; capacity /= 2)
+                {
+                    --m_shift;
+                }
+
+                for (std::size_t i = 0; i < hashes.size(); ++i)
+                {
+                    if (hashes[i] != 0)
+                    {
+                        std::size_t index = home(hashes[i]);
+                        while (m_hashes[index] != 0)
+                        {
+                            index = next(index);
+                        }
+
+                        m_hashes[index] = hashes[i];
+                        m_entries[index] = entries[i];
+                    }
+                }
+            }
+
+            std::vector<std::size_t> m_hashes; //!< cached hashes; 0 means empty
+            std::vector<Entry> m_entries; //!< entries, parallel to m_hashes
+            std::size_t m_size; //!< number of occupied slots
+            unsigned int m_shift; //!< bits dropped by home()
+        };
+
+        /*!
+         @class Dense
+         @brief Slot map for small integral or enum keys
+
+         Keys index an array holding the position of their entry, so a
+         lookup is one bounds-checked array access. Entries are stored
+         contiguously and iterated in a single pass; removing an entry
+         moves the last one into its place.
+
+         Like with Hash, pointers returned by find() are only valid until
+         the next insertion or removal.
+
+         @tparam K Key type; an integral or enum type whose values are
+                   non-negative and small, as the index array has as many
+                   slots as the largest key plus one
+         @tparam V Value type; must be default constructible
+         */
+        template <typename K, typename V>
+        class Dense
+        {
+            static_assert(std::is_integral<K>::value || std::is_enum<K>::value,
+                          "storage::Dense requires integral or enum keys");
+
+            typedef std::pair<K, V> Entry; //!< Private entry type
+            typedef std::vector<Entry> Entries; //!< Private storage type
+
+        public:
+            typedef typename Entries::iterator Iterator; //!< Mutable iterator type
+            typedef typename Entries::const_iterator ConstIterator; //!< Constant iterator type
+
+            V* find(K const& key)
+            {
+                std::size_t const position = positionOf(key);
+                return position != NotFound ? &m_entries[position].second : 0;
+            }
+
+            V const* find(K const& key) const
+            {
+                std::size_t const position = positionOf(key);
+                return position != NotFound ? &m_entries[position].second : 0;
+            }
+
+            V& insert(K const& key, V const& value)
+            {
+                std::size_t const slot = slotOf(key);
+
+                if (slot >= m_positions.size())
+                {
+                    std::size_t const empty = NotFound;
+                    m_positions.resize(slot + 1, empty);
+                }
+                else if (m_positions[slot] != NotFound)
+                {
+                    return m_entries[m_positions[slot]].second = value;
+                }
+
+                m_positions[slot] = m_entries.size();
+                m_entries.push_back(Entry(key, value));
+                return m_entries.back().second;
+            }
+
+            bool take(K const& key, V& value)
+            {
+                std::size_t const position = positionOf(key);
+                if (position == NotFound)
+                {
+                    return false;
+                }
+
+                value = m_entries[position].second;
+
+                // Keep the entries contiguous
+                if (position + 1 != m_entries.size())
+                {
+                    m_entries[position] = m_entries.back();
+                    m_positions[slotOf(m_entries[position].first)] = position;
+                }
+
+                m_entries.pop_back();
+                m_positions[slotOf(key)] = NotFound;
+
+                return true;
+            }
+
+            void clear()
+            {
+                m_entries.clear();
+                m_positions.clear();
+            }
+
+            std::size_t size() const
+            {
+                return m_entries.size();
+            }
+
+            Iterator begin() { return m_entries.begin(); }
+            Iterator end() { return m_entries.end(); }
+            ConstIterator begin() const { return m_entries.begin(); }
+            ConstIterator end() const { return m_entries.end(); }
+
+        private:
+            static std::size_t const NotFound = static_cast<std::size_t>(-1); //!< Empty slot
+
+            /*!
+             @brief Get the slot of a key
+             */
+            static std::size_t slotOf(K const& key)
+            {
+                return static_cast<std::size_t>(key);
+            }
+
+            /*!
+             @brief Get the position of the entry of a key, or NotFound
+             */
+            std::size_t positionOf(K const& key) const
+            {
+                std::size_t const slot = slotOf(key);
+                return slot < m_positions.size() ? m_positions[slot] : NotFound;
+            }
+
+            std::vector<std::size_t> m_positions; //!< key -> position in m_entries
+            Entries m_entries; //!< entries, without holes
+        };
+    }
+}
+
+#endif // __SFTOOLS_STORAGE_HPP__
@@ -0,0 +1,495 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file sftools/ResourceManager/Telemetry.hpp
+ @brief Defines ManagerStats and LatencyHistogram classes
+ @note Requires C++11
+
+ Define SFTOOLS_NO_TELEMETRY to compile the instrumentation of the managers
+ out; GenericManager::getStats() then only reports zeros.
+ */
+
+#ifndef __SFTOOLS_TELEMETRY_HPP__
+#define __SFTOOLS_TELEMETRY_HPP__
+
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+#ifdef SFTOOLS_NO_TELEMETRY
+    #define SFTOOLS_TELEMETRY(statement)
+#else
+    #define SFTOOLS_TELEMETRY(statement) statement
+#endif
+
+/*!
+ @namespace sftools
+ @brief Simple and Fast Tools
+ */
+namespace sftools
+{
+    /*!
+     @class LatencyHistogram
+     @brief Distribution of durations in power-of-two buckets
+
+     Bucket 0 counts durations under 1 microsecond; bucket `i` counts
+     durations in [2^(i-1), 2^i) microseconds. The last bucket also counts
+     everything longer.
+     */
+    struct LatencyHistogram
+    {
+        static const unsigned int BucketCount = 32; //!< Number of buckets
+
+        /*!
+         @brief Default constructor; empty histogram
+         */
+        LatencyHistogram()
+        : count(0), total(0), max(0)
+        {
+            for (unsigned int i = 0; i < BucketCount; ++i)
+            {
+                buckets[i] = 0;
+            }
+        }
+
+        /*!
+         @brief Get the bucket of a duration
+
+         @param microseconds duration
+         @return index of the bucket counting `microseconds`
+         */
+        static unsigned int getBucket(std::uint64_t microseconds)
+        {
+            unsigned int bucket = 0;
+            while (microseconds != 0 && bucket + 1 < BucketCount)
+            {
+                microseconds >>= 1;
+                ++bucket;
+            }
+            return bucket;
+        }
+
+        /*!
+         @brief Get the average duration
+
+         @return mean in microseconds, 0 if empty
+         */
+        std::uint64_t getMean() const
+        {
+            return count == 0 ? 0 : total / count;
+        }
+
+        /*!
+         @brief Estimate a percentile
+
+         @param ratio percentile between 0 and 1 (e.g. 0.99)
+         @return upper bound, in microseconds, of the bucket holding the
+                 percentile; 0 if empty
+         */
+        std::uint64_t getPercentile(double ratio) const
+        {
+            std::uint64_t const rank = static_cast<std::uint64_t>(ratio * count);
+            std::uint64_t seen = 0;
+
+            for (unsigned int i = 0; i < BucketCount; ++i)
+            {
+                seen += buckets[i];
+                if (seen > rank || (seen == count && seen != 0))
+                {
+                    return i + 1 == BucketCount ? max : (std::uint64_t(1) << i);
+                }
+            }
+            return 0;
+        }
+
+        std::uint64_t buckets[BucketCount]; //!< Number of durations by bucket
+        std::uint64_t count; //!< Number of durations
+        std::uint64_t total; //!< Sum of the durations, in microseconds
+        std::uint64_t max; //!< Longest duration, in microseconds
+    };
+
+    /*!
+     @class ManagerStats
+     @brief Snapshot of the activity of a GenericManager
+
+     @see GenericManager::getStats
+     */
+    struct ManagerStats
+    {
+        /*!
+         @brief Default constructor; all zeros
+         */
+        ManagerStats()
+        : lookups(0), hits(0), misses(0)
+        , loads(0), failedLoads(0), suppressedLoads(0), reloads(0), unloads(0), evictions(0)
+        , residentCount(0), residentBytes(0), deduplicatedBytes(0)
+        , compressions(0), decompressions(0), compressedCount(0), compressedBytes(0), reclaimedBytes(0)
+        {
+            // That's it
+        }
+
+        /*!
+         @brief Write the statistics as a JSON object
+
+         @param out output stream
+         */
+        void writeJson(std::ostream& out) const
+        {
+            out << "{\"lookups\":" << lookups
+                << ",\"hits\":" << hits
+                << ",\"misses\":" << misses
+                << ",\"loads\":" << loads
+                << ",\"failedLoads\":" << failedLoads
+                << ",\"suppressedLoads\":" << suppressedLoads
+                << ",\"reloads\":" << reloads
+                << ",\"unloads\":" << unloads
+                << ",\"evictions\":" << evictions
+                << ",\"residentCount\":" << residentCount
+                << ",\"residentBytes\":" << residentBytes
+                << ",\"deduplicatedBytes\":" << deduplicatedBytes
+                << ",\"compressions\":" << compressions
+                << ",\"decompressions\":" << decompressions
+                << ",\"compressedCount\":" << compressedCount
+                << ",\"compressedBytes\":" << compressedBytes
+                << ",\"reclaimedBytes\":" << reclaimedBytes
+                << ",\"loadTime\":";
+            writeJson(out, loadTime);
+            out << ",\"probeTime\":";
+            writeJson(out, probeTime);
+            out << ",\"decodeTime\":";
+            writeJson(out, decodeTime);
+            out << "}";
+        }
+
+        /*!
+         @brief Get the statistics as a JSON object
+
+         @return JSON text
+         */
+        std::string toJson() const
+        {
+            std::ostringstream out;
+            writeJson(out);
+            return out.str();
+        }
+
+        std::uint64_t lookups; //!< Calls to operator[]
+        std::uint64_t hits; //!< Lookups of resident resources
+        std::uint64_t misses; //!< Lookups of missing or evicted resources
+        std::uint64_t loads; //!< Calls to `OnLoad`, reloads excluded
+        std::uint64_t failedLoads; //!< Loads that failed
+        std::uint64_t suppressedLoads; //!< Loads answered by the negative cache
+        std::uint64_t reloads; //!< Successful reloads of resident resources
+        std::uint64_t unloads; //!< Resources unloaded explicitly
+        std::uint64_t evictions; //!< Resources evicted to meet the budget
+        std::uint64_t residentCount; //!< Resources in memory
+        std::uint64_t residentBytes; //!< Their estimated size; see ResourceSize
+        std::uint64_t deduplicatedBytes; //!< Size of the resources shared with another id
+        std::uint64_t compressions; //!< Idle resources compressed in memory
+        std::uint64_t decompressions; //!< Compressed resources restored on use
+        std::uint64_t compressedCount; //!< Resources currently compressed
+        std::uint64_t compressedBytes; //!< Their compressed size
+        std::uint64_t reclaimedBytes; //!< Memory saved by compressing them
+        LatencyHistogram loadTime; //!< Duration of `OnLoad` calls, in microseconds
+        LatencyHistogram probeTime; //!< Part of loadTime spent in Locations::resolve
+        LatencyHistogram decodeTime; //!< Rest of loadTime
+
+    private:
+        /*!
+         @brief Write a histogram as a JSON object
+         */
+        static void writeJson(std::ostream& out, LatencyHistogram const& histogram)
+        {
+            out << "{\"count\":" << histogram.count
+                << ",\"total\":" << histogram.total
+                << ",\"max\":" << histogram.max
+                << ",\"p50\":" << histogram.getPercentile(0.5)
+                << ",\"p99\":" << histogram.getPercentile(0.99)
+                << ",\"buckets\":[";
+            for (unsigned int i = 0; i < LatencyHistogram::BucketCount; ++i)
+            {
+                out << (i == 0 ? "" : ",") << histogram.buckets[i];
+            }
+            out << "]}";
+        }
+    };
+
+    namespace priv
+    {
+        /*!
+         @brief Lock-free recorder behind a LatencyHistogram
+
+         Loads are timed by the worker threads as well as by the owner of
+         the manager, so the buckets are updated with read-modify-write
+         operations.
+         */
+        class HistogramRecorder
+        {
+        public:
+            HistogramRecorder()
+            : m_count(0), m_total(0), m_max(0)
+            {
+                for (unsigned int i = 0; i < LatencyHistogram::BucketCount; ++i)
+                {
+                    m_buckets[i] = 0;
+                }
+            }
+
+            /*!
+             @brief Record a duration
+
+             @param microseconds duration
+             */
+            void record(std::uint64_t microseconds)
+            {
+                m_buckets[LatencyHistogram::getBucket(microseconds)].fetch_add(1, std::memory_order_relaxed);
+                m_count.fetch_add(1, std::memory_order_relaxed);
+                m_total.fetch_add(microseconds, std::memory_order_relaxed);
+
+                std::uint64_t max = m_max.load(std::memory_order_relaxed);
+                while (microseconds > max && !m_max.compare_exchange_weak(max, microseconds, std::memory_order_relaxed))
+                {
+                    // max was updated; try again
+                }
+            }
+
+            /*!
+             @brief Copy the recorded durations
+
+             @param histogram receives the distribution
+             */
+            void copyTo(LatencyHistogram& histogram) const
+            {
+                for (unsigned int i = 0; i < LatencyHistogram::BucketCount; ++i)
+                {
+                    histogram.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+                }
+                histogram.count = m_count.load(std::memory_order_relaxed);
+                histogram.total = m_total.load(std::memory_order_relaxed);
+                histogram.max = m_max.load(std::memory_order_relaxed);
+            }
+
+        private:
+            std::atomic<std::uint64_t> m_buckets[LatencyHistogram::BucketCount]; //!< Durations by bucket
+            std::atomic<std::uint64_t> m_count; //!< Number of durations
+            std::atomic<std::uint64_t> m_total; //!< Sum of the durations
+            std::atomic<std::uint64_t> m_max; //!< Longest duration
+        };
+
+        /*!
+         @brief Counter updated with relaxed atomics by a single thread
+
+         Counters are only statistics: they don't order other memory
+         accesses, so the default sequentially consistent operations of
+         std::atomic would only slow the hot paths down. Only the thread
+         owning the manager writes them, so a load and a store replace the
+         locked read-modify-write instructions; any thread can read them.
+
+         @see SharedCounter
+         */
+        class RelaxedCounter
+        {
+        public:
+            RelaxedCounter()
+            : m_value(0)
+            {
+            }
+
+            void operator++()
+            {
+                *this += 1;
+            }
+
+            void operator--()
+            {
+                *this -= 1;
+            }
+
+            void operator+=(std::uint64_t value)
+            {
+                m_value.store(m_value.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+            }
+
+            void operator-=(std::uint64_t value)
+            {
+                m_value.store(m_value.load(std::memory_order_relaxed) - value, std::memory_order_relaxed);
+            }
+
+            void operator=(std::uint64_t value)
+            {
+                m_value.store(value, std::memory_order_relaxed);
+            }
+
+            /*!
+             @brief Read the counter
+
+             @return current value
+             */
+            std::uint64_t load() const
+            {
+                return m_value.load(std::memory_order_relaxed);
+            }
+
+        private:
+            std::atomic<std::uint64_t> m_value; //!< Current value
+        };
+
+        /*!
+         @brief Counter incremented with relaxed atomics by several threads
+
+         @see RelaxedCounter
+         */
+        class SharedCounter
+        {
+        public:
+            SharedCounter()
+            : m_value(0)
+            {
+            }
+
+            void operator++()
+            {
+                m_value.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            /*!
+             @brief Read the counter
+
+             @return current value
+             */
+            std::uint64_t load() const
+            {
+                return m_value.load(std::memory_order_relaxed);
+            }
+
+        private:
+            std::atomic<std::uint64_t> m_value; //!< Current value
+        };
+
+        /*!
+         @brief Lock-free counters behind a ManagerStats
+
+         The loads and their durations are recorded by the worker threads
+         too; every other counter is only written by the thread owning the
+         manager. All of them can be read from any thread.
+         */
+        struct Telemetry
+        {
+            typedef RelaxedCounter Counter; //!< A simple alias
+
+            /*!
+             @brief Copy the counters
+
+             @param stats receives the counters
+             */
+            void copyTo(ManagerStats& stats) const
+            {
+                stats.lookups = lookups.load();
+                stats.hits = hits.load();
+                stats.misses = misses.load();
+                stats.loads = loads.load();
+                stats.failedLoads = failedLoads.load();
+                stats.suppressedLoads = suppressedLoads.load();
+                stats.reloads = reloads.load();
+                stats.unloads = unloads.load();
+                stats.evictions = evictions.load();
+                stats.residentCount = residentCount.load();
+                stats.residentBytes = residentBytes.load();
+                stats.deduplicatedBytes = deduplicatedBytes.load();
+                stats.compressions = compressions.load();
+                stats.decompressions = decompressions.load();
+                stats.compressedCount = compressedCount.load();
+                stats.compressedBytes = compressedBytes.load();
+                stats.reclaimedBytes = reclaimedBytes.load();
+                loadTime.copyTo(stats.loadTime);
+                probeTime.copyTo(stats.probeTime);
+                decodeTime.copyTo(stats.decodeTime);
+            }
+
+            Counter lookups; //!< see ManagerStats
+            Counter hits; //!< see ManagerStats
+            Counter misses; //!< see ManagerStats
+            SharedCounter loads; //!< see ManagerStats
+            SharedCounter failedLoads; //!< see ManagerStats
+            Counter suppressedLoads; //!< see ManagerStats
+            Counter reloads; //!< see ManagerStats
+            Counter unloads; //!< see ManagerStats
+            Counter evictions; //!< see ManagerStats
+            Counter residentCount; //!< see ManagerStats
+            Counter residentBytes; //!< see ManagerStats
+            Counter deduplicatedBytes; //!< see ManagerStats
+            Counter compressions; //!< see ManagerStats
+            Counter decompressions; //!< see ManagerStats
+            Counter compressedCount; //!< see ManagerStats
+            Counter compressedBytes; //!< see ManagerStats
+            Counter reclaimedBytes; //!< see ManagerStats
+            HistogramRecorder loadTime; //!< see ManagerStats
+            HistogramRecorder probeTime; //!< see ManagerStats
+            HistogramRecorder decodeTime; //!< see ManagerStats
+        };
+
+        /*!
+         @brief Get the current time, for telemetry
+
+         @return time in microseconds
+         */
+        inline std::uint64_t telemetryClock()
+        {
+            return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+
+        /*!
+         @brief Time spent by the calling thread in Locations::resolve
+
+         GenericManager resets it before calling `OnLoad` to split the
+         duration of the call into probe and decode time.
+
+         @return accumulated time in microseconds
+         */
+        inline std::uint64_t& probeTime()
+        {
+            static thread_local std::uint64_t time = 0;
+            return time;
+        }
+
+        /*!
+         @brief Add its lifetime to probeTime()
+         */
+        struct ProbeScope
+        {
+            ProbeScope() : start(telemetryClock()) { }
+            ~ProbeScope() { probeTime() += telemetryClock() - start; }
+
+            std::uint64_t start; //!< Creation time
+        };
+    }
+}
+
+#endif // __SFTOOLS_TELEMETRY_HPP__
@@ -0,0 +1,172 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file sftools/ResourceManager/ThreadPool.hpp
+ @brief Defines the worker pool used by asynchronous resource loading
+ @note Requires C++11
+ */
+
+#ifndef __SFTOOLS_THREADPOOL_HPP__
+#define __SFTOOLS_THREADPOOL_HPP__
+
+#include <sftools/Common/NonCopyable.hpp>
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+#include <deque>
+#include <map>
+
+/*!
+ @namespace sftools
+ @brief Simple and Fast Tools
+ */
+namespace sftools
+{
+    namespace priv
+    {
+        /*!
+         @class ThreadPool
+         @brief Minimalist pool of worker threads
+
+         Tasks are executed by the first available worker, highest priority
+         first and in FIFO order among tasks of the same priority.
+         When the pool is destroyed, the tasks that were not started yet are
+         discarded and the running ones are awaited.
+         */
+        class ThreadPool : sftools::NonCopyable
+        {
+        public:
+            typedef std::function<void()> Task; //!< Unit of work
+
+            /*!
+             @brief Constructor
+
+             @param threadCount number of workers; 0 means one per hardware
+                                thread
+             */
+            explicit ThreadPool(unsigned int threadCount = 0)
+            : m_stopping(false)
+            {
+                if (threadCount == 0)
+                {
+                    threadCount = std::thread::hardware_concurrency();
+                }
+                if (threadCount == 0)
+                {
+                    threadCount = 1; // hardware_concurrency is only a hint
+                }
+
+                for (unsigned int i = 0; i < threadCount; ++i)
+                {
+                    m_threads.push_back(std::thread(&ThreadPool::run, this));
+                }
+            }
+
+            /*!
+             @brief Destructor
+
+             Discard pending tasks and join the workers.
+             */
+            ~ThreadPool()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_stopping = true;
+                    m_tasks.clear();
+                }
+                m_condition.notify_all();
+
+                for (std::size_t i = 0; i < m_threads.size(); ++i)
+                {
+                    m_threads[i].join();
+                }
+            }
+
+            /*!
+             @brief Schedule a task
+
+             @param task task to be executed by a worker
+             @param priority tasks with higher priorities are started first
+             */
+            void push(Task const& task, int priority = 0)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_tasks[priority].push_back(task);
+                }
+                m_condition.notify_one();
+            }
+
+        private:
+            /*!
+             @brief Workers' main loop
+             */
+            void run()
+            {
+                for (;;)
+                {
+                    Task task;
+
+                    {
+                        std::unique_lock<std::mutex> lock(m_mutex);
+                        while (!m_stopping && m_tasks.empty())
+                        {
+                            m_condition.wait(lock);
+                        }
+
+                        if (m_stopping)
+                        {
+                            return;
+                        }
+
+                        // Highest priority is the last queue
+                        TaskQueues::iterator queue = --m_tasks.end();
+                        task = queue->second.front();
+                        queue->second.pop_front();
+                        if (queue->second.empty())
+                        {
+                            m_tasks.erase(queue);
+                        }
+                    }
+
+                    task();
+                }
+            }
+
+            typedef std::map<int, std::deque<Task> > TaskQueues; //!< Pending tasks by priority
+
+            std::vector<std::thread> m_threads; //!< Workers
+            TaskQueues m_tasks; //!< Pending tasks; empty queues are removed
+            std::mutex m_mutex; //!< Protects m_tasks and m_stopping
+            std::condition_variable m_condition; //!< Wakes up idle workers
+            bool m_stopping; //!< Tells workers to exit
+        };
+    }
+}
+
+#endif // __SFTOOLS_THREADPOOL_HPP__
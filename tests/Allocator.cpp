@@ -0,0 +1,87 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file tests/Allocator.cpp
+ @brief PoolAllocator honours the alignment of the resources, and
+        specialisations of ResourceAllocator are told apart from the default
+        policy
+ */
+
+#include "Test.hpp"
+
+#include <sftools/ResourceManager/Allocator.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace
+{
+    struct alignas(64) Aligned
+    {
+        char data[8]; //!< Smaller than the alignment
+    };
+
+    struct Pooled { int value; };
+    struct Custom { int value; };
+}
+
+namespace sftools
+{
+    template <>
+    struct ResourceAllocator<Aligned> : PoolAllocator<Aligned> { };
+
+    template <>
+    struct ResourceAllocator<Pooled> : PoolAllocator<Pooled> { };
+
+    template <>
+    struct ResourceAllocator<Custom>
+    {
+        static Custom* create() { return new Custom(); }
+        static void destroy(Custom* ptr) { delete ptr; }
+    };
+}
+
+using namespace sftools;
+
+static_assert(priv::UsesNewDelete<int>::value, "the default policy uses new and delete");
+static_assert(!priv::UsesNewDelete<Pooled>::value, "a pool isn't new and delete");
+static_assert(!priv::UsesNewDelete<Custom>::value, "custom policies aren't new and delete");
+
+int main()
+{
+    std::vector<Aligned*> objects;
+    for (int i = 0; i < 100; ++i)
+    {
+        objects.push_back(ResourceAllocator<Aligned>::create());
+        SFTOOLS_CHECK(reinterpret_cast<std::uintptr_t>(objects.back()) % alignof(Aligned) == 0);
+    }
+
+    for (std::size_t i = 0; i < objects.size(); ++i)
+    {
+        ResourceAllocator<Aligned>::destroy(objects[i]);
+    }
+
+    return test::report();
+}
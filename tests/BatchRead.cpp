@@ -0,0 +1,226 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file tests/BatchRead.cpp
+ @brief Files read for a batch are released once their decoder is done,
+        lower tiers are not read ahead and images go through ImageCache
+ */
+
+#include "Test.hpp"
+
+#include <sftools/ResourceManager.hpp>
+
+#include <vector>
+
+using namespace sftools;
+
+namespace
+{
+    /*!
+     @brief Loader remembering the last instance created
+
+     The manager creates its loader once; the instance tells how many
+     files of its batches are still held.
+     */
+    template <typename Base>
+    struct Observed : Base
+    {
+        Observed()
+        {
+            last() = this;
+        }
+
+        Observed(Observed const& other)
+        : Base(other)
+        {
+            last() = this;
+        }
+
+        static Observed*& last()
+        {
+            static Observed* instance = 0;
+            return instance;
+        }
+    };
+
+    /*!
+     @brief Batch loader whose decoder ignores the file of "skipped"
+     */
+    struct SkippingLoader : loader::LoadFromBatch<test::Text>
+    {
+        test::Text* stage(std::string const& id)
+        {
+            return id == "skipped" ? 0 : loader::LoadFromBatch<test::Text>::stage(id);
+        }
+    };
+
+    /*!
+     @brief Batch loader supporting quality tiers, counting batch reads
+     */
+    struct TieredLoader : loader::LoadFromBatch<test::Text>
+    {
+        using loader::LoadFromBatch<test::Text>::stage;
+
+        test::Text* stage(std::string const& id, unsigned tier)
+        {
+            unsigned found = 0;
+            std::string const path = singleton::ResourceLocations::getInstance().resolve(id, tier, found);
+
+            test::Text* text = ResourceAllocator<test::Text>::create();
+            if (path.empty() || !text->loadFromFile(path))
+            {
+                ResourceAllocator<test::Text>::destroy(text);
+                return 0;
+            }
+
+            return text;
+        }
+
+        void readBatch(std::vector<priv::IoRequest> const& requests)
+        {
+            ++reads();
+            loader::LoadFromBatch<test::Text>::readBatch(requests);
+        }
+
+        static int& reads()
+        {
+            static int count = 0;
+            return count;
+        }
+    };
+
+    unsigned char const pixel[] = {
+        0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d, 0x49, 0x48, 0x44, 0x52,
+        0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x08, 0x06, 0x00, 0x00, 0x00, 0x1f, 0x15, 0xc4,
+        0x89, 0x00, 0x00, 0x00, 0x0d, 0x49, 0x44, 0x41, 0x54, 0x78, 0x9c, 0x63, 0xf8, 0xcf, 0xc0, 0xf0,
+        0x1f, 0x00, 0x05, 0x00, 0x01, 0xff, 0x89, 0x99, 0x3d, 0x1d, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45,
+        0x4e, 0x44, 0xae, 0x42, 0x60, 0x82
+    }; //!< A red PNG image of 1x1 pixel
+}
+
+typedef Observed<loader::LoadFromBatch<test::Text> > TextLoader;
+
+int main()
+{
+    std::string const directory = test::makeDirectory("batchread");
+    Locations& locations = singleton::ResourceLocations::getInstance();
+    locations.add(directory);
+
+    std::vector<std::string> ids;
+    for (char c = 'a'; c <= 'h'; ++c)
+    {
+        ids.push_back(std::string(1, c));
+        test::writeFile(directory + ids.back(), ids.back());
+        test::writeFile(directory + "low_" + ids.back(), "low " + ids.back());
+    }
+    test::writeFile(directory + "skipped", "skipped");
+
+    // Every file read is taken by its decoder
+    {
+        GenericManager<test::Text, std::string, TextLoader> manager;
+        LoadProgress const progress = manager.preload(ids.begin(), ids.end());
+        manager.wait();
+
+        SFTOOLS_CHECK(progress.getLoaded() == ids.size());
+        SFTOOLS_CHECK(manager["c"].content == "c");
+        SFTOOLS_CHECK(TextLoader::last()->getPendingFiles() == 0);
+    }
+
+    // Or dropped when the decoder didn't use it
+    {
+        typedef Observed<SkippingLoader> Loader;
+
+        GenericManager<test::Text, std::string, Loader> manager;
+        manager.setWorkerCount(1);
+
+        std::vector<std::string> batch(ids);
+        batch.push_back("skipped");
+
+        LoadProgress const progress = manager.preload(batch.begin(), batch.end());
+        manager.wait();
+
+        SFTOOLS_CHECK(progress.getLoaded() == ids.size());
+        SFTOOLS_CHECK(progress.getFailed() == 1);
+        SFTOOLS_CHECK(Loader::last()->getPendingFiles() == 0);
+    }
+
+    // Lower tiers load other files, which are not read ahead
+    {
+        typedef Observed<TieredLoader> Loader;
+
+        locations.setTierPrefix(1, "low_");
+        locations.setQuality(1);
+
+        GenericManager<test::Text, std::string, Loader> manager;
+        LoadProgress const progress = manager.preload(ids.begin(), ids.end());
+        manager.wait();
+
+        SFTOOLS_CHECK(progress.getLoaded() == ids.size());
+        SFTOOLS_CHECK(manager["c"].content == "low c");
+        SFTOOLS_CHECK(TieredLoader::reads() == 0);
+        SFTOOLS_CHECK(Loader::last()->getPendingFiles() == 0);
+
+        // The full quality still is
+        locations.setQuality(0);
+        manager.unloadAll();
+        manager.preload(ids.begin(), ids.end());
+        manager.wait();
+
+        SFTOOLS_CHECK(manager["c"].content == "c");
+        SFTOOLS_CHECK(TieredLoader::reads() == 1);
+        SFTOOLS_CHECK(Loader::last()->getPendingFiles() == 0);
+    }
+
+    // Images are looked up in the cache and saved to it
+    {
+        ImageCache& cache = singleton::ImageCache::getInstance();
+        cache.setDirectory(test::makeDirectory("batchread-cache"));
+        test::writeFile(directory + "pixel.png", std::string(pixel, pixel + sizeof(pixel)));
+        singleton::ResourceLocations::getInstance().refresh();
+
+        std::vector<std::string> const images(1, "pixel.png");
+
+        {
+            GenericManager<sf::Image, std::string, loader::ImageLoaderFromBatch> manager;
+            manager.preload(images.begin(), images.end());
+            manager.wait();
+            SFTOOLS_CHECK(manager.isReady("pixel.png"));
+        }
+        SFTOOLS_CHECK(cache.getMissCount() == 1);
+        SFTOOLS_CHECK(cache.getHitCount() == 0);
+
+        {
+            GenericManager<sf::Image, std::string, loader::ImageLoaderFromBatch> manager;
+            manager.preload(images.begin(), images.end());
+            manager.wait();
+            SFTOOLS_CHECK(manager.isReady("pixel.png"));
+        }
+        SFTOOLS_CHECK(cache.getHitCount() == 1);
+
+        cache.setDirectory("");
+    }
+
+    return test::report();
+}
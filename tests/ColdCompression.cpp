@@ -0,0 +1,212 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file tests/ColdCompression.cpp
+ @brief Idle resources are compressed within a time budget per call, those
+        that don't shrink are not tried again, and the memory saved is
+        reported with and without telemetry
+ */
+
+#include "Test.hpp"
+
+#include <sftools/ResourceManager.hpp>
+
+#include <chrono>
+#include <thread>
+
+using namespace sftools;
+
+namespace sftools
+{
+    template <>
+    struct ResourceSize<test::Text>
+    {
+        std::size_t operator()(test::Text const& text) const
+        {
+            return text.content.size();
+        }
+    };
+
+    /*!
+     @brief Run-length encoding of the texts, counting the compressions
+     */
+    template <>
+    struct ResourceCompressor<test::Text>
+    {
+        bool compress(test::Text const& text, std::vector<char>& out) const
+        {
+            ++compressions();
+            std::this_thread::sleep_for(std::chrono::milliseconds(delay()));
+
+            std::string const& content = text.content;
+            for (std::size_t i = 0; i < content.size(); )
+            {
+                std::size_t run = 1;
+                while (i + run < content.size() && content[i + run] == content[i] && run < 255)
+                {
+                    ++run;
+                }
+
+                out.push_back(static_cast<char>(run));
+                out.push_back(content[i]);
+                i += run;
+            }
+
+            return true;
+        }
+
+        test::Text* decompress(std::vector<char> const& data) const
+        {
+            test::Text* text = ResourceAllocator<test::Text>::create();
+            for (std::size_t i = 0; i + 1 < data.size(); i += 2)
+            {
+                text->content.append(static_cast<unsigned char>(data[i]), data[i + 1]);
+            }
+            return text;
+        }
+
+        static int& compressions()
+        {
+            static int count = 0;
+            return count;
+        }
+
+        static int& delay()
+        {
+            static int milliseconds = 0;
+            return milliseconds;
+        }
+    };
+}
+
+typedef GenericManager<test::Text, std::string, loader::LoadFromFile<test::Text> > TextManager;
+typedef ResourceCompressor<test::Text> Compressor;
+
+namespace
+{
+    void waitIdle()
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+}
+
+int main()
+{
+    std::string const directory = test::makeDirectory("coldcompression");
+    singleton::ResourceLocations::getInstance().add(directory);
+
+    std::string const repeated(1000, 'a');
+    char const* const compressible[] = { "a", "b", "c", "d" };
+    for (std::size_t i = 0; i < 4; ++i)
+    {
+        test::writeFile(directory + compressible[i], repeated);
+    }
+    test::writeFile(directory + "noise", "the quick brown fox jumps over the lazy dog");
+
+    // Idle resources are compressed and restored on their next use
+    {
+        TextManager manager;
+        manager.setColdCompression(sf::milliseconds(10), sf::Time::Zero);
+        SFTOOLS_CHECK(manager.load("a"));
+
+        SFTOOLS_CHECK(manager.compressIdle() == 0);
+        waitIdle();
+        SFTOOLS_CHECK(manager.compressIdle() == 1);
+        SFTOOLS_CHECK(!manager.isReady("a"));
+        SFTOOLS_CHECK(manager.getMemoryUsage() == 0);
+
+        // 4 runs of 2 bytes
+        SFTOOLS_CHECK(manager.getReclaimedBytes() == repeated.size() - 8);
+#ifndef SFTOOLS_NO_TELEMETRY
+        SFTOOLS_CHECK(manager.getStats().reclaimedBytes == manager.getReclaimedBytes());
+#endif
+
+        SFTOOLS_CHECK(manager["a"].content == repeated);
+        SFTOOLS_CHECK(manager.getReclaimedBytes() == 0);
+#ifndef SFTOOLS_NO_TELEMETRY
+        SFTOOLS_CHECK(manager.getStats().reclaimedBytes == 0);
+#endif
+    }
+
+    // Resources that don't shrink are tried once, even if evicted
+    {
+        TextManager manager;
+        manager.setColdCompression(sf::milliseconds(10), sf::Time::Zero);
+        SFTOOLS_CHECK(manager.load("noise"));
+
+        Compressor::compressions() = 0;
+        waitIdle();
+        SFTOOLS_CHECK(manager.compressIdle() == 0);
+        SFTOOLS_CHECK(manager.compressIdle() == 0);
+        manager.poll();
+        SFTOOLS_CHECK(Compressor::compressions() == 1);
+        SFTOOLS_CHECK(manager.isReady("noise"));
+
+        manager.setMemoryBudget(1000);
+        SFTOOLS_CHECK(manager.load("a"));
+        SFTOOLS_CHECK(!manager.isReady("noise"));
+        manager.setMemoryBudget(0);
+
+        SFTOOLS_CHECK(manager["noise"].content.size() == 43);
+        waitIdle();
+        SFTOOLS_CHECK(manager.compressIdle() == 1);
+        SFTOOLS_CHECK(Compressor::compressions() == 2);
+        SFTOOLS_CHECK(manager.isReady("noise"));
+    }
+
+    // The budget spreads the compressions over several calls
+    {
+        TextManager manager;
+        manager.setColdCompression(sf::milliseconds(10), sf::milliseconds(1));
+        for (std::size_t i = 0; i < 4; ++i)
+        {
+            SFTOOLS_CHECK(manager.load(compressible[i]));
+        }
+
+        Compressor::delay() = 2;
+        waitIdle();
+        for (std::size_t i = 0; i < 4; ++i)
+        {
+            SFTOOLS_CHECK(manager.compressIdle() == 1);
+        }
+        SFTOOLS_CHECK(manager.compressIdle() == 0);
+        SFTOOLS_CHECK(manager.getReclaimedBytes() == 4 * (repeated.size() - 8));
+
+        // Unless there is none
+        for (std::size_t i = 0; i < 4; ++i)
+        {
+            manager[compressible[i]];
+        }
+        manager.setColdCompression(sf::milliseconds(10), sf::Time::Zero);
+        waitIdle();
+        SFTOOLS_CHECK(manager.compressIdle() == 4);
+        Compressor::delay() = 0;
+
+        manager.unloadAll();
+        SFTOOLS_CHECK(manager.getReclaimedBytes() == 0);
+    }
+
+    return test::report();
+}
@@ -0,0 +1,143 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file tests/ConcurrentReads.cpp
+ @brief Readers never see a deleted resource while the manager loads,
+        reloads and unloads resources
+
+ Build it with `-fsanitize=address` or `-fsanitize=thread` for the test to
+ be meaningful.
+ */
+
+#include "Test.hpp"
+
+#include <sftools/ResourceManager.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace sftools;
+
+typedef GenericManager<test::Text, std::string, loader::LoadFromFile<test::Text> > TextManager;
+typedef GenericManager<test::Text, std::string, loader::LoadFromFile<test::Text>, storage::Hash> HashTextManager;
+
+namespace
+{
+    template <typename Manager>
+    void stress(std::vector<std::string> const& ids)
+    {
+        Manager manager;
+        manager.enableConcurrentReads();
+
+        std::atomic<bool> stop(false);
+        std::atomic<unsigned long> mismatches(0);
+
+        std::vector<std::thread> readers;
+        for (int r = 0; r < 4; ++r)
+        {
+            readers.push_back(std::thread([&]()
+            {
+                while (!stop)
+                {
+                    typename Manager::Reader reader(manager);
+                    for (std::size_t i = 0; i < ids.size(); ++i)
+                    {
+                        test::Text const* text = reader.find(ids[i]);
+                        if (text && text->content != ids[i])
+                        {
+                            ++mismatches;
+                        }
+                    }
+                }
+            }));
+        }
+
+        for (std::size_t k = 0; k < 2000; ++k)
+        {
+            manager.load(ids[k % ids.size()]);
+            manager.load(ids[(k * 3) % ids.size()], true); // Refused if resident
+            if (k % 3 == 0)
+            {
+                manager.unload(ids[(k * 5) % ids.size()]);
+            }
+            if (k % 50 == 0)
+            {
+                manager.unloadAll();
+            }
+
+            manager.poll();
+        }
+
+        stop = true;
+        for (std::size_t r = 0; r < readers.size(); ++r)
+        {
+            readers[r].join();
+        }
+
+        SFTOOLS_CHECK(mismatches == 0);
+    }
+}
+
+int main()
+{
+    std::string const directory = test::makeDirectory("concurrent");
+    singleton::ResourceLocations::getInstance().add(directory);
+
+    std::vector<std::string> ids;
+    for (char c = 'a'; c <= 'h'; ++c)
+    {
+        ids.push_back(std::string(1, c));
+        test::writeFile(directory + ids.back(), ids.back());
+    }
+
+    stress<TextManager>(ids);
+    stress<HashTextManager>(ids);
+
+    // Loads are published by the next poll, all at once
+    {
+        TextManager manager;
+        manager.enableConcurrentReads();
+
+        SFTOOLS_CHECK(manager.load("a") && manager.load("b"));
+        SFTOOLS_CHECK(TextManager::Reader(manager).find("a") == 0);
+
+        manager.poll();
+        TextManager::Reader reader(manager);
+        SFTOOLS_CHECK(reader.find("a") == &manager["a"]);
+        SFTOOLS_CHECK(reader.find("b") == &manager["b"]);
+        SFTOOLS_CHECK(reader.find("c") == 0);
+    }
+
+    // Without concurrent reads, Readers see nothing
+    {
+        TextManager manager;
+        SFTOOLS_CHECK(manager.load("a"));
+        manager.poll();
+        SFTOOLS_CHECK(TextManager::Reader(manager).find("a") == 0);
+    }
+
+    return test::report();
+}
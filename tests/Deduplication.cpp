@@ -0,0 +1,76 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file tests/Deduplication.cpp
+ @brief Only files with identical bytes share a resource, whatever their
+        hashes
+ */
+
+#include "Test.hpp"
+
+#include <sftools/ResourceManager.hpp>
+
+using namespace sftools;
+
+typedef GenericManager<test::Text, std::string, loader::LoadFromFile<test::Text> > TextManager;
+
+int main()
+{
+    std::string const directory = test::makeDirectory("dedup");
+    singleton::ResourceLocations::getInstance().add(directory);
+
+    test::writeFile(directory + "a", "same");
+    test::writeFile(directory + "b", "same");
+    test::writeFile(directory + "c", "same");
+    test::writeFile(directory + "d", "different");
+
+    TextManager manager;
+    manager.enableDeduplication();
+
+    SFTOOLS_CHECK(manager.load("a") && manager.load("b") && manager.load("d"));
+    SFTOOLS_CHECK(&manager["a"] == &manager["b"]);
+    SFTOOLS_CHECK(&manager["a"] != &manager["d"]);
+
+    // The file "a" was loaded from doesn't match anymore, although the hash
+    // of "c" is the one recorded : the bytes decide
+    test::writeFile(directory + "a", "SAME");
+    SFTOOLS_CHECK(manager.load("c"));
+    SFTOOLS_CHECK(&manager["c"] != &manager["a"]);
+    SFTOOLS_CHECK(manager["c"].content == "same");
+
+    // Same through the asynchronous path
+    manager.unload("c");
+    manager.loadAsync("c");
+    manager.wait();
+    SFTOOLS_CHECK(manager.isReady("c"));
+    SFTOOLS_CHECK(&manager["c"] != &manager["a"]);
+
+    // Unloading every id sharing the resource still works
+    manager.unload("a");
+    manager.unload("b");
+    SFTOOLS_CHECK(manager["c"].content == "same");
+
+    return test::report();
+}
@@ -0,0 +1,114 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file tests/Groups.cpp
+ @brief Releasing a group unloads its resources, including those still
+        being prefetched, but not the pinned or shared ones
+ */
+
+#include "Test.hpp"
+
+#include <sftools/ResourceManager.hpp>
+
+#include <vector>
+
+using namespace sftools;
+
+typedef GenericManager<test::Text, std::string, loader::LoadFromFile<test::Text> > TextManager;
+
+int main()
+{
+    std::string const directory = test::makeDirectory("groups");
+    singleton::ResourceLocations::getInstance().add(directory);
+
+    std::vector<std::string> ids;
+    for (char c = 'a'; c <= 'h'; ++c)
+    {
+        ids.push_back(std::string(1, c));
+        test::writeFile(directory + ids.back(), ids.back());
+    }
+
+    // Prefetches are cancelled
+    {
+        TextManager manager;
+        manager.setNegativeCacheDuration(sf::seconds(60));
+        manager.addToGroup("level", ids.begin(), ids.end());
+
+        LoadProgress const progress = manager.prefetchGroup("level");
+        manager.releaseGroup("level");
+        manager.wait();
+
+        SFTOOLS_CHECK(progress.isDone());
+        SFTOOLS_CHECK(progress.getLoaded() == 0);
+        for (std::size_t i = 0; i < ids.size(); ++i)
+        {
+            SFTOOLS_CHECK(!manager.isReady(ids[i]));
+        }
+
+        // Cancelled isn't missing
+        SFTOOLS_CHECK(manager.load("a"));
+    }
+
+    // Unless they are requested again
+    {
+        TextManager manager;
+        manager.addToGroup("level", ids.begin(), ids.end());
+
+        manager.prefetchGroup("level");
+        manager.releaseGroup("level");
+        LoadHandle const handle = manager.loadAsync("b");
+        manager.wait();
+
+        SFTOOLS_CHECK(handle.isLoaded());
+        SFTOOLS_CHECK(manager.isReady("b"));
+        SFTOOLS_CHECK(!manager.isReady("c"));
+    }
+
+    // Pinned and shared resources stay
+    {
+        TextManager manager;
+        manager.addToGroup("level1", ids.begin(), ids.begin() + 4);
+        manager.addToGroup("level2", ids.begin() + 3, ids.end());
+
+        manager.prefetchGroup("level1");
+        manager.prefetchGroup("level2");
+        manager.wait();
+
+        manager.pin("a");
+        manager.releaseGroup("level1");
+
+        SFTOOLS_CHECK(manager.isReady("a"));
+        SFTOOLS_CHECK(!manager.isReady("b"));
+        SFTOOLS_CHECK(!manager.isReady("c"));
+        SFTOOLS_CHECK(manager.isReady("d"));
+
+        manager.releaseGroup("level2");
+        SFTOOLS_CHECK(manager.isReady("a"));
+        SFTOOLS_CHECK(!manager.isReady("d"));
+        SFTOOLS_CHECK(!manager.isReady("h"));
+    }
+
+    return test::report();
+}
@@ -0,0 +1,133 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file tests/Handles.cpp
+ @brief Handles survive evictions but are rejected once their resource is
+        unloaded, even after their slot is reused
+ */
+
+#include "Test.hpp"
+
+#include <sftools/ResourceManager.hpp>
+
+using namespace sftools;
+
+namespace
+{
+    enum Sprite { Hero, Enemy, Tree, Rock };
+
+    int loads = 0; //!< Calls to SpriteLoader
+
+    /*!
+     @brief Load the name of a sprite; Rock is missing
+     */
+    struct SpriteLoader
+    {
+        test::Text* operator()(Sprite sprite)
+        {
+            static char const* const names[] = { "hero", "enemy", "tree" };
+
+            ++loads;
+            if (sprite == Rock)
+            {
+                return 0;
+            }
+
+            test::Text* text = ResourceAllocator<test::Text>::create();
+            text->content = names[sprite];
+            return text;
+        }
+    };
+}
+
+namespace sftools
+{
+    template <>
+    struct ResourceSize<test::Text>
+    {
+        std::size_t operator()(test::Text const&) const
+        {
+            return 100;
+        }
+    };
+}
+
+typedef GenericManager<test::Text, Sprite, SpriteLoader, storage::Dense> SpriteManager;
+
+int main()
+{
+    SpriteManager manager;
+    SFTOOLS_CHECK(manager.load(Hero) && manager.load(Enemy) && manager.load(Tree));
+    SFTOOLS_CHECK(!manager.load(Rock));
+    SFTOOLS_CHECK_THROWS(manager.getHandle(Rock), std::invalid_argument);
+
+    Handle<test::Text> const none;
+    SFTOOLS_CHECK(none.isNull() && !manager.isValid(none));
+
+    Handle<test::Text> const enemy = manager.getHandle(Enemy);
+    SFTOOLS_CHECK(manager.isValid(enemy));
+    SFTOOLS_CHECK(manager.getHandle(Enemy) == enemy);
+    SFTOOLS_CHECK(&manager[enemy] == &manager[Enemy]);
+
+    // Evicted resources are reloaded through their handles
+    manager.setMemoryBudget(150);
+    manager[Hero];
+    manager[Tree];
+    int const before = loads;
+    SFTOOLS_CHECK(manager.isValid(enemy));
+    SFTOOLS_CHECK(manager[enemy].content == "enemy");
+    SFTOOLS_CHECK(loads == before + 1);
+    manager.setMemoryBudget(0);
+
+    // The slot of the unloaded resource is given to the next handle
+    manager.unload(Enemy);
+    SFTOOLS_CHECK(!manager.isValid(enemy));
+    SFTOOLS_CHECK_THROWS(manager[enemy], std::invalid_argument);
+
+    Handle<test::Text> const tree = manager.getHandle(Tree);
+    SFTOOLS_CHECK(tree != enemy);
+    SFTOOLS_CHECK(!manager.isValid(enemy));
+    SFTOOLS_CHECK_THROWS(manager[enemy], std::invalid_argument);
+    SFTOOLS_CHECK(manager[tree].content == "tree");
+
+    // Loading the resource again doesn't revive its old handles
+    SFTOOLS_CHECK(manager.load(Enemy));
+    Handle<test::Text> const again = manager.getHandle(Enemy);
+    SFTOOLS_CHECK(again != enemy);
+    SFTOOLS_CHECK(!manager.isValid(enemy));
+    SFTOOLS_CHECK(manager[again].content == "enemy");
+
+    // Nor does unloadAll()
+    manager.unloadAll();
+    SFTOOLS_CHECK(!manager.isValid(tree) && !manager.isValid(again));
+    SFTOOLS_CHECK(manager.load(Hero) && manager.load(Tree));
+    Handle<test::Text> const hero = manager.getHandle(Hero);
+    Handle<test::Text> const newTree = manager.getHandle(Tree);
+    SFTOOLS_CHECK(manager.isValid(hero) && manager.isValid(newTree));
+    SFTOOLS_CHECK(!manager.isValid(tree) && !manager.isValid(again) && !manager.isValid(enemy));
+    SFTOOLS_CHECK_THROWS(manager[tree], std::invalid_argument);
+
+    return test::report();
+}
@@ -0,0 +1,125 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file tests/ImageCache.cpp
+ @brief Cache files are stale as soon as their source changes, even within
+        the same second
+ */
+
+#include "Test.hpp"
+
+#include <sftools/ResourceManager/ImageCache.hpp>
+
+#include <cstdio>
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <sys/stat.h>
+#endif
+
+using namespace sftools;
+
+namespace
+{
+    /*!
+     @brief Give a file the modification time of another one, to mimic
+            rewrites faster than the resolution of the file system
+     */
+    void copyTime(std::string const& from, std::string const& to)
+    {
+#ifndef _WIN32
+        struct stat info;
+        stat(from.c_str(), &info);
+    #ifdef __APPLE__
+        timespec const times[2] = { info.st_atimespec, info.st_mtimespec };
+    #else
+        timespec const times[2] = { info.st_atim, info.st_mtim };
+    #endif
+        utimensat(AT_FDCWD, to.c_str(), times, 0);
+#endif
+    }
+
+    sf::Image makeImage(sf::Uint8 red)
+    {
+        sf::Image image;
+        image.create(2, 2, sf::Color(red, 0, 0));
+        return image;
+    }
+}
+
+int main()
+{
+    std::string const directory = test::makeDirectory("imagecache");
+    std::string const source = directory + "image.png";
+    std::string const replacement = directory + "replacement.png";
+
+    ImageCache cache;
+    cache.setDirectory(directory);
+
+    test::writeFile(source, "AAAA");
+    SFTOOLS_CHECK(cache.store(source, makeImage(1), sf::milliseconds(1)));
+
+    sf::Image image;
+    SFTOOLS_CHECK(cache.load(source, image));
+    SFTOOLS_CHECK(image.getPixelsPtr()[0] == 1);
+
+#ifndef _WIN32
+    // Same size, same second, different nanoseconds
+    {
+        struct stat info;
+        stat(source.c_str(), &info);
+        timespec times[2];
+        times[0].tv_sec = times[1].tv_sec = info.st_mtime;
+        times[0].tv_nsec = 1;
+        times[1].tv_nsec = 2;
+        utimensat(AT_FDCWD, source.c_str(), times, 0);
+        SFTOOLS_CHECK(cache.store(source, makeImage(1), sf::milliseconds(1)));
+        SFTOOLS_CHECK(cache.load(source, image));
+
+        test::writeFile(source, "BBBB");
+        times[1].tv_nsec = 3;
+        utimensat(AT_FDCWD, source.c_str(), times, 0);
+        SFTOOLS_CHECK(!cache.load(source, image));
+    }
+
+    // Replaced by another file with the same size and time
+    {
+        SFTOOLS_CHECK(cache.store(source, makeImage(2), sf::milliseconds(1)));
+        SFTOOLS_CHECK(cache.load(source, image));
+
+        test::writeFile(replacement, "CCCC");
+        copyTime(source, replacement);
+        std::rename(replacement.c_str(), source.c_str());
+        SFTOOLS_CHECK(!cache.load(source, image));
+    }
+#endif
+
+    // Updated cache
+    SFTOOLS_CHECK(cache.store(source, makeImage(3), sf::milliseconds(1)));
+    SFTOOLS_CHECK(cache.load(source, image));
+    SFTOOLS_CHECK(image.getPixelsPtr()[0] == 3);
+
+    return test::report();
+}
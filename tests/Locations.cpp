@@ -0,0 +1,72 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file tests/Locations.cpp
+ @brief Resolutions, failed or not, are answered from the index until the
+        locations are refreshed
+ */
+
+#include "Test.hpp"
+
+#include <sftools/ResourceManager/Locations.hpp>
+
+using namespace sftools;
+
+int main()
+{
+    std::string const directory = test::makeDirectory("locations");
+    test::writeFile(directory + "a", "a");
+
+    Locations locations;
+    locations.add(directory + "missing/");
+    locations.add(directory);
+
+    SFTOOLS_CHECK(locations.resolve("a") == directory + "a");
+    SFTOOLS_CHECK(locations.resolve("b").empty());
+
+    // Both locations were checked last time
+    unsigned long const avoided = locations.getAvoidedProbes();
+    SFTOOLS_CHECK(locations.resolve("b").empty());
+    SFTOOLS_CHECK(locations.getAvoidedProbes() == avoided + 2);
+
+    // The listing is trusted until it is refreshed
+    test::writeFile(directory + "b", "b");
+    SFTOOLS_CHECK(locations.resolve("b").empty());
+    locations.refresh(directory.substr(0, directory.size() - 1));
+    SFTOOLS_CHECK(locations.resolve("b") == directory + "b");
+
+    // Iterating the locations
+    std::size_t count = 0;
+    for (Locations::ConstIterator it = locations.begin(); it != locations.end(); ++it)
+    {
+        ++count;
+    }
+    SFTOOLS_CHECK(count == 2);
+
+    locations.remove(directory);
+    SFTOOLS_CHECK(locations.resolve("a").empty());
+
+    return test::report();
+}
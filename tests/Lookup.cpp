@@ -0,0 +1,177 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file tests/Lookup.cpp
+ @brief Fetching loaded resources with `char const*` and `std::string_view`
+        keys doesn't allocate memory, and const lookups don't change the
+        manager
+
+ The global operator new is replaced to count the allocations.
+ */
+
+#include "Test.hpp"
+
+#include <sftools/ResourceManager.hpp>
+
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#if __cplusplus >= 201703L
+    #include <string_view>
+#endif
+
+namespace
+{
+    std::size_t allocations = 0; //!< Calls to operator new so far
+}
+
+// Once inlined, std::free() would sit next to calls of operator new and
+// GCC would warn about a mismatch
+#if defined(__GNUC__)
+    #define NOINLINE __attribute__((noinline))
+#elif defined(_MSC_VER)
+    #define NOINLINE __declspec(noinline)
+#else
+    #define NOINLINE
+#endif
+
+void* operator new(std::size_t size)
+{
+    ++allocations;
+
+    void* memory = std::malloc(size == 0 ? 1 : size);
+    if (!memory)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+NOINLINE void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+NOINLINE void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+// The array forms go through std::malloc() and std::free() too
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+NOINLINE void operator delete[](void* memory) noexcept
+{
+    std::free(memory);
+}
+
+NOINLINE void operator delete[](void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+using namespace sftools;
+
+namespace
+{
+    template <typename Manager>
+    void check(std::string const& name)
+    {
+        Manager manager;
+        SFTOOLS_CHECK(manager.load("characters_hero_idle.png"));
+        SFTOOLS_CHECK(manager.load("environment_tiles_grass.png"));
+
+        // Warm up : the first lookups may fill lazily created structures
+        char const* const key = "characters_hero_idle.png";
+        manager[key];
+        manager["environment_tiles_grass.png"];
+
+        std::size_t const before = allocations;
+
+        std::size_t total = 0;
+        for (int i = 0; i < 1000; ++i)
+        {
+            total += manager[key].content.size();
+            total += manager["environment_tiles_grass.png"].content.size();
+#if __cplusplus >= 201703L
+            std::string_view const view("characters_hero_idle.png");
+            total += manager[view].content.size();
+#endif
+        }
+
+        if (allocations != before)
+        {
+            std::fprintf(stderr, "%s: %lu allocations\n", name.c_str(),
+                         static_cast<unsigned long>(allocations - before));
+        }
+        SFTOOLS_CHECK(allocations == before);
+        SFTOOLS_CHECK(total != 0);
+    }
+}
+
+int main()
+{
+    std::string const directory = test::makeDirectory("lookup");
+    singleton::ResourceLocations::getInstance().add(directory);
+
+    // Longer than the small string buffer : a temporary std::string would
+    // allocate
+    test::writeFile(directory + "characters_hero_idle.png", "hero");
+    test::writeFile(directory + "environment_tiles_grass.png", "tiles");
+
+    check<GenericManager<test::Text, std::string, loader::LoadFromFile<test::Text> > >("Map");
+    check<GenericManager<test::Text, std::string, loader::LoadFromFile<test::Text>, storage::Hash> >("Hash");
+
+    // Const lookups leave the manager as it is
+    {
+        typedef GenericManager<test::Text, std::string, loader::LoadFromFile<test::Text> > Manager;
+        Manager manager;
+        Manager const& constant = manager;
+
+        SFTOOLS_CHECK_THROWS(constant["characters_hero_idle.png"], std::invalid_argument);
+        SFTOOLS_CHECK(!manager.isReady("characters_hero_idle.png"));
+
+        SFTOOLS_CHECK(manager.load("characters_hero_idle.png"));
+        Handle<test::Text> const handle = manager.getHandle("characters_hero_idle.png");
+        ManagerStats const before = manager.getStats();
+        SFTOOLS_CHECK(constant[std::string("characters_hero_idle.png")].content == "hero");
+        SFTOOLS_CHECK(constant["characters_hero_idle.png"].content == "hero");
+        SFTOOLS_CHECK(constant[handle].content == "hero");
+        SFTOOLS_CHECK(manager.getStats().lookups == before.lookups);
+
+        // The placeholder doesn't start a load either
+        manager.enablePlaceholders();
+        SFTOOLS_CHECK(constant["environment_tiles_grass.png"].content.empty());
+        manager.wait();
+        manager.poll();
+        SFTOOLS_CHECK(!manager.isReady("environment_tiles_grass.png"));
+    }
+
+    return test::report();
+}
@@ -0,0 +1,170 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file tests/Manifest.cpp
+ @brief Manifests record the order and time of the first accesses, and
+        replay them in order
+ */
+
+#include "Test.hpp"
+
+#include <sftools/ResourceManager.hpp>
+
+#include <chrono>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace sftools;
+
+namespace
+{
+    std::mutex mutex; //!< Protects order
+    std::vector<int> order; //!< Ids in the order they were loaded
+
+    /*!
+     @brief Load the text of a number, remembering the order of the loads
+     */
+    struct NumberLoader
+    {
+        test::Text* operator()(int id)
+        {
+            if (id < 0)
+            {
+                return 0;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            order.push_back(id);
+
+            test::Text* text = ResourceAllocator<test::Text>::create();
+            text->content = std::to_string(id);
+            return text;
+        }
+    };
+
+    std::string readFile(std::string const& path)
+    {
+        test::Text text;
+        text.loadFromFile(path);
+        return text.content;
+    }
+}
+
+typedef GenericManager<test::Text, int, NumberLoader> NumberManager;
+
+int main()
+{
+    std::string const directory = test::makeDirectory("manifest");
+    std::string const path = directory + "session";
+
+    // Record the first accesses only
+    {
+        NumberManager manager;
+        manager.load(1);
+
+        manager.startRecording();
+        manager.load(30);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        manager[1];
+        manager.load(4);
+        manager.load(30);
+        manager.load(-1);
+        manager.preload(std::vector<int>(1, 5));
+        manager.wait();
+        manager.stopRecording();
+        manager.load(6);
+
+        SFTOOLS_CHECK(manager.saveManifest(path));
+    }
+
+    // Each id comes with the time of its first access
+    {
+        std::istringstream lines(readFile(path));
+        std::string header;
+        std::getline(lines, header);
+        SFTOOLS_CHECK(header == "sftools-manifest 1");
+
+        long long time = 0, previous = 0;
+        int id = 0;
+        std::vector<int> ids;
+        std::vector<long long> times;
+        while (lines >> time >> id)
+        {
+            SFTOOLS_CHECK(time >= previous);
+            previous = time;
+            ids.push_back(id);
+            times.push_back(time);
+        }
+
+        int const expected[] = { 30, 1, 4, -1 };
+        SFTOOLS_CHECK(ids == std::vector<int>(expected, expected + 4));
+        SFTOOLS_CHECK(times.size() == 4 && times[1] - times[0] >= 20);
+    }
+
+    // Replay them in the same order
+    {
+        order.clear();
+
+        NumberManager manager;
+        manager.setWorkerCount(1);
+
+        LoadProgress const progress = manager.replayManifest(path);
+        manager.wait();
+
+        SFTOOLS_CHECK(progress.getTotal() == 4);
+        SFTOOLS_CHECK(progress.getLoaded() == 3);
+        SFTOOLS_CHECK(progress.getFailed() == 1);
+        SFTOOLS_CHECK(manager.isReady(30) && manager.isReady(1) && manager.isReady(4));
+        SFTOOLS_CHECK(manager[30].content == "30");
+
+        int const expected[] = { 30, 1, 4 };
+        SFTOOLS_CHECK(order == std::vector<int>(expected, expected + 3));
+    }
+
+    // Invalid lines are skipped
+    {
+        test::writeFile(path, "sftools-manifest 1\n0 7\n12 2\nbroken\n40 x\n");
+
+        NumberManager manager;
+        LoadProgress const progress = manager.replayManifest(path);
+        manager.wait();
+
+        SFTOOLS_CHECK(progress.getTotal() == 2);
+        SFTOOLS_CHECK(manager.isReady(7) && manager.isReady(2));
+    }
+
+    // Other files are empty batches
+    {
+        test::writeFile(path, "7\n2\n");
+
+        NumberManager manager;
+        SFTOOLS_CHECK(manager.replayManifest(path).getTotal() == 0);
+        SFTOOLS_CHECK(manager.replayManifest(directory + "missing").getTotal() == 0);
+    }
+
+    return test::report();
+}
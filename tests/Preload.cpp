@@ -0,0 +1,73 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file tests/Preload.cpp
+ @brief Batches are loaded whatever the number of workers
+ */
+
+#include "Test.hpp"
+
+#include <sftools/ResourceManager.hpp>
+
+#include <vector>
+
+using namespace sftools;
+
+typedef GenericManager<test::Text, std::string, loader::LoadFromFile<test::Text> > TextManager;
+
+int main()
+{
+    std::string const directory = test::makeDirectory("preload");
+    singleton::ResourceLocations::getInstance().add(directory);
+
+    std::vector<std::string> ids;
+    for (char c = 'a'; c <= 'z'; ++c)
+    {
+        ids.push_back(std::string(1, c));
+        test::writeFile(directory + ids.back(), ids.back());
+    }
+
+    TextManager manager;
+    manager.setWorkerCount(3);
+
+    LoadProgress const first = manager.preload(ids.begin(), ids.begin() + 13, 1);
+
+    // Changing the count completes the loads in flight
+    manager.setWorkerCount(1);
+    SFTOOLS_CHECK(first.getLoaded() == 13);
+    SFTOOLS_CHECK(manager.isReady("a"));
+
+    LoadProgress const second = manager.preload(ids.begin(), ids.end());
+    manager.wait();
+
+    SFTOOLS_CHECK(second.getTotal() == ids.size());
+    SFTOOLS_CHECK(second.getLoaded() == ids.size());
+    for (std::size_t i = 0; i < ids.size(); ++i)
+    {
+        SFTOOLS_CHECK(manager[ids[i]].content == ids[i]);
+    }
+
+    return test::report();
+}
@@ -0,0 +1,172 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file tests/Refs.cpp
+ @brief Resources used by Refs stay loaded when their group is released,
+        when the user unpins them or when they are unloaded, until their
+        last Ref is dropped
+ */
+
+#include "Test.hpp"
+
+#include <sftools/ResourceManager.hpp>
+
+using namespace sftools;
+
+namespace sftools
+{
+    template <>
+    struct ResourceSize<test::Text>
+    {
+        std::size_t operator()(test::Text const&) const
+        {
+            return 100;
+        }
+    };
+}
+
+typedef GenericManager<test::Text, std::string, loader::LoadFromFile<test::Text> > TextManager;
+
+int main()
+{
+    std::string const directory = test::makeDirectory("refs");
+    singleton::ResourceLocations::getInstance().add(directory);
+
+    char const* const ids[] = { "a", "b", "c", "d" };
+    for (std::size_t i = 0; i < 4; ++i)
+    {
+        test::writeFile(directory + ids[i], ids[i]);
+    }
+
+    // Releasing the group is deferred to applyReleases()
+    {
+        TextManager manager;
+        manager.addToGroup("level", "a");
+        manager.addToGroup("level", "b");
+        manager.prefetchGroup("level");
+        manager.wait();
+        manager.poll();
+
+        Ref<test::Text> a = manager.acquire("a");
+        manager.releaseGroup("level");
+        SFTOOLS_CHECK(!manager.isReady("b"));
+        SFTOOLS_CHECK(manager.isReady("a"));
+        SFTOOLS_CHECK(a->content == "a");
+
+        manager.setMemoryBudget(150);
+        manager.load("c");
+        manager.load("d");
+        SFTOOLS_CHECK(manager.isReady("a"));
+        SFTOOLS_CHECK(a->content == "a");
+
+        a.reset();
+        SFTOOLS_CHECK(manager.applyReleases() == 1);
+        SFTOOLS_CHECK(!manager.isReady("a"));
+    }
+
+    // Unpinning leaves the resource to its Refs
+    {
+        TextManager manager;
+        manager.setMemoryBudget(150);
+        manager.load("a");
+        manager.pin("a");
+
+        Ref<test::Text> a = manager.acquire("a");
+        manager.unpin("a");
+        manager.load("b");
+        manager.load("c");
+        SFTOOLS_CHECK(manager.isReady("a"));
+        SFTOOLS_CHECK(a->content == "a");
+
+        // Nor does unpinning twice release it
+        manager.unpin("a");
+        manager.load("d");
+        SFTOOLS_CHECK(a->content == "a");
+
+        a.reset();
+        SFTOOLS_CHECK(manager.applyReleases() == 1);
+        SFTOOLS_CHECK(!manager.isReady("a"));
+    }
+
+    // Pinning while Refs exist keeps the resource after them
+    {
+        TextManager manager;
+        manager.addToGroup("level", "a");
+
+        Ref<test::Text> a = manager.acquire("a");
+        manager.pin("a");
+        a.reset();
+        SFTOOLS_CHECK(manager.applyReleases() == 0);
+
+        manager.setMemoryBudget(150);
+        manager.load("b");
+        manager.load("c");
+        SFTOOLS_CHECK(manager.isReady("a"));
+
+        // Back to a plain member of its group
+        manager.unpin("a");
+        manager.load("d");
+        SFTOOLS_CHECK(!manager.isReady("a"));
+    }
+
+    // Unloading waits for the last Ref
+    {
+        TextManager manager;
+        manager.load("a");
+        manager.pin("a");
+
+        Ref<test::Text> a = manager.acquire("a");
+        Ref<test::Text> b = manager.acquire("b");
+        manager.unload("a");
+        SFTOOLS_CHECK(a->content == "a");
+
+        manager.unloadAll();
+        SFTOOLS_CHECK(a->content == "a");
+        SFTOOLS_CHECK(b->content == "b");
+
+        // Even the user pin is gone
+        a.reset();
+        SFTOOLS_CHECK(manager.applyReleases() == 1);
+        SFTOOLS_CHECK(!manager.isReady("a"));
+        SFTOOLS_CHECK(b->content == "b");
+
+        // Pinning again cancels the unload
+        manager.pin("b");
+        b.reset();
+        SFTOOLS_CHECK(manager.applyReleases() == 0);
+        SFTOOLS_CHECK(manager.isReady("b"));
+
+        // So does loading again, leaving the resource to its group
+        manager.addToGroup("level", "c");
+        Ref<test::Text> c = manager.acquire("c");
+        manager.unload("c");
+        manager.load("c");
+        c.reset();
+        SFTOOLS_CHECK(manager.applyReleases() == 0);
+        SFTOOLS_CHECK(manager.isReady("c"));
+    }
+
+    return test::report();
+}
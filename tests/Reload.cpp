@@ -0,0 +1,142 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file tests/Reload.cpp
+ @brief Reloading resources keeps the references handed out before valid
+ */
+
+#include "Test.hpp"
+
+#include <sftools/ResourceManager.hpp>
+
+#include <chrono>
+#include <thread>
+
+using namespace sftools;
+
+typedef GenericManager<test::Text, std::string, loader::LoadFromFile<test::Text> > TextManager;
+
+int main()
+{
+    std::string const directory = test::makeDirectory("reload");
+    singleton::ResourceLocations::getInstance().add(directory);
+
+    test::writeFile(directory + "plain", "1");
+    test::writeFile(directory + "a", "same");
+    test::writeFile(directory + "b", "same");
+    test::writeFile(directory + "c", "alone");
+
+    // Plain mode : in place
+    {
+        TextManager manager;
+        SFTOOLS_CHECK(manager.load("plain"));
+        test::Text& text = manager["plain"];
+
+        test::writeFile(directory + "plain", "2");
+        SFTOOLS_CHECK(manager.load("plain", true));
+        SFTOOLS_CHECK(&manager["plain"] == &text);
+        SFTOOLS_CHECK(text.content == "2");
+    }
+
+    // Deduplication : shared resources are never deleted under the user
+    {
+        TextManager manager;
+        manager.enableDeduplication();
+
+        SFTOOLS_CHECK(manager.load("a") && manager.load("b") && manager.load("c"));
+        test::Text& a = manager["a"];
+        test::Text& c = manager["c"];
+        SFTOOLS_CHECK(&manager["b"] == &a);
+
+        // Still shared with "b" : "a" gets its own copy, the shared one stays
+        test::writeFile(directory + "a", "new a");
+        SFTOOLS_CHECK(manager.load("a", true));
+        SFTOOLS_CHECK(manager["a"].content == "new a");
+        SFTOOLS_CHECK(&manager["b"] == &a);
+        SFTOOLS_CHECK(a.content == "same");
+
+        // Only "b" uses it now : in place
+        test::writeFile(directory + "b", "new b");
+        SFTOOLS_CHECK(manager.load("b", true));
+        SFTOOLS_CHECK(&manager["b"] == &a);
+        SFTOOLS_CHECK(a.content == "new b");
+
+        // Not shared at all : in place
+        test::writeFile(directory + "c", "new c");
+        SFTOOLS_CHECK(manager.load("c", true));
+        SFTOOLS_CHECK(&manager["c"] == &c);
+        SFTOOLS_CHECK(c.content == "new c");
+
+        // A reloaded resource is not shared with its old content anymore
+        test::writeFile(directory + "d", "new b");
+        singleton::ResourceLocations::getInstance().refresh();
+        SFTOOLS_CHECK(manager.load("d"));
+        SFTOOLS_CHECK(&manager["d"] != &a);
+    }
+
+    // Concurrent reads : resources are not replaced under the user
+    {
+        test::writeFile(directory + "plain", "3");
+
+        TextManager manager;
+        manager.enableConcurrentReads();
+        SFTOOLS_CHECK(!manager.enableHotReload());
+
+        SFTOOLS_CHECK(manager.load("plain"));
+        test::Text& text = manager["plain"];
+
+        test::writeFile(directory + "plain", "4");
+        SFTOOLS_CHECK(!manager.load("plain", true));
+        manager.poll();
+        SFTOOLS_CHECK(&manager["plain"] == &text);
+        SFTOOLS_CHECK(text.content == "3");
+    }
+
+    // Hot reloading stops watching unloaded resources
+    {
+        TextManager manager;
+        if (manager.enableHotReload())
+        {
+            SFTOOLS_CHECK(manager.load("plain"));
+            test::Text& text = manager["plain"];
+
+            test::writeFile(directory + "plain", "5");
+            for (int i = 0; i < 50 && manager.applyReloads() == 0; ++i)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            }
+            SFTOOLS_CHECK(&manager["plain"] == &text);
+            SFTOOLS_CHECK(text.content == "5");
+
+            manager.unload("plain");
+
+            test::writeFile(directory + "plain", "6");
+            std::this_thread::sleep_for(std::chrono::milliseconds(300));
+            SFTOOLS_CHECK(manager.applyReloads() == 0);
+        }
+    }
+
+    return test::report();
+}
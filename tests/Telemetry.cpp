@@ -0,0 +1,90 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file tests/Telemetry.cpp
+ @brief Lookups, loads and reloads are each counted once
+ */
+
+#include "Test.hpp"
+
+#include <sftools/ResourceManager.hpp>
+
+#include <chrono>
+#include <thread>
+
+using namespace sftools;
+
+typedef GenericManager<test::Text, std::string, loader::LoadFromFile<test::Text> > TextManager;
+
+int main()
+{
+#ifndef SFTOOLS_NO_TELEMETRY
+    std::string const directory = test::makeDirectory("telemetry");
+    singleton::ResourceLocations::getInstance().add(directory);
+
+    test::writeFile(directory + "a", "a");
+    test::writeFile(directory + "b", "b");
+
+    TextManager manager;
+    SFTOOLS_CHECK(manager.load("a"));
+    SFTOOLS_CHECK(!manager.load("missing"));
+
+    manager["a"];
+    manager["a"];
+    SFTOOLS_CHECK_THROWS(manager["b"], std::invalid_argument);
+
+    ManagerStats stats = manager.getStats();
+    SFTOOLS_CHECK(stats.lookups == 3);
+    SFTOOLS_CHECK(stats.hits == 2);
+    SFTOOLS_CHECK(stats.misses == 1);
+    SFTOOLS_CHECK(stats.loads == 2);
+    SFTOOLS_CHECK(stats.failedLoads == 1);
+    SFTOOLS_CHECK(stats.loadTime.count == 2);
+
+    // Reloads are not loads
+    test::writeFile(directory + "a", "A");
+    SFTOOLS_CHECK(manager.load("a", true));
+    stats = manager.getStats();
+    SFTOOLS_CHECK(stats.loads == 2);
+    SFTOOLS_CHECK(stats.reloads == 1);
+    SFTOOLS_CHECK(stats.loadTime.count == 2);
+
+    if (manager.enableHotReload())
+    {
+        test::writeFile(directory + "a", "hot");
+        for (int i = 0; i < 50 && manager.applyReloads() == 0; ++i)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        SFTOOLS_CHECK(manager["a"].content == "hot");
+
+        stats = manager.getStats();
+        SFTOOLS_CHECK(stats.loads == 2);
+        SFTOOLS_CHECK(stats.reloads == 2);
+    }
+#endif
+
+    return test::report();
+}
@@ -0,0 +1,172 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file tests/Test.hpp
+ @brief Minimal helpers shared by the tests
+
+ Every test is a standalone program returning 0 on success. Build one with,
+ e.g., `c++ -std=c++11 -I../include -I. Refs.cpp -o refs -lsfml-system -pthread`
+ (add -lsfml-graphics or -lsfml-audio for the tests using them) and run
+ it from any directory; files are created in a temporary directory.
+ */
+
+#ifndef __SFTOOLS_TESTS_TEST_HPP__
+#define __SFTOOLS_TESTS_TEST_HPP__
+
+#include <sftools/ResourceManager/Allocator.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+/*!
+ @brief Record a failure if `condition` is false, without stopping the test
+ */
+#define SFTOOLS_CHECK(condition) \
+    sftools::test::check((condition), #condition, __FILE__, __LINE__)
+
+/*!
+ @brief Check that `statement` throws an exception of type `exception`
+ */
+#define SFTOOLS_CHECK_THROWS(statement, exception) \
+    do \
+    { \
+        bool thrown = false; \
+        try { statement; } catch (exception const&) { thrown = true; } \
+        SFTOOLS_CHECK(thrown && #statement " throws " #exception); \
+    } \
+    while (false)
+
+namespace sftools
+{
+    /*!
+     @namespace sftools::test
+     @brief Helpers of the tests
+     */
+    namespace test
+    {
+        /*!
+         @brief Number of failed checks so far
+         */
+        inline int& failures()
+        {
+            static int count = 0;
+            return count;
+        }
+
+        /*!
+         @brief Implementation of SFTOOLS_CHECK
+         */
+        inline void check(bool condition, char const* text, char const* file, int line)
+        {
+            if (!condition)
+            {
+                std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, text);
+                ++failures();
+            }
+        }
+
+        /*!
+         @brief Report the outcome of a test; return it from main()
+         */
+        inline int report()
+        {
+            if (failures() != 0)
+            {
+                std::fprintf(stderr, "%d check(s) failed\n", failures());
+                return 1;
+            }
+
+            std::printf("ok\n");
+            return 0;
+        }
+
+        /*!
+         @brief Create an empty temporary directory
+
+         @param name name of the test, used in the directory name
+         @return path of the directory, ending with `/`
+         */
+        inline std::string makeDirectory(std::string const& name)
+        {
+#ifdef _WIN32
+            char const* base = std::getenv("TEMP");
+            std::string const path = std::string(base ? base : ".") + "\\sftools-" + name + "\\";
+            std::system(("rmdir /s /q \"" + path + "\" 2> nul & mkdir \"" + path + "\"").c_str());
+#else
+            char const* base = std::getenv("TMPDIR");
+            std::string const path = std::string(base ? base : "/tmp") + "/sftools-" + name + "/";
+            std::system(("rm -rf '" + path + "' && mkdir -p '" + path + "'").c_str());
+#endif
+            return path;
+        }
+
+        /*!
+         @brief Write a whole file
+
+         @param path file to write
+         @param content its content
+         */
+        inline void writeFile(std::string const& path, std::string const& content)
+        {
+            std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+            out << content;
+        }
+
+        /*!
+         @brief A resource holding the text of its file
+
+         It can be loaded with loader::LoadFromFile and
+         loader::LoadFromBatch.
+         */
+        struct Text
+        {
+            bool loadFromFile(std::string const& path)
+            {
+                std::ifstream in(path.c_str(), std::ios::binary);
+                if (!in)
+                {
+                    return false;
+                }
+
+                content.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+                return true;
+            }
+
+            bool loadFromMemory(void const* data, std::size_t size)
+            {
+                content.assign(static_cast<char const*>(data), size);
+                return true;
+            }
+
+            std::string content; //!< Text of the file
+        };
+    }
+}
+
+#endif // __SFTOOLS_TESTS_TEST_HPP__
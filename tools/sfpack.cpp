@@ -0,0 +1,87 @@
+/*
+
+ sftools - Copyright (c) 2012-2013 Marco Antognini <antognini.marco@gmail.com>
+
+ This software is provided 'as-is', without any express or implied warranty. In
+ no event will the authors be held liable for any damages arising from the use
+ of this software.
+
+ Permission is granted to anyone to use this software for any purpose, including
+ commercial applications, and to alter it and redistribute it freely, subject to
+ the following restrictions:
+
+ 1. The origin of this software must not be misrepresented; you must not claim
+ that you wrote the original software. If you use this software in a product,
+ an acknowledgment in the product documentation would be appreciated but is
+ not required.
+
+ 2. Altered source versions must be plainly marked as such, and must not be
+ misrepresented as being the original software.
+
+ 3. This notice may not be removed or altered from any source distribution.
+
+ */
+
+/*!
+ @file tools/sfpack.cpp
+ @brief Command line tool creating pack files for sftools::PackFile
+
+ Usage : `sfpack <archive> <directory>...`
+
+ Every file found in the directories, recursively, is added to the archive;
+ its id is its path relative to the directory it was found in.
+
+ Build it with, e.g., `c++ -std=c++11 -I../include sfpack.cpp -o sfpack`;
+ SFML's headers are required but the tool doesn't need to be linked against
+ SFML.
+ */
+
+#include <sftools/ResourceManager/PackFile.hpp>
+
+#include <iostream>
+#include <set>
+#include <string>
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <archive> <directory>..." << std::endl;
+        return 1;
+    }
+
+    sftools::PackWriter writer;
+    std::set<std::string> ids;
+
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string const directory = argv[i];
+
+        std::set<std::string> paths;
+        if (!sftools::priv::listFilesRecursively(directory, paths))
+        {
+            std::cerr << "Cannot read directory " << directory << std::endl;
+            return 1;
+        }
+
+        for (std::set<std::string>::const_iterator it = paths.begin(); it != paths.end(); ++it)
+        {
+            if (!ids.insert(*it).second)
+            {
+                std::cerr << "Skipping duplicate " << directory << "/" << *it << std::endl;
+                continue;
+            }
+
+            writer.add(*it, directory + "/" + *it);
+        }
+    }
+
+    if (!writer.write(argv[1]))
+    {
+        std::cerr << "Cannot write " << argv[1] << std::endl;
+        return 1;
+    }
+
+    std::cout << "Packed " << ids.size() << " files into " << argv[1] << std::endl;
+    return 0;
+}